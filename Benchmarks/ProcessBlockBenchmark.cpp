@@ -0,0 +1,334 @@
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "../Source/PluginProcessor.h"
+#include "../Source/RealtimeSafetyChecker.h"
+#include "RenderConformance.h"
+#include "StateConformance.h"
+#include "TimingConformance.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+//==============================================================================
+/**
+ * Benchmark de processBlock sin DAW ni hardware.
+ *
+ * Crea el procesador sin dispositivo MIDI (SPARKLE_HEADLESS), lo alimenta con
+ * MidiBuffers sintéticos y mide cada bloque para cada combinación de sample rate,
+ * tamaño de bloque y densidad del patrón. Cada pista tiene un sample sintético, el
+ * de la primera lo bastante largo para leerse del disco, así que la medida incluye
+ * la mezcla de voces y el streaming. Saca una línea por combinación en CSV
+ * (por defecto) o JSON, para comparar entre versiones. El registro va a la carpeta
+ * temporal, no al escritorio (ver AsyncLogger::getLogFile).
+ *
+ * Uso: SparkLEBenchmark [--blocks N] [--json] [--quick]
+ *      SparkLEBenchmark --timing [--bars N] [--seed N] [--swing N] [--json]
+ *      SparkLEBenchmark --state [--rounds N] [--seed N] [--json]
+ *      SparkLEBenchmark --render [--bars N] [--seed N] [--json]
+ *
+ * Con --timing no mide el coste sino la precisión temporal (ver TimingConformance.h)
+ * y termina con código 1 si algún evento se sale de la rejilla. Con --state comprueba
+ * el formato del estado guardado (ver StateConformance.h) y termina con código 1 si
+ * falla alguna comprobación. Con --render compara el render offline con la salida en
+ * vivo (ver RenderConformance.h) y termina con código 1 si alguna nota no coincide.
+ *
+ * Compilado con SPARKLE_ENABLE_RT_CHECKS, al final imprime el resumen de
+ * RealtimeSafetyChecker y termina con código 1 si hubo alguna violación.
+ */
+
+//==============================================================================
+// Contador de reservas de memoria del hilo que mide. Con las comprobaciones de
+// tiempo real activas el operator new es el de RealtimeSafetyChecker, que ya cuenta
+#if SPARKLE_RT_CHECKS
+namespace
+{
+    juce::int64 getAllocationCount() { return RealtimeSafetyChecker::getAllocationsOnThisThread(); }
+}
+#else
+namespace
+{
+    thread_local juce::int64 allocationCount = 0;
+
+    juce::int64 getAllocationCount() { return allocationCount; }
+
+    void* countedAllocation(std::size_t size)
+    {
+        ++allocationCount;
+
+        if (auto* ptr = std::malloc(size == 0 ? 1 : size))
+            return ptr;
+
+        throw std::bad_alloc();
+    }
+}
+
+void* operator new (std::size_t size)                       { return countedAllocation(size); }
+void* operator new[] (std::size_t size)                     { return countedAllocation(size); }
+void operator delete (void* ptr) noexcept                   { std::free(ptr); }
+void operator delete[] (void* ptr) noexcept                 { std::free(ptr); }
+void operator delete (void* ptr, std::size_t) noexcept      { std::free(ptr); }
+void operator delete[] (void* ptr, std::size_t) noexcept    { std::free(ptr); }
+#endif
+
+//==============================================================================
+namespace
+{
+    struct Config
+    {
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+        int densityPercent = 0;     // Porcentaje de pasos activos en las 32 pistas
+    };
+
+    struct Result
+    {
+        double meanNs = 0.0;
+        double p50Ns = 0.0;
+        double p99Ns = 0.0;
+        double maxNs = 0.0;
+        double allocationsPerBlock = 0.0;
+        double loadPercent = 0.0;   // Coste medio respecto a la duración del bloque
+    };
+
+    void fillPattern(MidiHandler& midiHandler, int densityPercent)
+    {
+        // Semilla fija: la misma densidad genera siempre el mismo patrón
+        juce::Random random(1234 + densityPercent);
+        midiHandler.setNumTracks(Pattern::maxTracks);
+
+        for (int track = 0; track < Pattern::maxTracks; ++track)
+            for (int step = 0; step < Pattern::defaultNumSteps; ++step)
+                midiHandler.setStepState(track, step, random.nextInt(100) < densityPercent);
+
+        // No hay bucle de mensajes: se compila a mano
+        midiHandler.compilePendingPatterns();
+    }
+
+    // Sample largo, por encima del umbral de streaming: se escribe a un WAV y se carga
+    // como cualquier otro, así que suena la cabeza y el resto lo lee SampleStreamer
+    std::unique_ptr<LoadedSample> createStreamedSample(const juce::File& file, double sampleRate)
+    {
+        const auto numSamples = (int) (sampleRate * (SampleLoader::streamingThresholdSeconds + 2.0));
+        juce::AudioBuffer<float> audio(2, numSamples);
+        juce::Random random(7);
+
+        for (int channel = 0; channel < 2; ++channel)
+            for (int i = 0; i < numSamples; ++i)
+                audio.setSample(channel, i, (random.nextFloat() * 2.0f - 1.0f)
+                                              * std::exp(-0.5f * (float) i / (float) sampleRate));
+
+        {
+            juce::WavAudioFormat format;
+            std::unique_ptr<juce::OutputStream> stream(file.createOutputStream());
+
+            if (stream == nullptr)
+                return nullptr;
+
+            std::unique_ptr<juce::AudioFormatWriter> writer(format.createWriterFor(stream.get(), sampleRate, 2, 24, {}, 0));
+
+            if (writer == nullptr)
+                return nullptr;
+
+            // El writer se queda con el stream
+            stream.release();
+            writer->writeFromAudioSampleBuffer(audio, 0, numSamples);
+        }
+
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+
+        return SampleLoader::decode(formatManager, file, sampleRate);
+    }
+
+    void addSyntheticSamples(MidiHandler& midiHandler, double sampleRate, const juce::File& longSampleFile)
+    {
+        // El primer pad tiene un sample largo para que la medida incluya el streaming
+        if (auto sample = createStreamedSample(longSampleFile, sampleRate))
+        {
+            jassert(sample->isStreamed());
+            midiHandler.installSample(0, std::move(sample));
+        }
+
+        // Los demás, ruido con caída exponencial de medio segundo, estéreo, ya al sample rate del test
+        juce::Random random(42);
+
+        for (int pad = 1; pad < Pattern::maxTracks; ++pad)
+        {
+            auto sample = std::make_unique<LoadedSample>();
+            sample->sampleRate = sampleRate;
+            sample->name = "Synthetic " + juce::String(pad + 1);
+            sample->audio.setSize(2, (int) (sampleRate * 0.5));
+
+            for (int channel = 0; channel < 2; ++channel)
+                for (int i = 0; i < sample->audio.getNumSamples(); ++i)
+                    sample->audio.setSample(channel, i, (random.nextFloat() * 2.0f - 1.0f)
+                                                          * std::exp(-8.0f * (float) i / (float) sampleRate));
+
+            midiHandler.installSample(pad, std::move(sample));
+        }
+    }
+
+    void addSyntheticInput(juce::MidiBuffer& midi, int blockIndex, int blockSize)
+    {
+        // Un pad pulsado cada cuatro bloques y soltado dos bloques después
+        const int pad = (blockIndex / 4) % 8;
+
+        if (blockIndex % 4 == 0)
+            midi.addEvent(juce::MidiMessage::noteOn(1, 60 + pad, (juce::uint8) 100), blockSize / 2);
+        else if (blockIndex % 4 == 2)
+            midi.addEvent(juce::MidiMessage::noteOff(1, 60 + pad), blockSize / 2);
+    }
+
+    Result runConfig(const Config& config, int numBlocks)
+    {
+        // Se borra después del procesador, que lee el sample largo del fichero
+        juce::TemporaryFile longSampleFile(".wav");
+        SparkLEPluginAudioProcessor processor;
+        auto& midiHandler = *processor.getMidiHandler();
+
+        fillPattern(midiHandler, config.densityPercent);
+
+        processor.setRateAndBufferSizeDetails(config.sampleRate, config.blockSize);
+        processor.prepareToPlay(config.sampleRate, config.blockSize);
+        addSyntheticSamples(midiHandler, config.sampleRate, longSampleFile.getFile());
+        midiHandler.startSequencer();
+
+        juce::AudioBuffer<float> buffer(2, config.blockSize);
+        juce::MidiBuffer midi;
+        midi.ensureSize(4096);
+
+        std::vector<double> times;
+        times.reserve((size_t) numBlocks);
+
+        constexpr int warmUpBlocks = 64;
+        juce::int64 allocations = 0;
+
+        for (int block = -warmUpBlocks; block < numBlocks; ++block)
+        {
+            buffer.clear();
+            midi.clear();
+            addSyntheticInput(midi, block + warmUpBlocks, config.blockSize);
+
+            const auto allocationsBefore = getAllocationCount();
+            const auto start = std::chrono::steady_clock::now();
+
+            processor.processBlock(buffer, midi);
+
+            const auto end = std::chrono::steady_clock::now();
+            const auto allocationsAfter = getAllocationCount();
+
+            if (block >= 0)
+            {
+                times.push_back((double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+                allocations += allocationsAfter - allocationsBefore;
+            }
+        }
+
+        processor.releaseResources();
+
+        Result result;
+
+        if (times.empty())
+            return result;
+
+        double total = 0.0;
+
+        for (auto time : times)
+            total += time;
+
+        std::sort(times.begin(), times.end());
+
+        const auto blockDurationNs = config.blockSize * 1.0e9 / config.sampleRate;
+
+        result.meanNs = total / (double) times.size();
+        result.p50Ns = times[times.size() / 2];
+        result.p99Ns = times[juce::jmin(times.size() - 1, (times.size() * 99) / 100)];
+        result.maxNs = times.back();
+        result.allocationsPerBlock = (double) allocations / (double) times.size();
+        result.loadPercent = 100.0 * result.meanNs / blockDurationNs;
+
+        return result;
+    }
+
+    void printResult(const Config& config, const Result& result, bool asJson)
+    {
+        if (asJson)
+        {
+            std::cout << "{\"sampleRate\":" << config.sampleRate
+                      << ",\"blockSize\":" << config.blockSize
+                      << ",\"density\":" << config.densityPercent
+                      << ",\"meanNs\":" << result.meanNs
+                      << ",\"p50Ns\":" << result.p50Ns
+                      << ",\"p99Ns\":" << result.p99Ns
+                      << ",\"maxNs\":" << result.maxNs
+                      << ",\"allocsPerBlock\":" << result.allocationsPerBlock
+                      << ",\"loadPercent\":" << result.loadPercent << "}" << std::endl;
+        }
+        else
+        {
+            std::cout << config.sampleRate << ',' << config.blockSize << ',' << config.densityPercent << ','
+                      << result.meanNs << ',' << result.p50Ns << ',' << result.p99Ns << ',' << result.maxNs << ','
+                      << result.allocationsPerBlock << ',' << result.loadPercent << std::endl;
+        }
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    // El procesador usa AsyncUpdater y timers: necesita un MessageManager
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--timing") || args.containsOption("--state") || args.containsOption("--render"))
+    {
+        const auto result = args.containsOption("--timing") ? runTimingConformance(args)
+                          : args.containsOption("--state")  ? runStateConformance(args)
+                                                            : runRenderConformance(args);
+
+       #if SPARKLE_RT_CHECKS
+        RealtimeSafetyChecker::printSummary();
+
+        if (RealtimeSafetyChecker::getTotalViolations() > 0)
+            return 1;
+       #endif
+
+        return result;
+    }
+
+    const bool asJson = args.containsOption("--json");
+    const bool quick = args.containsOption("--quick");
+    const int numBlocks = juce::jmax(1, args.getValueForOption("--blocks").getIntValue() > 0
+                                            ? args.getValueForOption("--blocks").getIntValue()
+                                            : (quick ? 200 : 2000));
+
+    const std::vector<double> sampleRates = quick ? std::vector<double> { 48000.0 }
+                                                  : std::vector<double> { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+    const std::vector<int> blockSizes = quick ? std::vector<int> { 64, 512 }
+                                              : std::vector<int> { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+    const std::vector<int> densities = quick ? std::vector<int> { 0, 100 }
+                                             : std::vector<int> { 0, 25, 50, 100 };
+
+    if (!asJson)
+        std::cout << "sampleRate,blockSize,density,meanNs,p50Ns,p99Ns,maxNs,allocsPerBlock,loadPercent" << std::endl;
+
+    for (auto sampleRate : sampleRates)
+        for (auto blockSize : blockSizes)
+            for (auto density : densities)
+            {
+                const Config config { sampleRate, blockSize, density };
+                printResult(config, runConfig(config, numBlocks), asJson);
+            }
+
+   #if SPARKLE_RT_CHECKS
+    RealtimeSafetyChecker::printSummary();
+
+    if (RealtimeSafetyChecker::getTotalViolations() > 0)
+        return 1;
+   #endif
+
+    return 0;
+}
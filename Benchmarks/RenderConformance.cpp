@@ -0,0 +1,226 @@
+#include "RenderConformance.h"
+#include "../Source/PluginProcessor.h"
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+    // Nota de la salida MIDI, en samples desde el arranque del transporte
+    struct NoteEvent
+    {
+        juce::int64 sample = 0;
+        int note = 0;
+        int velocity = 0;   // 0 en los Note Offs
+
+        bool operator< (const NoteEvent& other) const
+        {
+            return std::tie(sample, note, velocity) < std::tie(other.sample, other.note, other.velocity);
+        }
+    };
+
+    struct Config
+    {
+        double sampleRate = 48000.0;
+        double bpm = 120.0;     // Con un número entero de samples por negra
+    };
+
+    // Tamaños de bloque en vivo; 0 es un tamaño aleatorio en cada bloque
+    constexpr int liveBlockSizes[] = { 1, 17, 64, 511, 4096, 0 };
+    constexpr int maxRandomBlockSize = 1024;
+
+    //==============================================================================
+    void fillPattern(MidiHandler& midiHandler, juce::Random& random)
+    {
+        constexpr int numTracks = 8;
+        midiHandler.setNumTracks(numTracks);
+
+        for (int track = 0; track < numTracks; ++track)
+        {
+            midiHandler.setTrackLength(track, 1 + random.nextInt(Pattern::maxSteps));
+            midiHandler.setTrackRate(track, (Pattern::StepRate) random.nextInt((int) Pattern::StepRate::numRates));
+
+            for (int step = 0; step < Pattern::maxSteps; ++step)
+            {
+                if (random.nextInt(3) != 0)
+                    continue;
+
+                midiHandler.setStepState(track, step, true);
+                midiHandler.setStepVelocity(track, step, 1 + random.nextInt(127));
+            }
+        }
+
+        for (int step = 0; step < Pattern::maxSteps; ++step)
+        {
+            midiHandler.setStepGate(step, random.nextInt(Pattern::maxGate + 1));
+            midiHandler.setStepMicroTiming(step, random.nextInt(2 * Pattern::maxMicroTicks + 1) - Pattern::maxMicroTicks);
+        }
+
+        // No hay bucle de mensajes: se compila a mano
+        midiHandler.compilePendingPatterns();
+    }
+
+    void setSessionParameters(juce::AudioProcessorValueTreeState& parameters, const Config& config, juce::Random& random)
+    {
+        auto setParameter = [&parameters] (const juce::String& parameterId, float value)
+        {
+            auto* parameter = parameters.getParameter(parameterId);
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+        };
+
+        setParameter(PluginParameters::tempoId, (float) config.bpm);
+        setParameter(PluginParameters::swingId, (float) (Pattern::minSwing + random.nextInt(Pattern::maxSwing - Pattern::minSwing + 1)));
+
+        for (int track = 0; track < Pattern::maxTracks; ++track)
+        {
+            setParameter(PluginParameters::getTrackLevelId(track), random.nextFloat());
+            setParameter(PluginParameters::getTrackMuteId(track), random.nextInt(6) == 0 ? 1.0f : 0.0f);
+        }
+    }
+
+    //==============================================================================
+    std::vector<NoteEvent> playLive(SparkLEPluginAudioProcessor& processor, const Config& config,
+                                    int blockSize, juce::int64 numSamples, juce::Random& random)
+    {
+        const auto maxBlockSize = blockSize > 0 ? blockSize : maxRandomBlockSize;
+
+        processor.setRateAndBufferSizeDetails(config.sampleRate, maxBlockSize);
+        processor.prepareToPlay(config.sampleRate, maxBlockSize);
+        processor.getMidiHandler()->startSequencer();
+
+        juce::AudioBuffer<float> buffer(2, maxBlockSize);
+        juce::MidiBuffer midi;
+        std::vector<NoteEvent> events;
+
+        for (juce::int64 blockStart = 0; blockStart < numSamples;)
+        {
+            const auto numBlockSamples = (int) juce::jmin((juce::int64) (blockSize > 0 ? blockSize : 1 + random.nextInt(maxRandomBlockSize)),
+                                                          numSamples - blockStart);
+
+            juce::AudioBuffer<float> block(buffer.getArrayOfWritePointers(), 2, numBlockSamples);
+            block.clear();
+            midi.clear();
+
+            processor.processBlock(block, midi);
+
+            for (const auto metadata : midi)
+            {
+                const auto message = metadata.getMessage();
+
+                if (message.getChannel() == 1 && message.isNoteOnOrOff())
+                    events.push_back({ blockStart + metadata.samplePosition, message.getNoteNumber(),
+                                       message.isNoteOn() ? (int) message.getVelocity() : 0 });
+            }
+
+            blockStart += numBlockSamples;
+        }
+
+        processor.releaseResources();
+        return events;
+    }
+
+    std::vector<NoteEvent> render(const MidiHandler& midiHandler, const Config& config,
+                                  double lengthInBars, int blockSize, juce::int64 numSamples)
+    {
+        // Un tick por sample: el tick de cada evento es su sample en vivo
+        PatternRenderer::Settings settings;
+        settings.lengthInBars = lengthInBars;
+        settings.bpm = config.bpm;
+        settings.sampleRate = config.sampleRate;
+        settings.ticksPerQuarterNote = juce::roundToInt(config.sampleRate * 60.0 / config.bpm);
+        settings.blockSize = blockSize;
+
+        const auto midiFile = midiHandler.renderToMidiFile(settings);
+        std::vector<NoteEvent> events;
+
+        if (const auto* track = midiFile.getTrack(1))
+        {
+            for (const auto* holder : *track)
+            {
+                const auto& message = holder->message;
+                const auto sample = (juce::int64) std::llround(message.getTimeStamp());
+
+                // Las notas que el render corta al final no tienen equivalente en vivo
+                if (message.isNoteOnOrOff() && sample < numSamples)
+                    events.push_back({ sample, message.getNoteNumber(), message.isNoteOn() ? (int) message.getVelocity() : 0 });
+            }
+        }
+
+        return events;
+    }
+
+    juce::int64 countMismatches(std::vector<NoteEvent> live, std::vector<NoteEvent> rendered)
+    {
+        std::sort(live.begin(), live.end());
+        std::sort(rendered.begin(), rendered.end());
+
+        std::vector<NoteEvent> mismatches;
+        std::set_symmetric_difference(live.begin(), live.end(), rendered.begin(), rendered.end(),
+                                      std::back_inserter(mismatches));
+
+        for (size_t i = 0; i < juce::jmin((size_t) 10, mismatches.size()); ++i)
+            std::cerr << "Sin pareja: sample " << mismatches[i].sample << ", nota " << mismatches[i].note
+                      << ", velocidad " << mismatches[i].velocity << std::endl;
+
+        return (juce::int64) mismatches.size();
+    }
+}
+
+//==============================================================================
+int runRenderConformance(const juce::ArgumentList& args)
+{
+    const auto barsOption = args.getValueForOption("--bars").getIntValue();
+    const auto seedOption = args.getValueForOption("--seed").getLargeIntValue();
+    const auto numBars = barsOption > 0 ? barsOption : 8;
+    const bool asJson = args.containsOption("--json");
+
+    juce::Random random(seedOption != 0 ? seedOption : 1);
+    juce::int64 totalMismatches = 0;
+
+    if (!asJson)
+        std::cout << "sampleRate,bpm,liveBlockSize,renderBlockSize,liveEvents,renderedEvents,mismatches" << std::endl;
+
+    for (const auto& config : { Config { 48000.0, 120.0 }, Config { 44100.0, 126.0 }, Config { 96000.0, 180.0 } })
+    {
+        const auto samplesPerQuarter = config.sampleRate * 60.0 / config.bpm;
+        const auto numSamples = (juce::int64) std::llround(numBars * SequencerEngine::ppqPerBar * samplesPerQuarter);
+        const auto numBlockSizes = (int) std::size(liveBlockSizes);
+
+        for (int i = 0; i < numBlockSizes; ++i)
+        {
+            // Cada vuelta es una sesión nueva con su propio patrón y sus parámetros
+            SparkLEPluginAudioProcessor processor;
+            fillPattern(*processor.getMidiHandler(), random);
+            setSessionParameters(processor.getParameters(), config, random);
+
+            // El render recorre los tamaños fijos al revés que el vivo
+            const auto liveBlockSize = liveBlockSizes[i];
+            const auto renderBlockSize = liveBlockSize > 0 ? liveBlockSizes[numBlockSizes - 2 - i] : 4096;
+
+            const auto rendered = render(*processor.getMidiHandler(), config, numBars, renderBlockSize, numSamples);
+            const auto live = playLive(processor, config, liveBlockSize, numSamples, random);
+            const auto mismatches = countMismatches(live, rendered);
+            totalMismatches += mismatches;
+
+            if (asJson)
+            {
+                std::cout << "{\"sampleRate\":" << config.sampleRate
+                          << ",\"bpm\":" << config.bpm
+                          << ",\"liveBlockSize\":" << liveBlockSize
+                          << ",\"renderBlockSize\":" << renderBlockSize
+                          << ",\"liveEvents\":" << live.size()
+                          << ",\"renderedEvents\":" << rendered.size()
+                          << ",\"mismatches\":" << mismatches << "}" << std::endl;
+            }
+            else
+            {
+                std::cout << config.sampleRate << ',' << config.bpm << ',' << liveBlockSize << ',' << renderBlockSize << ','
+                          << live.size() << ',' << rendered.size() << ',' << mismatches << std::endl;
+            }
+        }
+    }
+
+    return totalMismatches == 0 ? 0 : 1;
+}
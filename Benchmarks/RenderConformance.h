@@ -0,0 +1,17 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+//==============================================================================
+/**
+ * Comprobación del render offline (PatternRenderer) contra la reproducción en vivo.
+ *
+ * Toca un patrón aleatorio (polimetría, divisiones, gates, microtiming, velocidades)
+ * en el procesador con swing, niveles y mutes de pista, bloque a bloque con varios
+ * tamaños, y lo renderiza con MidiHandler::renderToMidiFile a un tick por sample.
+ * Exige que cada Note On y Note Off del fichero tenga el mismo sample, la misma nota
+ * y la misma velocidad que en la salida MIDI del plugin. Devuelve 0 si todo coincide.
+ *
+ * Opciones: --bars N, --seed N, --json
+ */
+int runRenderConformance(const juce::ArgumentList& args);
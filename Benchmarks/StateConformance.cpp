@@ -0,0 +1,297 @@
+#include "StateConformance.h"
+#include "../Source/PluginProcessor.h"
+#include "../Source/StateSerializer.h"
+#include <iostream>
+
+namespace
+{
+    struct Stats
+    {
+        juce::int64 numChecks = 0;
+        juce::int64 numErrors = 0;
+
+        void check(bool passed, const juce::String& description)
+        {
+            ++numChecks;
+
+            if (!passed && numErrors++ < 10)
+                std::cerr << description << std::endl;
+        }
+    };
+
+    //==============================================================================
+    // Mismo CRC-32 que el formato, calculado aparte para poder fabricar chunks válidos
+    juce::uint32 calculateChecksum(const juce::uint8* data, size_t size)
+    {
+        auto crc = 0xffffffffu;
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            crc ^= data[i];
+
+            for (int bit = 0; bit < 8; ++bit)
+                crc = (crc & 1) != 0 ? 0xedb88320u ^ (crc >> 1) : crc >> 1;
+        }
+
+        return crc ^ 0xffffffffu;
+    }
+
+    void writeVarint(juce::MemoryOutputStream& out, juce::uint64 value)
+    {
+        while (value >= 0x80)
+        {
+            out.writeByte((char) ((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+
+        out.writeByte((char) value);
+    }
+
+    // Inserta una sección con un identificador que ningún lector conoce en la
+    // posición dada (tras la cabecera o al final) y recalcula el CRC
+    juce::MemoryBlock insertUnknownSection(const juce::MemoryBlock& chunk, size_t position, juce::Random& random)
+    {
+        constexpr size_t checksumSize = 4;
+        const auto* bytes = static_cast<const juce::uint8*>(chunk.getData());
+        const auto contentSize = chunk.getSize() - checksumSize;
+
+        juce::MemoryBlock result;
+        juce::MemoryOutputStream out(result, false);
+        out.write(bytes, position);
+
+        writeVarint(out, 1000 + (juce::uint64) random.nextInt(1000));
+
+        const auto payloadSize = random.nextInt(300);
+        writeVarint(out, (juce::uint64) payloadSize);
+
+        for (int i = 0; i < payloadSize; ++i)
+            out.writeByte((char) random.nextInt(256));
+
+        out.write(bytes + position, contentSize - position);
+
+        const auto checksum = calculateChecksum(static_cast<const juce::uint8*>(out.getData()), out.getDataSize());
+
+        for (int i = 0; i < (int) checksumSize; ++i)
+            out.writeByte((char) (checksum >> (8 * i)));
+
+        out.flush();
+        return result;
+    }
+
+    //==============================================================================
+    void fillRandomPattern(Pattern& pattern, juce::Random& random)
+    {
+        pattern.setNumTracks(1 + random.nextInt(Pattern::maxTracks));
+        pattern.setNumSteps(1 + random.nextInt(Pattern::maxSteps));
+
+        const auto density = random.nextInt(100);
+
+        for (int track = 0; track < pattern.getNumTracks(); ++track)
+        {
+            for (int step = 0; step < Pattern::maxSteps; ++step)
+            {
+                if (random.nextInt(100) >= density)
+                    continue;
+
+                // Velocidad y desplazamiento solo se guardan en las notas activas
+                pattern.setStep(track, step, true);
+
+                if (random.nextInt(8) == 0)
+                    pattern.setVelocity(track, step, 1 + random.nextInt(127));
+
+                if (random.nextInt(8) == 0)
+                    pattern.setNudge(track, step, random.nextInt(2 * Pattern::maxMicroTicks + 1) - Pattern::maxMicroTicks);
+            }
+
+            if (random.nextInt(4) == 0)
+                pattern.setTrackLength(track, 1 + random.nextInt(Pattern::maxSteps));
+
+            if (random.nextInt(4) == 0)
+                pattern.setTrackRate(track, (Pattern::StepRate) random.nextInt((int) Pattern::StepRate::numRates));
+        }
+
+        for (int step = 0; step < Pattern::maxSteps; ++step)
+        {
+            if (random.nextInt(6) == 0)
+                pattern.setGate(step, random.nextInt(Pattern::maxGate + 1));
+
+            if (random.nextInt(6) == 0)
+                pattern.setMicroTiming(step, random.nextInt(2 * Pattern::maxMicroTicks + 1) - Pattern::maxMicroTicks);
+        }
+    }
+
+    StateSerializer::State makeRandomState(juce::Random& random)
+    {
+        StateSerializer::State state;
+        auto& bank = state.bank;
+
+        // Algunos patrones se quedan vacíos, que el formato no guarda
+        for (auto& pattern : bank.patterns)
+            if (random.nextBool())
+                fillRandomPattern(pattern, random);
+
+        bank.selectedPattern = random.nextInt(PatternBank::numPatterns);
+        bank.songMode = random.nextBool();
+        bank.chainLength = random.nextInt(PatternBank::maxChainLength + 1);
+
+        for (int i = 0; i < bank.chainLength; ++i)
+            bank.chain[(size_t) i] = random.nextInt(PatternBank::numPatterns);
+
+        state.bpm = 20.0 + random.nextDouble() * 280.0;
+        state.swing = Pattern::minSwing + random.nextInt(Pattern::maxSwing - Pattern::minSwing + 1);
+        state.clickEnabled = random.nextBool();
+        state.midiClickEnabled = random.nextBool();
+
+        for (int pad = 0; pad < StateSerializer::maxPads; ++pad)
+            if (random.nextInt(4) == 0)
+                state.sampleFiles[(size_t) pad] = juce::String::fromUTF8("/Muestras/caj\xc3\xb3n ") + juce::String(random.nextInt()) + ".wav";
+
+        const auto numParameterBytes = random.nextInt(2000);
+        state.parameters.setSize((size_t) numParameterBytes);
+
+        for (int i = 0; i < numParameterBytes; ++i)
+            state.parameters[i] = (char) random.nextInt(256);
+
+        if (random.nextBool())
+        {
+            state.inputMap.clear();
+
+            for (int i = random.nextInt(64); --i >= 0;)
+                state.inputMap.setBinding(random.nextInt(MidiInputMap::numSources),
+                                          { (MidiInputMap::Action) (1 + random.nextInt((int) MidiInputMap::Action::numActions - 1)),
+                                            (juce::int8) (random.nextInt(256) - 128) });
+        }
+
+        return state;
+    }
+
+    bool areEqual(const StateSerializer::State& a, const StateSerializer::State& b)
+    {
+        if (a.bank.patterns != b.bank.patterns
+            || a.bank.selectedPattern != b.bank.selectedPattern
+            || a.bank.songMode != b.bank.songMode
+            || a.bank.chainLength != b.bank.chainLength)
+            return false;
+
+        for (int i = 0; i < a.bank.chainLength; ++i)
+            if (a.bank.chain[(size_t) i] != b.bank.chain[(size_t) i])
+                return false;
+
+        for (int source = 0; source < MidiInputMap::numSources; ++source)
+            if (a.inputMap.getBinding(source) != b.inputMap.getBinding(source))
+                return false;
+
+        return a.bpm == b.bpm && a.swing == b.swing
+            && a.clickEnabled == b.clickEnabled && a.midiClickEnabled == b.midiClickEnabled
+            && a.sampleFiles == b.sampleFiles && a.parameters == b.parameters;
+    }
+
+    //==============================================================================
+    void checkChunk(const StateSerializer::State& state, juce::Random& random, Stats& stats)
+    {
+        juce::MemoryBlock chunk;
+        StateSerializer::write(state, chunk);
+
+        const auto* bytes = static_cast<const juce::uint8*>(chunk.getData());
+        const auto size = chunk.getSize();
+
+        StateSerializer::State restored;
+        stats.check(StateSerializer::read(bytes, size, restored) && areEqual(state, restored),
+                    "El estado no sobrevive a escribirlo y leerlo");
+
+        // El CRC-32 detecta cualquier cambio en un solo byte
+        auto corrupted = chunk;
+        StateSerializer::State ignored;
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            corrupted[(int) i] = (char) (bytes[i] ^ (1 + random.nextInt(255)));
+            stats.check(!StateSerializer::read(corrupted.getData(), size, ignored),
+                        "Se acepta un chunk con el byte " + juce::String((int) i) + " cambiado");
+            corrupted[(int) i] = (char) bytes[i];
+        }
+
+        for (size_t length = 0; length < size; ++length)
+            stats.check(!StateSerializer::read(bytes, length, ignored),
+                        "Se acepta un chunk truncado a " + juce::String((int) length) + " bytes");
+
+        // Secciones de una versión posterior: tras la cabecera (versión de un byte) y al final
+        constexpr size_t headerSize = 5;
+
+        for (auto position : { headerSize, size - 4 })
+        {
+            const auto extended = insertUnknownSection(chunk, position, random);
+
+            StateSerializer::State withUnknown;
+            stats.check(StateSerializer::read(extended.getData(), extended.getSize(), withUnknown) && areEqual(state, withUnknown),
+                        "Una sección desconocida impide leer el estado");
+        }
+    }
+
+    //==============================================================================
+    // Proyectos anteriores al formato binario: el chunk es el XML de los parámetros
+    void checkLegacyXml(Stats& stats)
+    {
+        SparkLEPluginAudioProcessor source;
+        auto& parameters = source.getParameters();
+
+        auto setParameter = [&parameters] (const char* parameterId, float value)
+        {
+            auto* parameter = parameters.getParameter(parameterId);
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+        };
+
+        setParameter(PluginParameters::tempoId, 97.0f);
+        setParameter(PluginParameters::swingId, 62.0f);
+
+        juce::MemoryBlock chunk;
+
+        if (auto xml = parameters.copyState().createXml())
+            juce::AudioProcessor::copyXmlToBinary(*xml, chunk);
+
+        stats.check(!StateSerializer::hasValidHeader(chunk.getData(), chunk.getSize()),
+                    "Un chunk XML pasa por binario");
+
+        SparkLEPluginAudioProcessor target;
+        target.setStateInformation(chunk.getData(), (int) chunk.getSize());
+
+        auto& restored = target.getParameters();
+        stats.check(restored.getRawParameterValue(PluginParameters::tempoId)->load() == 97.0f
+                        && restored.getRawParameterValue(PluginParameters::swingId)->load() == 62.0f,
+                    "El chunk XML no restaura los parámetros");
+    }
+}
+
+//==============================================================================
+int runStateConformance(const juce::ArgumentList& args)
+{
+    const auto roundsOption = args.getValueForOption("--rounds").getIntValue();
+    const auto seedOption = args.getValueForOption("--seed").getLargeIntValue();
+    const auto numRounds = roundsOption > 0 ? roundsOption : 20;
+    const bool asJson = args.containsOption("--json");
+
+    juce::Random random(seedOption != 0 ? seedOption : 1);
+    Stats stats;
+
+    // El estado por defecto es el que guarda un proyecto recién creado
+    checkChunk(StateSerializer::State(), random, stats);
+
+    for (int round = 0; round < numRounds; ++round)
+        checkChunk(makeRandomState(random), random, stats);
+
+    checkLegacyXml(stats);
+
+    if (asJson)
+    {
+        std::cout << "{\"rounds\":" << numRounds
+                  << ",\"checks\":" << stats.numChecks
+                  << ",\"errors\":" << stats.numErrors << "}" << std::endl;
+    }
+    else
+    {
+        std::cout << "rounds,checks,errors" << std::endl
+                  << numRounds << ',' << stats.numChecks << ',' << stats.numErrors << std::endl;
+    }
+
+    return stats.numErrors == 0 ? 0 : 1;
+}
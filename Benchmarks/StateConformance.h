@@ -0,0 +1,18 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+//==============================================================================
+/**
+ * Comprobación del formato del estado guardado (StateSerializer).
+ *
+ * Escribe y vuelve a leer estados aleatorios (banco, transporte, swing, samples,
+ * parámetros y tabla de entrada MIDI) y exige que salgan idénticos; que se rechace
+ * cualquier chunk con un byte cambiado o truncado en cualquier punto; que se salten
+ * las secciones desconocidas, y que un chunk XML de las versiones anteriores no se
+ * tome por binario y restaure los parámetros en el procesador. Devuelve 0 si todas
+ * las comprobaciones pasan.
+ *
+ * Opciones: --rounds N, --seed N, --json
+ */
+int runStateConformance(const juce::ArgumentList& args);
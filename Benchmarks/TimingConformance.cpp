@@ -0,0 +1,250 @@
+#include "TimingConformance.h"
+#include "../Source/MidiHandler.h"
+#include "../Source/RealtimeSafetyChecker.h"
+#include <iostream>
+#include <vector>
+
+namespace
+{
+    // Pistas que se comprueban: semicorcheas, tresillos de corchea y dos de longitud
+    // impar, en las que el swing tiene que seguir cayendo en los pasos impares de la
+    // rejilla aunque la vuelta de la pista empiece unas veces en par y otras en impar
+    struct CheckedTrack
+    {
+        int track = 0;
+        Pattern::StepRate rate = Pattern::StepRate::sixteenth;
+        int length = Pattern::defaultNumSteps;
+        double stepPpq = 0.0;
+        juce::int64 nextStepIndex = 0;
+    };
+
+    // Tramo de la línea de tiempo ideal: desde anchorSample la posición avanza a
+    // ppqPerSample por sample (igual que el reloj, pero calculado por separado)
+    struct Anchor
+    {
+        juce::int64 sample = 0;
+        double ppq = 0.0;
+        double ppqPerSample = 0.0;
+        double sampleRate = 48000.0;
+    };
+
+    struct Stats
+    {
+        juce::int64 numEvents = 0;
+        juce::int64 numErrors = 0;
+        double maxDeviationSamples = 0.0;
+        double maxDeviationUs = 0.0;
+        double totalDeviationUs = 0.0;
+    };
+
+    class IdealTimeline
+    {
+    public:
+        void addAnchor(juce::int64 sample, double ppqPerSample, double sampleRate)
+        {
+            const auto ppq = anchors.empty() ? 0.0 : getPpqAt(sample);
+            anchors.push_back({ sample, ppq, ppqPerSample, sampleRate });
+        }
+
+        double getPpqAt(juce::int64 sample) const
+        {
+            const auto& anchor = anchors.back();
+            return anchor.ppq + (double) (sample - anchor.sample) * anchor.ppqPerSample;
+        }
+
+        // Sample ideal (con decimales) en el que se alcanza una posición
+        const Anchor& findAnchorFor(double ppq) const
+        {
+            for (size_t i = anchors.size(); i-- > 1;)
+                if (anchors[i].ppq <= ppq)
+                    return anchors[i];
+
+            return anchors.front();
+        }
+
+        double getSampleFor(double ppq) const
+        {
+            const auto& anchor = findAnchorFor(ppq);
+            return (double) anchor.sample + (ppq - anchor.ppq) / anchor.ppqPerSample;
+        }
+
+    private:
+        std::vector<Anchor> anchors;
+    };
+
+    // Posición ideal del paso index de una pista: los impares de la rejilla, con swing
+    double getIdealPpq(const CheckedTrack& checked, juce::int64 index, double swingOffset)
+    {
+        return ((double) index + ((index & 1) != 0 ? swingOffset : 0.0)) * checked.stepPpq;
+    }
+
+    void checkEvent(CheckedTrack& checked, juce::int64 sample, double swingOffset,
+                    const IdealTimeline& timeline, Stats& stats)
+    {
+        // Cada Note On debe ser el siguiente paso de su pista: si se salta o se
+        // repite un paso, la desviación es de un paso entero
+        const auto idealPpq = getIdealPpq(checked, checked.nextStepIndex++, swingOffset);
+        const auto idealSample = timeline.getSampleFor(idealPpq);
+        const auto deviation = (double) sample - idealSample;
+        const auto deviationUs = std::abs(deviation) * 1.0e6 / timeline.findAnchorFor(idealPpq).sampleRate;
+
+        ++stats.numEvents;
+        stats.totalDeviationUs += deviationUs;
+        stats.maxDeviationSamples = juce::jmax(stats.maxDeviationSamples, std::abs(deviation));
+        stats.maxDeviationUs = juce::jmax(stats.maxDeviationUs, deviationUs);
+
+        // El evento cae en el primer sample que alcanza su posición: [0, 1) samples
+        if (deviation < -1.0e-6 || deviation >= 1.0)
+        {
+            if (stats.numErrors++ < 10)
+                std::cerr << "Pista " << checked.track << ", paso " << checked.nextStepIndex - 1
+                          << ": sample " << sample << ", ideal " << idealSample << std::endl;
+        }
+    }
+}
+
+//==============================================================================
+int runTimingConformance(const juce::ArgumentList& args)
+{
+    const auto barsOption = args.getValueForOption("--bars").getIntValue();
+    const auto seedOption = args.getValueForOption("--seed").getLargeIntValue();
+    const auto swingOption = args.getValueForOption("--swing").getIntValue();
+    const auto numBars = barsOption > 0 ? barsOption : 2000;
+    const auto swing = swingOption > 0 ? juce::jlimit(Pattern::minSwing, Pattern::maxSwing, swingOption) : 62;
+    const auto swingOffset = CompiledPattern::getSwingOffset(swing);
+    const bool asJson = args.containsOption("--json");
+
+    juce::Random random(seedOption != 0 ? seedOption : 1);
+
+    std::vector<CheckedTrack> checkedTracks { { 0, Pattern::StepRate::sixteenth },
+                                              { 1, Pattern::StepRate::eighthTriplet },
+                                              { 2, Pattern::StepRate::sixteenth, 3 },
+                                              { 3, Pattern::StepRate::sixteenth, 5 } };
+
+    MidiHandler midiHandler;
+    midiHandler.setNumTracks((int) checkedTracks.size());
+    midiHandler.setSwing(swing);
+
+    for (auto& checked : checkedTracks)
+    {
+        midiHandler.setTrackRate(checked.track, checked.rate);
+        midiHandler.setTrackLength(checked.track, checked.length);
+        checked.stepPpq = (double) Pattern::getStepTicks(checked.rate) / Pattern::ticksPerQuarter;
+
+        for (int step = 0; step < checked.length; ++step)
+            midiHandler.setStepState(checked.track, step, true);
+    }
+
+    midiHandler.compilePendingPatterns();
+
+    const double sampleRates[] = { 44100.0, 48000.0, 88200.0, 96000.0, 192000.0 };
+    auto sampleRate = 48000.0;
+    auto bpm = 120.0;
+
+    midiHandler.setTempo(bpm);
+    midiHandler.prepareToPlay(sampleRate, 4096);
+    midiHandler.startSequencer();
+
+    IdealTimeline timeline;
+    timeline.addAnchor(0, bpm / (60.0 * sampleRate), sampleRate);
+
+    juce::MidiBuffer midi;
+    midi.ensureSize(8192);
+
+    Stats stats;
+    juce::int64 sample = 0;
+    const auto endPpq = numBars * SequencerEngine::ppqPerBar;
+
+    while (timeline.getPpqAt(sample) < endPpq)
+    {
+        // De vez en cuando cambia el sample rate o el tempo, siempre entre bloques
+        const auto change = random.nextInt(2000);
+
+        if (change == 0)
+        {
+            sampleRate = sampleRates[random.nextInt(juce::numElementsInArray(sampleRates))];
+            midiHandler.prepareToPlay(sampleRate, 4096);
+            timeline.addAnchor(sample, bpm / (60.0 * sampleRate), sampleRate);
+        }
+        else if (change == 1)
+        {
+            bpm = 60.0 + random.nextDouble() * 140.0;
+            midiHandler.setTempo(bpm);
+            timeline.addAnchor(sample, bpm / (60.0 * sampleRate), sampleRate);
+        }
+
+        // Bloques de 1 sample, impares y grandes
+        int numSamples = 0;
+
+        switch (random.nextInt(4))
+        {
+            case 0:  numSamples = 1 + random.nextInt(3); break;
+            case 1:  numSamples = 1 + 2 * random.nextInt(256); break;
+            case 2:  numSamples = 1 + random.nextInt(4096); break;
+            default: numSamples = 512; break;
+        }
+
+        midi.clear();
+
+        {
+            // Sin procesador de por medio: el ámbito del hilo de audio se marca aquí
+            SPARKLE_AUDIO_THREAD_SCOPE
+            midiHandler.processPendingCommands();
+            midiHandler.processMidi(midi, numSamples, nullptr);
+        }
+
+        for (const auto metadata : midi)
+        {
+            const auto message = metadata.getMessage();
+
+            if (!message.isNoteOn())
+                continue;
+
+            for (auto& checked : checkedTracks)
+                if (message.getNoteNumber() == 60 + checked.track)
+                    checkEvent(checked, sample + metadata.samplePosition, swingOffset, timeline, stats);
+        }
+
+        sample += numSamples;
+    }
+
+    // Tampoco puede faltar ningún paso al final
+    const auto endPositionPpq = timeline.getPpqAt(sample);
+
+    for (auto& checked : checkedTracks)
+    {
+        auto expectedSteps = (juce::int64) std::ceil(endPositionPpq / checked.stepPpq - 1.0e-9);
+
+        // El último paso impar puede haber quedado por detrás del final con el swing
+        if (expectedSteps > 0 && getIdealPpq(checked, expectedSteps - 1, swingOffset) >= endPositionPpq - 1.0e-9)
+            --expectedSteps;
+
+        if (checked.nextStepIndex != expectedSteps)
+        {
+            std::cerr << "Pista " << checked.track << ": " << checked.nextStepIndex
+                      << " pasos tocados, se esperaban " << expectedSteps << std::endl;
+            ++stats.numErrors;
+        }
+    }
+
+    const auto meanDeviationUs = stats.numEvents > 0 ? stats.totalDeviationUs / (double) stats.numEvents : 0.0;
+
+    if (asJson)
+    {
+        std::cout << "{\"bars\":" << numBars
+                  << ",\"swing\":" << swing
+                  << ",\"events\":" << stats.numEvents
+                  << ",\"errors\":" << stats.numErrors
+                  << ",\"maxDeviationSamples\":" << stats.maxDeviationSamples
+                  << ",\"maxDeviationUs\":" << stats.maxDeviationUs
+                  << ",\"meanDeviationUs\":" << meanDeviationUs << "}" << std::endl;
+    }
+    else
+    {
+        std::cout << "bars,swing,events,errors,maxDeviationSamples,maxDeviationUs,meanDeviationUs" << std::endl
+                  << numBars << ',' << swing << ',' << stats.numEvents << ',' << stats.numErrors << ','
+                  << stats.maxDeviationSamples << ',' << stats.maxDeviationUs << ',' << meanDeviationUs << std::endl;
+    }
+
+    return stats.numErrors == 0 ? 0 : 1;
+}
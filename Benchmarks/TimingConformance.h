@@ -0,0 +1,17 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+//==============================================================================
+/**
+ * Comprobación de la precisión temporal del secuenciador.
+ *
+ * Hace sonar el MidiHandler durante miles de compases con bloques de tamaño
+ * aleatorio (también de 1 sample y tamaños impares), cambios de sample rate vía
+ * prepareToPlay y cambios de tempo, y compara el sample de cada Note On con su
+ * posición ideal en la rejilla con swing, también en pistas de longitud impar.
+ * Devuelve 0 si ningún evento se desvía más de un sample ni falta ninguno.
+ *
+ * Opciones: --bars N, --seed N, --swing N (62 por defecto), --json
+ */
+int runTimingConformance(const juce::ArgumentList& args);
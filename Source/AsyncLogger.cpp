@@ -0,0 +1,194 @@
+#include "AsyncLogger.h"
+#include "RealtimeSafetyChecker.h"
+
+std::atomic<AsyncLogger*> AsyncLogger::instance { nullptr };
+std::atomic<int> AsyncLogger::runtimeLevel { juce::jmin(SPARKLE_LOG_LEVEL, (int) AsyncLogger::Level::off) };
+
+namespace
+{
+    const char* getLevelName(AsyncLogger::Level level)
+    {
+        switch (level)
+        {
+            case AsyncLogger::Level::debug:    return "DEBUG";
+            case AsyncLogger::Level::info:     return "INFO";
+            case AsyncLogger::Level::warning:  return "WARNING";
+            case AsyncLogger::Level::error:    return "ERROR";
+            case AsyncLogger::Level::off:      break;
+        }
+
+        return "";
+    }
+}
+
+//==============================================================================
+AsyncLogger::AsyncLogger()
+    : juce::Thread("SparkLE Log")
+{
+    // Celda i libre para la escritura número i
+    for (size_t i = 0; i < ringSize; ++i)
+        ring[i].sequence.store(i, std::memory_order_relaxed);
+
+    auto file = getLogFile();
+    stream = std::make_unique<juce::FileOutputStream>(file);
+
+    if (stream->failedToOpen())
+        stream.reset();
+    else
+        *stream << "\n---- SparkLE Plugin Log " << juce::Time::getCurrentTime().toString(true, true) << " ----\n";
+
+    instance.store(this);
+    juce::Logger::setCurrentLogger(this);
+    startThread(juce::Thread::Priority::background);
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    if (juce::Logger::getCurrentLogger() == this)
+        juce::Logger::setCurrentLogger(nullptr);
+
+    instance.store(nullptr);
+
+    // run() vuelca lo que quede antes de salir
+    stopThread(2000);
+}
+
+juce::File AsyncLogger::getLogFile()
+{
+   #if defined (SPARKLE_HEADLESS) && SPARKLE_HEADLESS
+    // Benchmarks y herramientas: crean procesadores sin parar y no deben llenar el escritorio
+    return juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("sparkle_headless_log.txt");
+   #else
+    return juce::File::getSpecialLocation(juce::File::userDesktopDirectory).getChildFile("sparkle_plugin_log.txt");
+   #endif
+}
+
+//==============================================================================
+bool AsyncLogger::isEnabled(Level level)
+{
+    return (int) level >= runtimeLevel.load(std::memory_order_relaxed)
+        && instance.load(std::memory_order_relaxed) != nullptr;
+}
+
+void AsyncLogger::write(Level level, const juce::String& message)
+{
+    if (auto* logger = instance.load(std::memory_order_acquire))
+        logger->push(level, message);
+}
+
+void AsyncLogger::setLevel(Level newLevel)
+{
+    runtimeLevel.store((int) newLevel, std::memory_order_relaxed);
+}
+
+AsyncLogger::Level AsyncLogger::getLevel()
+{
+    return (Level) runtimeLevel.load(std::memory_order_relaxed);
+}
+
+void AsyncLogger::logMessage(const juce::String& message)
+{
+    // juce::Logger::writeToLog de código que no usa los niveles
+    if (isEnabled(Level::info))
+        push(Level::info, message);
+}
+
+//==============================================================================
+bool AsyncLogger::push(Level level, const juce::String& message)
+{
+   #if SPARKLE_RT_CHECKS
+    if (RealtimeSafetyChecker::isInAudioThreadScope())
+        RealtimeSafetyChecker::reportViolation(RealtimeSafetyChecker::Violation::logger, "AsyncLogger::push");
+   #endif
+
+    auto position = writePosition.load(std::memory_order_relaxed);
+    Cell* cell = nullptr;
+
+    for (;;)
+    {
+        cell = &ring[position & (ringSize - 1)];
+        const auto sequence = cell->sequence.load(std::memory_order_acquire);
+        const auto difference = (std::ptrdiff_t) sequence - (std::ptrdiff_t) position;
+
+        if (difference == 0)
+        {
+            // Celda libre: se reserva avanzando la posición de escritura
+            if (writePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (difference < 0)
+        {
+            // El hilo de volcado no ha llegado todavía: anillo lleno
+            droppedMessages.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else
+        {
+            position = writePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->entry.timeMs = juce::Time::currentTimeMillis();
+    cell->entry.level = level;
+    message.copyToUTF8(cell->entry.text, (size_t) maxMessageBytes);
+
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+bool AsyncLogger::pop(Entry& entry)
+{
+    auto& cell = ring[readPosition & (ringSize - 1)];
+
+    if (cell.sequence.load(std::memory_order_acquire) != readPosition + 1)
+        return false;
+
+    entry = cell.entry;
+
+    // La celda queda libre para la escritura de la siguiente vuelta
+    cell.sequence.store(readPosition + ringSize, std::memory_order_release);
+    ++readPosition;
+    return true;
+}
+
+void AsyncLogger::flushPending()
+{
+    Entry entry;
+    bool wroteSomething = false;
+
+    while (pop(entry))
+    {
+        if (stream != nullptr)
+        {
+            const juce::Time time(entry.timeMs);
+
+            *stream << time.formatted("%H:%M:%S") << "." << juce::String(time.getMilliseconds()).paddedLeft('0', 3)
+                    << " [" << getLevelName(entry.level) << "] " << juce::String::fromUTF8(entry.text) << "\n";
+        }
+
+        wroteSomething = true;
+    }
+
+    const auto dropped = droppedMessages.load(std::memory_order_relaxed);
+
+    if (dropped != reportedDrops && stream != nullptr)
+    {
+        *stream << "[WARNING] " << (dropped - reportedDrops) << " mensajes descartados (registro lleno)\n";
+        reportedDrops = dropped;
+        wroteSomething = true;
+    }
+
+    if (wroteSomething && stream != nullptr)
+        stream->flush();
+}
+
+void AsyncLogger::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(flushIntervalMs);
+        flushPending();
+    }
+
+    flushPending();
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+
+// Nivel mínimo que se compila: 0 debug, 1 info, 2 warning, 3 error, 4 nada.
+// Lo que quede por debajo desaparece del binario (ni se construye el mensaje)
+#ifndef SPARKLE_LOG_LEVEL
+ #if JUCE_DEBUG
+  #define SPARKLE_LOG_LEVEL 0
+ #else
+  #define SPARKLE_LOG_LEVEL 1
+ #endif
+#endif
+
+//==============================================================================
+/**
+ * Registro asíncrono con niveles.
+ *
+ * Los mensajes se copian a un anillo preasignado sin bloqueos (varios productores,
+ * un consumidor) y un hilo propio los vuelca al fichero por lotes, así que escribir
+ * en el registro nunca espera al disco ni a un mutex. Si el anillo se llena, el
+ * mensaje se descarta y se cuenta. Hay un filtro por nivel en tiempo de compilación
+ * (SPARKLE_LOG_LEVEL) y otro en tiempo de ejecución (setLevel).
+ *
+ * Se comparte entre todas las instancias del plugin con SharedResourcePointer y se
+ * instala como juce::Logger, de modo que juce::Logger::writeToLog también pasa por
+ * el anillo (con nivel info).
+ */
+class AsyncLogger : public juce::Logger,
+                    private juce::Thread
+{
+public:
+    enum class Level
+    {
+        debug = 0, info, warning, error, off
+    };
+
+    AsyncLogger();
+    ~AsyncLogger() override;
+
+    // Escribe en el registro compartido, si existe y el nivel está activo
+    static void write(Level level, const juce::String& message);
+    static bool isEnabled(Level level);
+
+    static void setLevel(Level newLevel);
+    static Level getLevel();
+
+    // En el escritorio; en la carpeta temporal si se compila con SPARKLE_HEADLESS
+    static juce::File getLogFile();
+
+    // Mensajes perdidos porque el anillo estaba lleno
+    int getNumDroppedMessages() const { return droppedMessages.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr int maxMessageBytes = 240;
+    static constexpr size_t ringSize = 1024;        // Potencia de dos
+    static constexpr int flushIntervalMs = 250;
+
+    struct Entry
+    {
+        juce::int64 timeMs = 0;
+        Level level = Level::info;
+        char text[maxMessageBytes] = {};
+    };
+
+    // Cada celda lleva un número de secuencia que dice si está libre o escrita
+    struct Cell
+    {
+        std::atomic<size_t> sequence { 0 };
+        Entry entry;
+    };
+
+    std::array<Cell, ringSize> ring;
+    std::atomic<size_t> writePosition { 0 };
+    size_t readPosition = 0;                        // Solo el hilo de volcado
+    std::atomic<int> droppedMessages { 0 };
+    int reportedDrops = 0;
+
+    std::unique_ptr<juce::FileOutputStream> stream;
+
+    bool push(Level level, const juce::String& message);
+    bool pop(Entry& entry);
+    void flushPending();
+    void logMessage(const juce::String& message) override;
+    void run() override;
+
+    static std::atomic<AsyncLogger*> instance;
+    static std::atomic<int> runtimeLevel;
+
+    JUCE_DECLARE_NON_COPYABLE(AsyncLogger)
+};
+
+//==============================================================================
+#define SPARKLE_LOG_AT(level, message) \
+    do { if (AsyncLogger::isEnabled(level)) AsyncLogger::write(level, message); } while (false)
+
+#if SPARKLE_LOG_LEVEL <= 0
+ #define SPARKLE_LOG_DEBUG(message)     SPARKLE_LOG_AT(AsyncLogger::Level::debug, message)
+#else
+ #define SPARKLE_LOG_DEBUG(message)     do {} while (false)
+#endif
+
+#if SPARKLE_LOG_LEVEL <= 1
+ #define SPARKLE_LOG_INFO(message)      SPARKLE_LOG_AT(AsyncLogger::Level::info, message)
+#else
+ #define SPARKLE_LOG_INFO(message)      do {} while (false)
+#endif
+
+#if SPARKLE_LOG_LEVEL <= 2
+ #define SPARKLE_LOG_WARNING(message)   SPARKLE_LOG_AT(AsyncLogger::Level::warning, message)
+#else
+ #define SPARKLE_LOG_WARNING(message)   do {} while (false)
+#endif
+
+#if SPARKLE_LOG_LEVEL <= 3
+ #define SPARKLE_LOG_ERROR(message)     SPARKLE_LOG_AT(AsyncLogger::Level::error, message)
+#else
+ #define SPARKLE_LOG_ERROR(message)     do {} while (false)
+#endif
@@ -0,0 +1,176 @@
+#include "AudioTelemetry.h"
+
+namespace
+{
+    // Límites superiores de los cubos de error (en samples); el último no tiene límite
+    constexpr double jitterBucketLimits[] = { -1.0, 0.0, 1.0, 2.0, 4.0, 16.0, 64.0 };
+
+    int getJitterBucket(double errorInSamples)
+    {
+        int bucket = 0;
+
+        for (auto limit : jitterBucketLimits)
+        {
+            if (errorInSamples < limit)
+                return bucket;
+
+            ++bucket;
+        }
+
+        return bucket;
+    }
+}
+
+//==============================================================================
+void AudioTelemetry::beginBlock()
+{
+    if (resetRequested.exchange(false, std::memory_order_relaxed))
+        reset();
+
+    blockStartTicks = juce::Time::getHighResolutionTicks();
+}
+
+void AudioTelemetry::endBlock(int numSamples, double sampleRate)
+{
+    const auto elapsedTicks = juce::Time::getHighResolutionTicks() - blockStartTicks;
+    const auto costUs = juce::Time::highResolutionTicksToSeconds(elapsedTicks) * 1.0e6;
+
+    increment(numBlocks);
+    lastCostUs.store(costUs, std::memory_order_relaxed);
+    totalCostUs.store(totalCostUs.load(std::memory_order_relaxed) + costUs, std::memory_order_relaxed);
+    storeMax(maxCostUs, costUs);
+
+    if (numSamples > 0 && sampleRate > 0.0)
+    {
+        const auto blockDurationUs = numSamples * 1.0e6 / sampleRate;
+        const auto loadPercent = 100.0 * costUs / blockDurationUs;
+        const auto bucket = juce::jlimit(0, numLoadBuckets - 1, (int) (loadPercent / 10.0));
+
+        storeMax(maxLoadPercent, loadPercent);
+        increment(loadHistogram[(size_t) bucket]);
+    }
+}
+
+void AudioTelemetry::recordStepError(double errorInSamples)
+{
+    increment(stepsTriggered);
+    storeMax(maxStepErrorSamples, std::abs(errorInSamples));
+    increment(jitterHistogram[(size_t) getJitterBucket(errorInSamples)]);
+}
+
+void AudioTelemetry::recordSendQueueDepth(int depth)
+{
+    sendQueueDepth.store(depth, std::memory_order_relaxed);
+    storeMax(maxSendQueueDepth, depth);
+}
+
+void AudioTelemetry::reset()
+{
+    numBlocks.store(0, std::memory_order_relaxed);
+    lastCostUs.store(0.0, std::memory_order_relaxed);
+    totalCostUs.store(0.0, std::memory_order_relaxed);
+    maxCostUs.store(0.0, std::memory_order_relaxed);
+    maxLoadPercent.store(0.0, std::memory_order_relaxed);
+
+    for (auto& count : loadHistogram)
+        count.store(0, std::memory_order_relaxed);
+
+    stepsTriggered.store(0, std::memory_order_relaxed);
+    maxStepErrorSamples.store(0.0, std::memory_order_relaxed);
+
+    for (auto& count : jitterHistogram)
+        count.store(0, std::memory_order_relaxed);
+
+    eventsEmitted.store(0, std::memory_order_relaxed);
+    hardwareMessagesQueued.store(0, std::memory_order_relaxed);
+    hardwareMessagesDropped.store(0, std::memory_order_relaxed);
+    maxSendQueueDepth.store(0, std::memory_order_relaxed);
+}
+
+//==============================================================================
+AudioTelemetry::Snapshot AudioTelemetry::getSnapshot() const
+{
+    Snapshot snapshot;
+
+    snapshot.numBlocks = numBlocks.load(std::memory_order_relaxed);
+    snapshot.lastCostUs = lastCostUs.load(std::memory_order_relaxed);
+    snapshot.meanCostUs = snapshot.numBlocks > 0 ? totalCostUs.load(std::memory_order_relaxed) / (double) snapshot.numBlocks : 0.0;
+    snapshot.maxCostUs = maxCostUs.load(std::memory_order_relaxed);
+    snapshot.maxLoadPercent = maxLoadPercent.load(std::memory_order_relaxed);
+
+    for (size_t i = 0; i < loadHistogram.size(); ++i)
+        snapshot.loadHistogram[i] = loadHistogram[i].load(std::memory_order_relaxed);
+
+    snapshot.stepsTriggered = stepsTriggered.load(std::memory_order_relaxed);
+    snapshot.maxStepErrorSamples = maxStepErrorSamples.load(std::memory_order_relaxed);
+
+    for (size_t i = 0; i < jitterHistogram.size(); ++i)
+        snapshot.jitterHistogram[i] = jitterHistogram[i].load(std::memory_order_relaxed);
+
+    snapshot.eventsEmitted = eventsEmitted.load(std::memory_order_relaxed);
+    snapshot.hardwareMessagesQueued = hardwareMessagesQueued.load(std::memory_order_relaxed);
+    snapshot.hardwareMessagesDropped = hardwareMessagesDropped.load(std::memory_order_relaxed);
+    snapshot.sendQueueDepth = sendQueueDepth.load(std::memory_order_relaxed);
+    snapshot.maxSendQueueDepth = maxSendQueueDepth.load(std::memory_order_relaxed);
+
+    return snapshot;
+}
+
+juce::String AudioTelemetry::getLoadBucketName(int bucket)
+{
+    if (bucket >= numLoadBuckets - 1)
+        return "> 100 %";
+
+    return juce::String(bucket * 10) + "-" + juce::String((bucket + 1) * 10) + " %";
+}
+
+juce::String AudioTelemetry::getJitterBucketName(int bucket)
+{
+    if (bucket <= 0)
+        return "< " + juce::String(jitterBucketLimits[0]);
+
+    if (bucket >= numJitterBuckets - 1)
+        return ">= " + juce::String(jitterBucketLimits[numJitterBuckets - 2]);
+
+    return juce::String(jitterBucketLimits[bucket - 1]) + ".." + juce::String(jitterBucketLimits[bucket]);
+}
+
+juce::String AudioTelemetry::getCsvHeader()
+{
+    juce::StringArray columns { "time", "blocks", "lastCostUs", "meanCostUs", "maxCostUs", "maxLoadPercent",
+                                "steps", "maxStepErrorSamples", "eventsEmitted",
+                                "hwQueued", "hwDropped", "sendQueueDepth", "maxSendQueueDepth" };
+
+    for (int i = 0; i < numLoadBuckets; ++i)
+        columns.add("load" + juce::String(i));
+
+    for (int i = 0; i < numJitterBuckets; ++i)
+        columns.add("jitter" + juce::String(i));
+
+    return columns.joinIntoString(",");
+}
+
+juce::String AudioTelemetry::toCsvRow(const Snapshot& snapshot)
+{
+    juce::StringArray values { juce::Time::getCurrentTime().toISO8601(true),
+                               juce::String(snapshot.numBlocks),
+                               juce::String(snapshot.lastCostUs, 2),
+                               juce::String(snapshot.meanCostUs, 2),
+                               juce::String(snapshot.maxCostUs, 2),
+                               juce::String(snapshot.maxLoadPercent, 2),
+                               juce::String(snapshot.stepsTriggered),
+                               juce::String(snapshot.maxStepErrorSamples, 3),
+                               juce::String(snapshot.eventsEmitted),
+                               juce::String(snapshot.hardwareMessagesQueued),
+                               juce::String(snapshot.hardwareMessagesDropped),
+                               juce::String(snapshot.sendQueueDepth),
+                               juce::String(snapshot.maxSendQueueDepth) };
+
+    for (auto count : snapshot.loadHistogram)
+        values.add(juce::String(count));
+
+    for (auto count : snapshot.jitterHistogram)
+        values.add(juce::String(count));
+
+    return values.joinIntoString(",");
+}
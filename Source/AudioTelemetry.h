@@ -0,0 +1,107 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+
+//==============================================================================
+/**
+ * Telemetría del hilo de audio para diagnosticar cortes sin un profiler.
+ *
+ * El hilo de audio es el único que escribe: cada contador es un atómico que se
+ * actualiza con load/store relajados, sin reservar memoria ni bloquear. El hilo de
+ * mensajes lee una foto con getSnapshot(); la foto no es atómica en conjunto, pero
+ * cada valor sí lo es, que es suficiente para un panel de diagnóstico. Para poner
+ * a cero se pide con requestReset() y lo hace el propio hilo de audio al empezar
+ * el siguiente bloque.
+ */
+class AudioTelemetry
+{
+public:
+    // Coste del bloque respecto a su duración: de 10 en 10 % y uno para > 100 %
+    static constexpr int numLoadBuckets = 11;
+
+    // Error de cada paso en samples respecto a su posición exacta. Lo normal es
+    // [0, 1): el paso cae en el primer sample que alcanza su posición
+    static constexpr int numJitterBuckets = 8;
+
+    struct Snapshot
+    {
+        juce::int64 numBlocks = 0;
+        double lastCostUs = 0.0;
+        double meanCostUs = 0.0;
+        double maxCostUs = 0.0;
+        double maxLoadPercent = 0.0;
+        std::array<juce::uint32, numLoadBuckets> loadHistogram {};
+
+        juce::int64 stepsTriggered = 0;
+        double maxStepErrorSamples = 0.0;
+        std::array<juce::uint32, numJitterBuckets> jitterHistogram {};
+
+        juce::int64 eventsEmitted = 0;              // Eventos MIDI en la salida del plugin
+        juce::int64 hardwareMessagesQueued = 0;
+        juce::int64 hardwareMessagesDropped = 0;    // Cola de envío llena
+        int sendQueueDepth = 0;                     // Al final del último bloque
+        int maxSendQueueDepth = 0;
+    };
+
+    AudioTelemetry() = default;
+
+    // Hilo de audio
+    void beginBlock();
+    void endBlock(int numSamples, double sampleRate);
+    void recordStepError(double errorInSamples);
+    void recordEventEmitted()                       { increment(eventsEmitted); }
+    void recordHardwareMessage(bool wasQueued)      { increment(wasQueued ? hardwareMessagesQueued : hardwareMessagesDropped); }
+    void recordSendQueueDepth(int depth);
+
+    // Hilo de mensajes
+    Snapshot getSnapshot() const;
+    void requestReset() { resetRequested.store(true, std::memory_order_relaxed); }
+
+    static juce::String getLoadBucketName(int bucket);
+    static juce::String getJitterBucketName(int bucket);
+
+    // Una línea de CSV por foto, con la hora a la que se tomó
+    static juce::String getCsvHeader();
+    static juce::String toCsvRow(const Snapshot& snapshot);
+
+private:
+    // Un solo escritor: no hace falta una operación read-modify-write atómica
+    template <typename Type>
+    static void increment(std::atomic<Type>& counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    template <typename Type>
+    static void storeMax(std::atomic<Type>& value, Type candidate)
+    {
+        if (candidate > value.load(std::memory_order_relaxed))
+            value.store(candidate, std::memory_order_relaxed);
+    }
+
+    void reset();
+
+    std::atomic<bool> resetRequested { false };
+    juce::int64 blockStartTicks = 0;
+
+    std::atomic<juce::int64> numBlocks { 0 };
+    std::atomic<double> lastCostUs { 0.0 };
+    std::atomic<double> totalCostUs { 0.0 };
+    std::atomic<double> maxCostUs { 0.0 };
+    std::atomic<double> maxLoadPercent { 0.0 };
+    std::array<std::atomic<juce::uint32>, numLoadBuckets> loadHistogram {};
+
+    std::atomic<juce::int64> stepsTriggered { 0 };
+    std::atomic<double> maxStepErrorSamples { 0.0 };
+    std::array<std::atomic<juce::uint32>, numJitterBuckets> jitterHistogram {};
+
+    std::atomic<juce::int64> eventsEmitted { 0 };
+    std::atomic<juce::int64> hardwareMessagesQueued { 0 };
+    std::atomic<juce::int64> hardwareMessagesDropped { 0 };
+    std::atomic<int> sendQueueDepth { 0 };
+    std::atomic<int> maxSendQueueDepth { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE(AudioTelemetry)
+};
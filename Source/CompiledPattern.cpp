@@ -0,0 +1,147 @@
+#include "CompiledPattern.h"
+#include "RealtimeSafetyChecker.h"
+#include <numeric>
+
+//==============================================================================
+std::unique_ptr<CompiledPattern> CompiledPattern::compile(const Pattern& pattern)
+{
+    SPARKLE_NON_REALTIME_CALL("CompiledPattern::compile");
+
+    auto compiled = std::make_unique<CompiledPattern>();
+
+    compiled->numSteps = pattern.getNumSteps();
+    compiled->numTracks = pattern.getNumTracks();
+    compiled->lengthPpq = compiled->numSteps * ppqPerStep;
+
+    for (int step = 0; step < Pattern::maxSteps; ++step)
+        compiled->stepOffsets[(size_t) step] = (double) pattern.getMicroTiming(step) / Pattern::microTicksPerStep;
+
+    // El ciclo es el mínimo común múltiplo de las vueltas de todas las pistas y de
+    // la longitud nominal, en ticks enteros, con un número par de pasos de cada pista
+    // para que el swing caiga siempre en los mismos. Si se pasa del tope, las pistas
+    // vuelven a empezar juntas al final del tope, redondeado a la longitud nominal y
+    // a un número par de pasos de cada pista (unitTicks)
+    const auto sixteenthTicks = (juce::int64) Pattern::getStepTicks(Pattern::StepRate::sixteenth);
+    const auto nominalTicks = compiled->numSteps * sixteenthTicks;
+    const auto maxCycleTicks = juce::jmax(nominalTicks, (juce::int64) maxCycleBars * 4 * Pattern::ticksPerQuarter);
+    const auto leastCommonMultiple = [](juce::int64 a, juce::int64 b) { return a / std::gcd(a, b) * b; };
+    auto cycleTicks = nominalTicks;
+    auto unitTicks = nominalTicks;
+
+    for (int track = 0; track < compiled->numTracks; ++track)
+    {
+        const auto stepTicks = Pattern::getStepTicks(pattern.getTrackRate(track));
+        const auto length = pattern.getTrackLength(track);
+
+        compiled->tracks[(size_t) track] = { (double) stepTicks / Pattern::ticksPerQuarter, length };
+
+        if (pattern.getRow(track) == 0)
+            continue;
+
+        unitTicks = leastCommonMultiple(unitTicks, 2 * (juce::int64) stepTicks);
+
+        if (cycleTicks <= maxCycleTicks)
+            cycleTicks = leastCommonMultiple(cycleTicks, (juce::int64) stepTicks * length);
+    }
+
+    cycleTicks = leastCommonMultiple(cycleTicks, unitTicks);
+
+    if (cycleTicks > maxCycleTicks)
+        cycleTicks = juce::jmax((juce::int64) 1, maxCycleTicks / unitTicks) * unitTicks;
+
+    compiled->cycleLengthPpq = (double) cycleTicks / Pattern::ticksPerQuarter;
+
+    // Reserva de una vez todos los eventos del ciclo
+    size_t numEvents = 0;
+
+    for (int track = 0; track < compiled->numTracks; ++track)
+    {
+        const auto loopTicks = (juce::int64) Pattern::getStepTicks(pattern.getTrackRate(track)) * pattern.getTrackLength(track);
+        const auto numLoops = (size_t) ((cycleTicks + loopTicks - 1) / loopTicks);
+        numEvents += (size_t) juce::countNumberOfBits(pattern.getRow(track)) * numLoops;
+    }
+
+    // Cada evento con su línea: 0 para los pasos pares, y para los impares una por
+    // duración de paso, que es lo que los retrasa el swing
+    std::vector<std::pair<int, Event>> keyedEvents;
+    keyedEvents.reserve(numEvents);
+
+    // Solo se generan los pasos que suenan; los cabezales se calculan a partir de la posición
+    for (int track = 0; track < compiled->numTracks; ++track)
+    {
+        const auto row = pattern.getRow(track);
+
+        if (row == 0)
+            continue;
+
+        const auto stepTicks = (juce::int64) Pattern::getStepTicks(pattern.getTrackRate(track));
+        const auto stepPpq = compiled->tracks[(size_t) track].stepPpq;
+        const auto length = compiled->tracks[(size_t) track].length;
+        const auto oddLane = 1 + (int) pattern.getTrackRate(track);
+
+        for (juce::int64 index = 0; index * stepTicks < cycleTicks; ++index)
+        {
+            const auto step = (int) (index % length);
+
+            if (((row >> step) & 1) == 0)
+                continue;
+
+            // Un paso adelantado antes del inicio suena al final de la vuelta anterior.
+            // El swing, que puede llevarlo más allá del final, lo suma el motor
+            const auto nudge = (double) pattern.getNudge(track, step) / Pattern::microTicksPerStep;
+            auto ppq = ((double) index + compiled->stepOffsets[(size_t) step] + nudge) * stepPpq;
+
+            if (ppq < 0.0)
+                ppq += compiled->cycleLengthPpq;
+            else if (ppq >= compiled->cycleLengthPpq)
+                ppq -= compiled->cycleLengthPpq;
+
+            const auto gatePpq = pattern.getGate(step) * stepPpq / Pattern::gateUnitsPerStep;
+            keyedEvents.push_back({ (index & 1) != 0 ? oddLane : 0,
+                                    { ppq, step, track, gatePpq, pattern.getVelocity(track, step) } });
+        }
+    }
+
+    // Se mezclan las pistas de cada línea en orden de tiempo; con microtiming dos
+    // pasos vecinos de la misma pista también pueden cruzarse
+    std::stable_sort(keyedEvents.begin(), keyedEvents.end(),
+                     [](const std::pair<int, Event>& a, const std::pair<int, Event>& b)
+                     {
+                         return a.first != b.first ? a.first < b.first : a.second.ppq < b.second.ppq;
+                     });
+
+    compiled->events.reserve(keyedEvents.size());
+
+    for (size_t i = 0; i < keyedEvents.size(); ++i)
+    {
+        const auto key = keyedEvents[i].first;
+
+        if (i == 0 || key != keyedEvents[i - 1].first)
+        {
+            const auto stepPpq = key > 0 ? (double) Pattern::getStepTicks((Pattern::StepRate) (key - 1)) / Pattern::ticksPerQuarter : 0.0;
+            compiled->lanes[(size_t) compiled->numLanes++] = { i, i, stepPpq };
+        }
+
+        compiled->events.push_back(keyedEvents[i].second);
+        compiled->lanes[(size_t) compiled->numLanes - 1].end = i + 1;
+    }
+
+    return compiled;
+}
+
+double CompiledPattern::getSwingOffset(int swingPercent)
+{
+    // El paso impar de cada pareja se retrasa hasta el porcentaje indicado de la
+    // pareja (50% = recto)
+    return juce::jlimit(Pattern::minSwing, Pattern::maxSwing, swingPercent) * 2.0 / 100.0 - 1.0;
+}
+
+size_t CompiledPattern::findFirstEventAtOrAfter(const Lane& lane, double ppq) const
+{
+    const auto first = events.begin() + (std::ptrdiff_t) lane.begin;
+    const auto last = events.begin() + (std::ptrdiff_t) lane.end;
+    auto it = std::lower_bound(first, last, ppq,
+                               [](const Event& event, double position) { return event.ppq < position; });
+
+    return (size_t) std::distance(events.begin(), it);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "Pattern.h"
+
+//==============================================================================
+/**
+ * Patrón preparado para tocarse: un array de eventos ordenado por posición.
+ *
+ * Se genera en el hilo de mensajes cada vez que cambia el patrón y el hilo de
+ * audio solo lo recorre con un cursor, así que el coste por bloque no depende de
+ * la densidad del patrón. Las posiciones están en negras (PPQ) relativas al
+ * inicio del patrón, de modo que un cambio de tempo no obliga a recompilar.
+ *
+ * El microtiming se resuelve aquí: cada paso tiene su desplazamiento precalculado
+ * en la tabla stepOffsets, al que se suma el de cada nota. El swing no, porque el
+ * host lo automatiza: lo suma el motor al colocar cada evento. Para que eso no
+ * desordene nada, los eventos van agrupados en líneas (lanes): los pasos pares en
+ * una y los impares de cada duración de paso en otra. Par o impar se cuenta desde
+ * el inicio del patrón en la rejilla de la pista, no dentro de su vuelta, así que
+ * una pista de longitud impar no cambia de pasos retrasados en cada vuelta; por eso
+ * el ciclo tiene siempre un número par de pasos de cada pista. El swing retrasa por igual
+ * todos los eventos de una línea, así que cada línea sigue ordenada con cualquier
+ * swing y el motor solo tiene que mezclar unas pocas.
+ *
+ * Las pistas con longitud o duración de paso propias se mezclan en una sola línea
+ * de tiempo que dura hasta que todas vuelven a coincidir (el mínimo común múltiplo
+ * de sus vueltas, con un tope de maxCycleBars compases). Así todas las pistas
+ * avanzan en la misma pasada del cursor, tengan la polimetría que tengan.
+ */
+struct CompiledPattern
+{
+    struct Event
+    {
+        double ppq = 0.0;               // Posición relativa al inicio del ciclo
+        int step = 0;                   // Paso de la pista que suena
+        int track = 0;                  // Pista que suena
+        double gatePpq = 0.0;           // Duración de la nota
+        int velocity = Pattern::defaultVelocity;
+    };
+
+    // Tramo de events con los eventos de una línea, ordenados por ppq. Con swing los
+    // eventos de la línea se retrasan swingPpq por la fracción de paso del swing
+    struct Lane
+    {
+        size_t begin = 0;
+        size_t end = 0;
+        double swingPpq = 0.0;
+    };
+
+    // Longitud y duración de paso de cada pista, para calcular su cabezal
+    struct Track
+    {
+        double stepPpq = 0.0;
+        int length = Pattern::defaultNumSteps;
+    };
+
+    static constexpr int stepsPerBeat = 4;  // Semicorcheas
+    static constexpr double ppqPerStep = 1.0 / stepsPerBeat;
+    static constexpr int maxCycleBars = 16;
+    static constexpr int maxLanes = 1 + (int) Pattern::StepRate::numRates;
+
+    std::vector<Event> events;          // Solo los pasos que suenan, por líneas
+    std::array<Lane, maxLanes> lanes {};
+    int numLanes = 0;                   // Solo las líneas con eventos
+    std::array<Track, Pattern::maxTracks> tracks {};
+    std::array<double, Pattern::maxSteps> stepOffsets {};   // Microtiming, en fracción de paso (sin swing ni el de cada nota)
+    double lengthPpq = 0.0;             // Longitud nominal del patrón (numSteps semicorcheas)
+    double cycleLengthPpq = 0.0;        // Vuelta completa de la línea de tiempo
+    int numSteps = 0;
+    int numTracks = 0;
+
+    // Solo desde el hilo de mensajes: reserva memoria
+    static std::unique_ptr<CompiledPattern> compile(const Pattern& pattern);
+
+    // Retraso de los pasos impares con un swing dado, en fracción de paso
+    static double getSwingOffset(int swingPercent);
+
+    // Desplazamiento respecto a la rejilla del paso index de una pista (contado desde
+    // el inicio del ciclo, que es step dentro de su vuelta) con el swing dado, en
+    // fracción de paso (sin el de cada nota)
+    double getStepOffset(juce::int64 index, int step, double swingOffset) const
+    {
+        return stepOffsets[(size_t) step] + ((index & 1) != 0 ? swingOffset : 0.0);
+    }
+
+    // Primer evento de la línea cuya posición sin swing es >= ppq (relativa al ciclo)
+    size_t findFirstEventAtOrAfter(const Lane& lane, double ppq) const;
+
+    // Paso en el que está una pista para una posición dentro del ciclo
+    int getTrackStep(int track, double positionInCycle) const
+    {
+        const auto& info = tracks[(size_t) track];
+        return info.stepPpq > 0.0 ? (int) (positionInCycle / info.stepPpq) % info.length : 0;
+    }
+};
@@ -0,0 +1,135 @@
+#include "DiagnosticsComponent.h"
+#include "AsyncLogger.h"
+
+//==============================================================================
+DiagnosticsComponent::DiagnosticsComponent(AudioTelemetry& telemetryToShow)
+    : telemetry(telemetryToShow)
+{
+    addAndMakeVisible(resetButton);
+    resetButton.onClick = [this] { telemetry.requestReset(); };
+
+    addAndMakeVisible(exportButton);
+    exportButton.onClick = [this] {
+        appendCsvRow();
+        SPARKLE_LOG_INFO("SparkLEPlugin: Telemetría exportada a " + getCsvFile().getFullPathName());
+    };
+
+    addAndMakeVisible(recordButton);
+}
+
+juce::File DiagnosticsComponent::getCsvFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userDesktopDirectory).getChildFile("sparkle_telemetry.csv");
+}
+
+void DiagnosticsComponent::update()
+{
+    snapshot = telemetry.getSnapshot();
+
+    // Mientras se registra, una línea por segundo
+    const auto now = juce::Time::getMillisecondCounter();
+
+    if (isRecording() && now - lastRecordTime >= 1000)
+    {
+        appendCsvRow();
+        lastRecordTime = now;
+    }
+
+    if (isVisible())
+        repaint();
+}
+
+void DiagnosticsComponent::appendCsvRow()
+{
+    auto file = getCsvFile();
+
+    if (!file.existsAsFile())
+        file.appendText(AudioTelemetry::getCsvHeader() + "\n");
+
+    file.appendText(AudioTelemetry::toCsvRow(snapshot) + "\n");
+}
+
+//==============================================================================
+void DiagnosticsComponent::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colour(0xee111118));
+    g.setColour(juce::Colours::white);
+    g.drawRect(getLocalBounds(), 1);
+
+    auto area = getLocalBounds().reduced(10);
+    area.removeFromBottom(30);  // Botones
+
+    // Valores sueltos a la izquierda
+    auto textArea = area.removeFromLeft(260);
+    const juce::StringArray lines {
+        "Bloques: " + juce::String(snapshot.numBlocks),
+        "Coste último: " + juce::String(snapshot.lastCostUs, 1) + " us",
+        "Coste medio: " + juce::String(snapshot.meanCostUs, 1) + " us",
+        "Coste máximo: " + juce::String(snapshot.maxCostUs, 1) + " us",
+        "Carga máxima: " + juce::String(snapshot.maxLoadPercent, 1) + " %",
+        "Pasos: " + juce::String(snapshot.stepsTriggered),
+        "Error máximo: " + juce::String(snapshot.maxStepErrorSamples, 3) + " samples",
+        "Eventos emitidos: " + juce::String(snapshot.eventsEmitted),
+        "Hardware encolados: " + juce::String(snapshot.hardwareMessagesQueued),
+        "Hardware descartados: " + juce::String(snapshot.hardwareMessagesDropped),
+        "Cola de envío: " + juce::String(snapshot.sendQueueDepth)
+            + " (máx. " + juce::String(snapshot.maxSendQueueDepth) + ")"
+    };
+
+    g.setFont(14.0f);
+
+    for (const auto& line : lines)
+        g.drawText(line, textArea.removeFromTop(20), juce::Justification::centredLeft);
+
+    // Histogramas a la derecha, uno encima de otro
+    area.removeFromLeft(10);
+    auto loadArea = area.removeFromTop(area.getHeight() / 2);
+
+    drawHistogram(g, loadArea.reduced(0, 4), "Carga por bloque",
+                  snapshot.loadHistogram.data(), AudioTelemetry::numLoadBuckets, &AudioTelemetry::getLoadBucketName);
+    drawHistogram(g, area.reduced(0, 4), "Error de los pasos (samples)",
+                  snapshot.jitterHistogram.data(), AudioTelemetry::numJitterBuckets, &AudioTelemetry::getJitterBucketName);
+}
+
+void DiagnosticsComponent::drawHistogram(juce::Graphics& g, juce::Rectangle<int> area, const juce::String& title,
+                                         const juce::uint32* counts, int numBuckets, juce::String (*getBucketName)(int))
+{
+    g.setColour(juce::Colours::white);
+    g.setFont(13.0f);
+    g.drawText(title, area.removeFromTop(18), juce::Justification::centredLeft);
+
+    juce::uint32 maxCount = 1;
+
+    for (int i = 0; i < numBuckets; ++i)
+        maxCount = juce::jmax(maxCount, counts[i]);
+
+    const auto rowHeight = area.getHeight() / juce::jmax(1, numBuckets);
+    g.setFont(11.0f);
+
+    for (int i = 0; i < numBuckets; ++i)
+    {
+        auto row = area.removeFromTop(rowHeight);
+        auto label = row.removeFromLeft(80);
+        auto countArea = row.removeFromRight(70);
+
+        g.setColour(juce::Colours::lightgrey);
+        g.drawText(getBucketName(i), label, juce::Justification::centredLeft);
+        g.drawText(juce::String(counts[i]), countArea, juce::Justification::centredRight);
+
+        // Barra proporcional al cubo más lleno
+        const auto width = juce::roundToInt(row.getWidth() * (double) counts[i] / (double) maxCount);
+        g.setColour(juce::Colours::orange);
+        g.fillRect(row.withWidth(width).reduced(0, 1));
+    }
+}
+
+void DiagnosticsComponent::resized()
+{
+    auto buttons = getLocalBounds().reduced(10).removeFromBottom(25);
+
+    resetButton.setBounds(buttons.removeFromLeft(100));
+    buttons.removeFromLeft(10);
+    exportButton.setBounds(buttons.removeFromLeft(120));
+    buttons.removeFromLeft(10);
+    recordButton.setBounds(buttons.removeFromLeft(140));
+}
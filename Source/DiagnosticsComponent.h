@@ -0,0 +1,45 @@
+#pragma once
+
+#include <juce_gui_basics/juce_gui_basics.h>
+#include "AudioTelemetry.h"
+
+//==============================================================================
+/**
+ * Panel de diagnóstico oculto (Ctrl/Cmd + Mayús + D en el editor).
+ *
+ * Muestra la telemetría del hilo de audio: coste de los bloques, histograma de
+ * carga, error de los pasos en samples, eventos emitidos y descartados y la cola
+ * de envío al hardware. Puede volcar la foto actual a un CSV o ir añadiendo una
+ * línea por segundo mientras está activado "Registrar CSV".
+ */
+class DiagnosticsComponent : public juce::Component
+{
+public:
+    explicit DiagnosticsComponent(AudioTelemetry& telemetryToShow);
+
+    void paint(juce::Graphics&) override;
+    void resized() override;
+
+    // Llamado desde el timer del editor
+    void update();
+
+    bool isRecording() const { return recordButton.getToggleState(); }
+
+    // CSV junto al log del plugin
+    static juce::File getCsvFile();
+
+private:
+    AudioTelemetry& telemetry;
+    AudioTelemetry::Snapshot snapshot;
+    juce::uint32 lastRecordTime = 0;
+
+    juce::TextButton resetButton { "Reiniciar" };
+    juce::TextButton exportButton { "Exportar CSV" };
+    juce::ToggleButton recordButton { "Registrar CSV" };
+
+    void appendCsvRow();
+    void drawHistogram(juce::Graphics& g, juce::Rectangle<int> area, const juce::String& title,
+                       const juce::uint32* counts, int numBuckets, juce::String (*getBucketName)(int));
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DiagnosticsComponent)
+};
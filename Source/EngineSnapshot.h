@@ -0,0 +1,128 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+#include "Pattern.h"
+#include "LedStateCache.h"
+
+//==============================================================================
+/**
+ * Estado del motor tal y como lo ve el editor: se rellena en el hilo de audio y se
+ * publica entero una vez por bloque, así que todos los campos corresponden al mismo
+ * bloque. Tiene que poder copiarse con memcpy.
+ */
+struct EngineSnapshot
+{
+    static constexpr int maxMeterChannels = 2;
+
+    juce::uint32 version = 0;       // Cambia cada vez que cambia el contenido
+
+    // Transporte
+    bool isPlaying = false;
+    double ppqPosition = 0.0;       // Al principio del bloque
+    double bpm = 120.0;
+
+    // Cabezales: el paso global del patrón y el de cada pista
+    int playingPattern = 0;
+    int currentStep = 0;
+    std::array<int, Pattern::maxTracks> trackPlayheads {};
+
+    // LEDs de los pads: un bit por pad y color 0x00RRGGBB (componentes de 0 a 127)
+    juce::uint32 ledsOn = 0;
+    std::array<juce::uint32, LedStateCache::maxLeds> ledColours {};
+
+    // Pico de la salida en el bloque, por canal
+    std::array<float, maxMeterChannels> outputPeaks {};
+
+    // Compara todo menos la versión
+    bool hasSameContent(const EngineSnapshot& other) const
+    {
+        return isPlaying == other.isPlaying
+            && ppqPosition == other.ppqPosition
+            && bpm == other.bpm
+            && playingPattern == other.playingPattern
+            && currentStep == other.currentStep
+            && trackPlayheads == other.trackPlayheads
+            && ledsOn == other.ledsOn
+            && ledColours == other.ledColours
+            && outputPeaks == other.outputPeaks;
+    }
+};
+
+//==============================================================================
+/**
+ * Seqlock de un escritor y varios lectores para publicar un valor entero de un hilo
+ * a otro.
+ *
+ * El escritor (hilo de audio) nunca espera ni reserva memoria: marca la secuencia
+ * como impar, copia el valor y la vuelve a dejar par. El lector copia el valor y lo
+ * descarta si la secuencia era impar o ha cambiado mientras copiaba. Los datos se
+ * copian palabra a palabra con atómicos relajados, así que no hay carreras de datos
+ * aunque el lector coincida con una escritura.
+ */
+template <typename ValueType>
+class SeqLock
+{
+public:
+    static_assert(std::is_trivially_copyable<ValueType>::value, "SeqLock copia el valor con memcpy");
+
+    SeqLock() = default;
+
+    // Solo desde el hilo escritor
+    void publish(const ValueType& value)
+    {
+        std::array<juce::uint32, numWords> words {};
+        std::memcpy(words.data(), &value, sizeof(ValueType));
+
+        const auto sequenceNumber = sequence.load(std::memory_order_relaxed);
+        sequence.store(sequenceNumber + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < numWords; ++i)
+            storage[i].store(words[i], std::memory_order_relaxed);
+
+        sequence.store(sequenceNumber + 2, std::memory_order_release);
+    }
+
+    // Devuelve false si el escritor ha interrumpido todos los intentos (result no se toca)
+    bool read(ValueType& result) const
+    {
+        for (int attempt = 0; attempt < maxReadAttempts; ++attempt)
+        {
+            const auto before = sequence.load(std::memory_order_acquire);
+
+            if ((before & 1) != 0)
+                continue;
+
+            std::array<juce::uint32, numWords> words;
+
+            for (size_t i = 0; i < numWords; ++i)
+                words[i] = storage[i].load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (sequence.load(std::memory_order_relaxed) == before)
+            {
+                std::memcpy(static_cast<void*>(&result), words.data(), sizeof(ValueType));
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Número de publicaciones hechas hasta ahora
+    juce::uint32 getNumPublished() const { return sequence.load(std::memory_order_acquire) / 2; }
+
+private:
+    static constexpr size_t numWords = (sizeof(ValueType) + sizeof(juce::uint32) - 1) / sizeof(juce::uint32);
+    static constexpr int maxReadAttempts = 64;
+
+    std::atomic<juce::uint32> sequence { 0 };
+    std::array<std::atomic<juce::uint32>, numWords> storage {};
+
+    JUCE_DECLARE_NON_COPYABLE(SeqLock)
+};
@@ -0,0 +1,133 @@
+#include "HardwareMidiSender.h"
+#include "RealtimeSafetyChecker.h"
+
+namespace
+{
+    // Resolución de las posiciones dentro de cada lote (0.1 ms)
+    constexpr double batchTicksPerSecond = 10000.0;
+
+    // Espera entre vistazos a la cola del hilo de audio, que no puede despertar al
+    // hilo: corta mientras llegan mensajes suyos y larga cuando lleva un rato sin
+    // ninguno. Los del hilo de mensajes lo despiertan con notify()
+    constexpr int activeIntervalMs = 2;
+    constexpr int idleIntervalMs = 20;
+    constexpr double activeWindowMs = 250.0;
+}
+
+//==============================================================================
+HardwareMidiSender::HardwareMidiSender()
+    : juce::Thread("SparkLE MIDI Sender")
+{
+    batch.ensureSize(4096);
+}
+
+HardwareMidiSender::~HardwareMidiSender()
+{
+    stopThread(1000);
+
+    if (midiOutput != nullptr)
+        midiOutput->stopBackgroundThread();
+}
+
+void HardwareMidiSender::setOutputDevice(std::unique_ptr<juce::MidiOutput> newOutput)
+{
+    SPARKLE_NON_REALTIME_CALL("HardwareMidiSender::setOutputDevice");
+
+    // Detiene el hilo antes de cambiar el dispositivo que posee
+    stopThread(1000);
+
+    if (midiOutput != nullptr)
+        midiOutput->stopBackgroundThread();
+
+    midiOutput = std::move(newOutput);
+    hasDevice = (midiOutput != nullptr);
+
+    if (midiOutput != nullptr)
+    {
+        // sendBlockOfMessages necesita el hilo interno de MidiOutput para respetar los tiempos
+        midiOutput->startBackgroundThread();
+        startThread(juce::Thread::Priority::high);
+    }
+}
+
+bool HardwareMidiSender::pushFromAudioThread(const juce::MidiMessage& message, double timeMs)
+{
+    return push(audioQueue, message.getRawData(), message.getRawDataSize(), timeMs);
+}
+
+bool HardwareMidiSender::pushFromAudioThread(const juce::uint8* data, int size, double timeMs)
+{
+    return push(audioQueue, data, size, timeMs);
+}
+
+bool HardwareMidiSender::pushFromMessageThread(const juce::MidiMessage& message)
+{
+    if (!push(messageQueue, message.getRawData(), message.getRawDataSize(), juce::Time::getMillisecondCounterHiRes()))
+        return false;
+
+    // Sale ya aunque el hilo esté en la espera larga
+    notify();
+    return true;
+}
+
+template <typename QueueType>
+bool HardwareMidiSender::push(QueueType& queue, const juce::uint8* data, int size, double timeMs)
+{
+    // Sin dispositivo no tiene sentido llenar la cola
+    if (!hasDevice.load(std::memory_order_relaxed))
+        return false;
+
+    TimedMessage timed;
+    timed.timeMs = timeMs;
+    timed.size = juce::jlimit(0, TimedMessage::maxSize, size);
+    std::memcpy(timed.data, data, (size_t) timed.size);
+
+    if (!queue.push(timed))
+    {
+        droppedMessages.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    return true;
+}
+
+template <typename QueueType>
+int HardwareMidiSender::drainIntoBatch(QueueType& queue, double batchStartMs)
+{
+    int numMessages = 0;
+    TimedMessage timed;
+
+    while (queue.pop(timed))
+    {
+        // Lo que ya debería haber salido se envía al principio del lote
+        const auto delayMs = juce::jmax(0.0, timed.timeMs - batchStartMs);
+        const auto position = juce::roundToInt(delayMs * batchTicksPerSecond / 1000.0);
+
+        batch.addEvent(timed.data, timed.size, position);
+        ++numMessages;
+    }
+
+    return numMessages;
+}
+
+void HardwareMidiSender::run()
+{
+    auto lastAudioMessageMs = 0.0;
+
+    while (!threadShouldExit())
+    {
+        const auto batchStartMs = juce::Time::getMillisecondCounterHiRes();
+
+        batch.clear();
+        const auto numMessages = drainIntoBatch(messageQueue, batchStartMs);
+        const auto numAudioMessages = drainIntoBatch(audioQueue, batchStartMs);
+
+        if (numAudioMessages > 0)
+            lastAudioMessageMs = batchStartMs;
+
+        if (numMessages + numAudioMessages > 0)
+            midiOutput->sendBlockOfMessages(batch, batchStartMs, batchTicksPerSecond);
+        else
+            wait(batchStartMs - lastAudioMessageMs < activeWindowMs ? activeIntervalMs : idleIntervalMs);
+    }
+}
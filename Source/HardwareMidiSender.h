@@ -0,0 +1,75 @@
+#pragma once
+
+#include <juce_audio_devices/juce_audio_devices.h>
+#include <juce_core/juce_core.h>
+#include "LockFreeQueue.h"
+
+//==============================================================================
+/**
+ * Hilo dedicado que posee el dispositivo MIDI de salida del Spark LE.
+ *
+ * Las llamadas al driver USB pueden bloquear, así que nunca se hacen desde el hilo
+ * de audio: éste solo deja mensajes con su hora prevista en una cola sin bloqueos.
+ * El hilo los recoge por lotes y los entrega con sendBlockOfMessages para que
+ * salgan en su momento. Sin mensajes del hilo de audio espera más entre vistazos;
+ * los del hilo de mensajes lo despiertan al encolarse.
+ */
+class HardwareMidiSender : private juce::Thread
+{
+public:
+    HardwareMidiSender();
+    ~HardwareMidiSender() override;
+
+    // Cambia el dispositivo de salida. Solo desde el hilo de mensajes
+    void setOutputDevice(std::unique_ptr<juce::MidiOutput> newOutput);
+    bool hasOutputDevice() const { return hasDevice.load(); }
+
+    // Encola un mensaje desde el hilo de audio. timeMs usa la escala de
+    // juce::Time::getMillisecondCounterHiRes(). Nunca bloquea ni reserva memoria
+    bool pushFromAudioThread(const juce::MidiMessage& message, double timeMs);
+
+    // Igual, con los bytes ya preparados (evita crear un MidiMessage para SysEx)
+    bool pushFromAudioThread(const juce::uint8* data, int size, double timeMs);
+
+    // Encola un mensaje desde el hilo de mensajes para enviarlo cuanto antes
+    bool pushFromMessageThread(const juce::MidiMessage& message);
+
+    // Mensajes descartados porque la cola estaba llena
+    int getNumDroppedMessages() const { return droppedMessages.load(); }
+
+    // Mensajes del hilo de audio pendientes de enviar (llamar desde el hilo de audio)
+    int getAudioQueueDepth() const { return audioQueue.getNumReady(); }
+
+private:
+    struct TimedMessage
+    {
+        static constexpr int maxSize = 16;  // Suficiente para el SysEx de color
+
+        double timeMs = 0.0;
+        int size = 0;
+        juce::uint8 data[maxSize] = {};
+    };
+
+    static constexpr int audioQueueSize = 1024;
+    static constexpr int messageQueueSize = 256;
+
+    // Un productor por cola: hilo de audio y hilo de mensajes
+    LockFreeQueue<TimedMessage, audioQueueSize> audioQueue;
+    LockFreeQueue<TimedMessage, messageQueueSize> messageQueue;
+
+    std::unique_ptr<juce::MidiOutput> midiOutput;
+    std::atomic<bool> hasDevice { false };
+    std::atomic<int> droppedMessages { 0 };
+
+    juce::MidiBuffer batch;
+
+    void run() override;
+
+    template <typename QueueType>
+    bool push(QueueType& queue, const juce::uint8* data, int size, double timeMs);
+
+    template <typename QueueType>
+    int drainIntoBatch(QueueType& queue, double batchStartMs);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HardwareMidiSender)
+};
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+
+//==============================================================================
+/**
+ * Copia en memoria del estado de los LEDs del Spark LE.
+ *
+ * Guarda lo que se quiere mostrar y lo último que se envió al hardware, con una
+ * máscara de bits de pads pendientes. Solo los cambios reales salen por MIDI y,
+ * si un pad cambia varias veces dentro del mismo bloque, se envía únicamente su
+ * estado final. Pensada para usarse solo desde el hilo de audio.
+ */
+class LedStateCache
+{
+public:
+    static constexpr int maxLeds = 32;
+
+    explicit LedStateCache(int numLedsToUse)
+        : numLeds(juce::jlimit(0, maxLeds, numLedsToUse))
+    {
+        invalidateAll();
+    }
+
+    void setLed(int index, bool isOn, int sampleOffset)
+    {
+        if (!juce::isPositiveAndBelow(index, numLeds))
+            return;
+
+        wanted[(size_t) index].isOn = isOn;
+        changeOffsets[(size_t) index] = sampleOffset;
+        updateBit(onOffDirty, index, (onOffKnown & bit(index)) == 0 || sent[(size_t) index].isOn != isOn);
+    }
+
+    void setColour(int index, juce::uint8 red, juce::uint8 green, juce::uint8 blue, int sampleOffset)
+    {
+        if (!juce::isPositiveAndBelow(index, numLeds))
+            return;
+
+        auto& led = wanted[(size_t) index];
+        led.red = red;
+        led.green = green;
+        led.blue = blue;
+        led.hasColour = true;
+        changeOffsets[(size_t) index] = sampleOffset;
+
+        const auto& last = sent[(size_t) index];
+        updateBit(colourDirty, index, (colourKnown & bit(index)) == 0
+                                      || last.red != red || last.green != green || last.blue != blue);
+    }
+
+    // Olvida lo enviado y fuerza un refresco completo (p. ej. tras reconectar)
+    void invalidateAll()
+    {
+        onOffKnown = 0;
+        colourKnown = 0;
+        onOffDirty = 0;
+        colourDirty = 0;
+
+        for (int i = 0; i < numLeds; ++i)
+        {
+            changeOffsets[(size_t) i] = 0;
+            onOffDirty |= bit(i);
+
+            if (wanted[(size_t) i].hasColour)
+                colourDirty |= bit(i);
+        }
+    }
+
+    bool hasPendingChanges() const { return (onOffDirty | colourDirty) != 0; }
+
+    // Estado que se quiere mostrar, se haya enviado ya o no: un bit por pad encendido
+    // y el color como 0x00RRGGBB
+    juce::uint32 getWantedOnMask() const
+    {
+        juce::uint32 mask = 0;
+
+        for (int i = 0; i < numLeds; ++i)
+            if (wanted[(size_t) i].isOn)
+                mask |= bit(i);
+
+        return mask;
+    }
+
+    juce::uint32 getWantedColour(int index) const
+    {
+        if (!juce::isPositiveAndBelow(index, numLeds))
+            return 0;
+
+        const auto& led = wanted[(size_t) index];
+        return ((juce::uint32) led.red << 16) | ((juce::uint32) led.green << 8) | (juce::uint32) led.blue;
+    }
+
+    int getNumLeds() const { return numLeds; }
+
+    // Entrega los cambios pendientes y los marca como enviados.
+    // sendOnOff(index, isOn, sampleOffset); sendColour(index, r, g, b, sampleOffset)
+    template <typename SendOnOffFn, typename SendColourFn>
+    int flush(SendOnOffFn&& sendOnOff, SendColourFn&& sendColour)
+    {
+        int numSent = 0;
+
+        for (int i = 0; (onOffDirty | colourDirty) != 0 && i < numLeds; ++i)
+        {
+            const auto mask = bit(i);
+            const auto& led = wanted[(size_t) i];
+
+            if ((colourDirty & mask) != 0)
+            {
+                sendColour(i, led.red, led.green, led.blue, changeOffsets[(size_t) i]);
+                colourKnown |= mask;
+                colourDirty &= ~mask;
+                ++numSent;
+            }
+
+            if ((onOffDirty & mask) != 0)
+            {
+                sendOnOff(i, led.isOn, changeOffsets[(size_t) i]);
+                onOffKnown |= mask;
+                onOffDirty &= ~mask;
+                ++numSent;
+            }
+
+            sent[(size_t) i] = led;
+        }
+
+        return numSent;
+    }
+
+private:
+    struct LedState
+    {
+        bool isOn = false;
+        bool hasColour = false;
+        juce::uint8 red = 0, green = 0, blue = 0;
+    };
+
+    int numLeds;
+    std::array<LedState, maxLeds> wanted {}, sent {};
+    std::array<int, maxLeds> changeOffsets {};
+
+    // Bits por pad: pendiente de enviar / estado del hardware conocido
+    juce::uint32 onOffDirty = 0, colourDirty = 0;
+    juce::uint32 onOffKnown = 0, colourKnown = 0;
+
+    static juce::uint32 bit(int index) { return 1u << (juce::uint32) index; }
+
+    static void updateBit(juce::uint32& mask, int index, bool shouldBeSet)
+    {
+        if (shouldBeSet)
+            mask |= bit(index);
+        else
+            mask &= ~bit(index);
+    }
+};
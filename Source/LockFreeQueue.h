@@ -0,0 +1,56 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+
+//==============================================================================
+/**
+ * Cola sin bloqueos de un solo productor y un solo consumidor (SPSC).
+ *
+ * El almacenamiento es fijo, así que push() y pop() nunca reservan memoria ni
+ * bloquean: se pueden usar desde el hilo de audio.
+ */
+template <typename ElementType, int capacity>
+class LockFreeQueue
+{
+public:
+    LockFreeQueue() = default;
+
+    // Devuelve false si la cola está llena (el elemento se descarta)
+    bool push(const ElementType& element)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+        if (size1 + size2 < 1)
+            return false;
+
+        storage[(size_t) (size1 > 0 ? start1 : start2)] = element;
+        fifo.finishedWrite(1);
+        return true;
+    }
+
+    // Devuelve false si no había nada que leer
+    bool pop(ElementType& element)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(1, start1, size1, start2, size2);
+
+        if (size1 + size2 < 1)
+            return false;
+
+        element = storage[(size_t) (size1 > 0 ? start1 : start2)];
+        fifo.finishedRead(1);
+        return true;
+    }
+
+    int getNumReady() const     { return fifo.getNumReady(); }
+    int getFreeSpace() const    { return fifo.getFreeSpace(); }
+
+private:
+    // AbstractFifo deja siempre un hueco libre, de ahí el +1
+    juce::AbstractFifo fifo { capacity + 1 };
+    std::array<ElementType, (size_t) capacity + 1> storage {};
+
+    JUCE_DECLARE_NON_COPYABLE(LockFreeQueue)
+};
@@ -0,0 +1,121 @@
+#include "Metronome.h"
+
+namespace
+{
+    // Golpe corto: seno con un ataque de 1 ms y caída exponencial
+    void renderClick(float* destination, int numSamples, double sampleRate, double frequency, float gain)
+    {
+        const auto attackSamples = juce::jmax(1, (int) (0.001 * sampleRate));
+        const auto decay = std::exp(-6.0 / numSamples);   // -52 dB al final de la tabla
+        const auto phaseStep = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+        auto envelope = 1.0;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto attack = juce::jmin(1.0, i / (double) attackSamples);
+            destination[i] = gain * (float) (attack * envelope * std::sin(phaseStep * i));
+            envelope *= decay;
+        }
+    }
+}
+
+//==============================================================================
+void Metronome::prepare(double sampleRate)
+{
+    const auto numSamples = juce::jmax(1, (int) (clickSeconds * sampleRate));
+
+    tables.setSize(2, numSamples);
+    renderClick(tables.getWritePointer(normalTable), numSamples, sampleRate, 1000.0, 0.15f);
+    renderClick(tables.getWritePointer(accentTable), numSamples, sampleRate, 1500.0, 0.25f);
+
+    reset();
+}
+
+int Metronome::process(const SequencerClock::BlockTiming& timing)
+{
+    numBeats = 0;
+
+    if (!timing.isRunning || timing.ppqPerSample <= 0.0)
+    {
+        hasLastEnd = false;
+        return 0;
+    }
+
+    for (int i = 0; i < timing.numSegments; ++i)
+    {
+        const auto& segment = timing.segments[i];
+
+        // Igual que SequencerEngine: el tramo se queda con los beats hasta la
+        // posición de su último sample; los posteriores son del tramo siguiente.
+        // Un tramo continuo (el de una rampa o el primero de un bloque sin salto)
+        // sigue donde acabó el anterior, aunque el tempo haya cambiado entre medias
+        const auto shift = segment.ppqPerSample * (1.0 - 1.0e-9);
+        const auto end = segment.ppqEnd - shift;
+        const auto isContinuation = i > 0 ? segment.ppqStart == timing.segments[i - 1].ppqEnd
+                                          : hasLastEnd && !timing.hasJumped;
+        const auto start = isContinuation ? lastEnd : segment.ppqStart - shift;
+        lastEnd = end;
+
+        for (auto beat = (juce::int64) std::ceil(start); (double) beat < end; ++beat)
+            queueBeat(timing.sampleOffsetFor(segment, (double) beat), ((beat % beatsPerBar) + beatsPerBar) % beatsPerBar == 0);
+    }
+
+    hasLastEnd = timing.numSegments > 0;
+
+    return numBeats;
+}
+
+void Metronome::render(juce::AudioBuffer<float>& output, int numSamples)
+{
+    int start = 0;
+
+    for (int i = 0; i < numBeats; ++i)
+    {
+        const auto& beat = beats[(size_t) i];
+        const auto offset = juce::jlimit(start, numSamples, beat.sampleOffset);
+
+        // La cola del golpe anterior suena hasta el nuevo, que la sustituye
+        mix(output, start, offset);
+        start = offset;
+
+        playingTable = beat.isAccent ? accentTable : normalTable;
+        position = 0;
+    }
+
+    numBeats = 0;
+    mix(output, start, numSamples);
+}
+
+void Metronome::reset()
+{
+    playingTable = -1;
+    position = 0;
+    numBeats = 0;
+    hasLastEnd = false;
+}
+
+//==============================================================================
+void Metronome::queueBeat(int sampleOffset, bool isAccent)
+{
+    // Solo se llenaría con un bloque de varios segundos a un tempo altísimo
+    if (numBeats < maxBeatsPerBlock)
+        beats[(size_t) numBeats++] = { sampleOffset, isAccent };
+}
+
+void Metronome::mix(juce::AudioBuffer<float>& output, int startSample, int endSample)
+{
+    if (playingTable < 0 || endSample <= startSample)
+        return;
+
+    const auto numToMix = juce::jmin(endSample - startSample, tables.getNumSamples() - position);
+
+    for (int channel = 0; channel < output.getNumChannels(); ++channel)
+        juce::FloatVectorOperations::add(output.getWritePointer(channel, startSample),
+                                         tables.getReadPointer(playingTable, position),
+                                         numToMix);
+
+    position += numToMix;
+
+    if (position >= tables.getNumSamples())
+        playingTable = -1;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include "SequencerClock.h"
+
+//==============================================================================
+/**
+ * Metrónomo del secuenciador (hilo de audio, salvo prepare()).
+ *
+ * Los dos golpes (normal y acentuado) se sintetizan una sola vez en prepare(), al
+ * sample rate del dispositivo; en el bloque solo se copian escalados. Los beats se
+ * buscan con la misma regla que los pasos del secuenciador: cada uno cae en el
+ * primer sample que alcanza su posición y pertenece a un único bloque, así que
+ * suena una vez por beat y en el sample exacto, nunca una vez por bloque.
+ */
+class Metronome
+{
+public:
+    struct Beat
+    {
+        int sampleOffset = 0;
+        bool isAccent = false;          // Primer beat del compás
+    };
+
+    static constexpr int maxBeatsPerBlock = 16;
+    static constexpr int beatsPerBar = 4;
+    static constexpr double clickSeconds = 0.04;
+
+    Metronome() = default;
+
+    // Hilo de mensajes, con el audio parado: genera las tablas
+    void prepare(double sampleRate);
+
+    // Busca los beats del bloque y los apunta para render(). Devuelve cuántos hay
+    int process(const SequencerClock::BlockTiming& timing);
+    const Beat& getBeat(int index) const { return beats[(size_t) index]; }
+
+    // Suma a output los golpes apuntados y la cola del anterior
+    void render(juce::AudioBuffer<float>& output, int numSamples);
+
+    // Corta el golpe que estuviera sonando; la siguiente búsqueda empieza de nuevo
+    void reset();
+
+private:
+    static constexpr int normalTable = 0;
+    static constexpr int accentTable = 1;
+
+    juce::AudioBuffer<float> tables;    // Un canal por golpe
+    std::array<Beat, maxBeatsPerBlock> beats {};
+    int numBeats = 0;
+
+    int playingTable = -1;
+    int position = 0;
+
+    // Donde acabó la búsqueda del bloque anterior, para seguir desde ahí
+    bool hasLastEnd = false;
+    double lastEnd = 0.0;
+
+    void queueBeat(int sampleOffset, bool isAccent);
+    void mix(juce::AudioBuffer<float>& output, int startSample, int endSample);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Metronome)
+};
@@ -1,347 +1,1538 @@
 #include "MidiHandler.h"
+#include "RealtimeSafetyChecker.h"
+#include "AsyncLogger.h"
+#include "PluginParameters.h"
 
 //==============================================================================
 MidiHandler::MidiHandler()
-    : midiOutput(nullptr),
-      isPlaying(false),
-      bpm(120.0),
+    : dirtyPatterns(0),
       sampleRate(44100.0),
-      samplesPerBeat(0),
-      samplePosition(0),
-      currentStep(0),
-      lastTimeInSamples(0)
+      blockStartTimeMs(0.0),
+      pendingPreviews(0),
+      transportRunning(false),
+      currentMidiOutput(nullptr)
 {
-    juce::Logger::writeToLog("SparkLEPlugin: Inicializando MidiHandler");
+    SPARKLE_LOG_DEBUG("SparkLEPlugin: Inicializando MidiHandler");
+    
+    // Patrón inicial de ejemplo, compartido por el editor y el hilo de audio
+    auto& firstPattern = patternBank.patterns[0];
+    
+    for (int step : { 0, 4, 8, 12 })
+        firstPattern.setStep(0, step, true);
+    
+    for (int step : { 2, 6, 10, 14 })
+        firstPattern.setStep(2, step, true);
+    
+    // Todavía no hay hilo de audio: los patrones compilados se instalan directamente
+    for (int slot = 0; slot < PatternBank::numPatterns; ++slot)
+        engine.setPattern(slot, CompiledPattern::compile(patternBank.patterns[(size_t) slot]).release());
+    
+    inputMap = new MidiInputMap(inputMapEdit);
+    engine.setTelemetry(&telemetry);
+    samplePlayer.setStreamer(&sampleStreamer);
+    trackLevels.fill(1.0f);
+    
+    // El editor puede leer el estado antes del primer bloque
+    engineSnapshot.publish(lastPublished);
+    
+   #if ! SPARKLE_HEADLESS
+    // Acciones del controlador, golpes grabados y MIDI learn; empieza al ritmo lento
+    startTimer(idleTimerIntervalMs);
+    
+    // Busca el dispositivo Spark LE
+    try {
+        findSparkLEDevice();
+        SPARKLE_LOG_DEBUG("SparkLEPlugin: MidiHandler inicializado correctamente");
+    }
+    catch (const std::exception& e) {
+        SPARKLE_LOG_ERROR("SparkLEPlugin: Error en MidiHandler: " + juce::String(e.what()));
+    }
+   #endif
+}
+
+MidiHandler::~MidiHandler()
+{
+    // El hilo de envío se detiene y libera el dispositivo MIDI en su destructor
+    cancelPendingUpdate();
+    stopTimer();
+    
+    // El audio ya está parado: aplica lo pendiente para no perder patrones en la cola
+    processPendingCommands();
+    
+    for (int slot = 0; slot < PatternBank::numPatterns; ++slot)
+        delete engine.setPattern(slot, nullptr);
+    
+    // El hilo de lectura sigue vivo hasta que se destruya el streamer
+    for (int pad = 0; pad < SamplePlayer::numPads; ++pad)
+        if (auto* sample = samplePlayer.setSample(pad, nullptr))
+            sampleStreamer.deleteSample(sample);
+    
+    deleteRetiredPatterns();
+    deleteRetiredSamples();
+    deleteRetiredInputMaps();
+    delete inputMap;
+}
+
+void MidiHandler::prepareToPlay(double newSampleRate, int /*samplesPerBlock*/)
+{
+    sampleRate = newSampleRate;
+    
+    // El reloj conserva la posición musical aunque cambie el sample rate
+    clock.prepare(sampleRate);
+    samplePlayer.prepare(sampleRate);
+    metronome.prepare(sampleRate);
+    
+    // Los samples cargados están a otro sample rate: se vuelven a convertir en
+    // segundo plano (prepareToPlay puede llegar desde cualquier hilo)
+    if (preparedSampleRate.exchange(sampleRate) != sampleRate)
+    {
+        samplesNeedReload = true;
+        triggerAsyncUpdate();
+    }
+}
+
+void MidiHandler::releaseResources()
+{
+    // Detiene el secuenciador
+    stopSequencer();
+}
+
+void MidiHandler::processPendingCommands()
+{
+    // Hora de inicio del bloque, para fechar los mensajes al hardware
+    blockStartTimeMs = juce::Time::getMillisecondCounterHiRes();
+    
+    // Vacía la cola completa: los cambios se aplican enteros antes de generar el bloque
+    Command command;
+    
+    while (commandQueue.pop(command))
+        applyCommand(command);
+}
+
+void MidiHandler::processMidi(juce::MidiBuffer& midiMessages, int numSamples, juce::AudioPlayHead* playHead)
+{
+    numPadHits = 0;
+    numPadHitsPlayed = 0;
+    
+    // Entrada del controlador: una consulta a la tabla por mensaje, sin construir
+    // un MidiMessage
+    for (const auto metadata : midiMessages)
+    {
+        const auto source = MidiInputMap::getSource(metadata.data, metadata.numBytes);
+        
+        if (source < 0)
+            continue;
+        
+        // MIDI learn: la primera nota o CC pulsado se devuelve al editor en lugar de despacharse
+        if (midiLearnArmed)
+        {
+            if ((metadata.data[0] & 0xf0) != 0x80 && metadata.data[2] != 0)
+            {
+                learnedSource.store(source, std::memory_order_release);
+                messageThreadWorkQueued.store(true, std::memory_order_release);
+                midiLearnArmed = false;
+            }
+            
+            continue;
+        }
+        
+        const auto binding = inputMap->getBinding(source);
+        
+        if (binding.action != MidiInputMap::Action::none)
+            handleInputMessage(binding, metadata.data, metadata.samplePosition);
+    }
+    
+    // Automatización del host: tempo, swing, clicks y nivel y mute de cada pista
+    if (parameters != nullptr)
+        applyParameters(numSamples);
+    
+    // Avanza el reloj (host o interno) para este bloque
+    auto timing = clock.advance(numSamples, playHead);
+    
+    currentMidiOutput = &midiMessages;
+    notes.beginBlock(numSamples, timing.ppqPerSample > 0.0 ? timing.ppqPerSample
+                                                           : audioState.bpm / (60.0 * sampleRate));
+    
+    // Los pasos que un golpe grabado hacia delante dejó en silencio ya han pasado
+    if (suppressedTracks != 0 && timing.numSegments > 0)
+    {
+        for (int track = 0; track < Pattern::maxTracks; ++track)
+            if (timing.hasJumped || timing.segments[0].ppqStart > suppressUntilPpq[(size_t) track])
+                suppressedTracks &= ~(1u << track);
+    }
+    
+    // Arranque y parada del transporte: el del host si informa de su posición, el
+    // propio en Standalone
+    if (timing.isRunning != transportRunning)
+    {
+        transportRunning = timing.isRunning;
+        
+        if (transportRunning)
+            transportStarted();
+        else
+            transportStopped();
+    }
+    
+    // Previsualizaciones pedidas por el editor, al principio del bloque
+    if (pendingPreviews != 0)
+    {
+        notes.releaseUpTo(0, *this);
+        
+        for (int track = 0; pendingPreviews != 0; ++track, pendingPreviews >>= 1)
+        {
+            if ((pendingPreviews & 1u) != 0)
+                notes.startNote(track, 0, CompiledPattern::ppqPerStep, Pattern::defaultVelocity, *this);
+        }
+    }
+    
+    // Si el secuenciador está activo, genera los eventos de cada paso en su sample exacto
+    if (timing.isRunning)
+    {
+        // El motor recorre el patrón compilado y llama a stepTriggered por cada paso
+        engine.process(timing, *this);
+        
+        updatePlayheads();
+        
+        if (audioState.isRecording && numPadHits > 0)
+            recordPadHits(timing);
+        
+        // Metrónomo: un golpe por beat, en su sample exacto
+        if (audioState.clickEnabled)
+        {
+            const auto numBeats = metronome.process(timing);
+            
+            if (audioState.midiClickEnabled)
+            {
+                for (int i = 0; i < numBeats; ++i)
+                {
+                    // Wood blocks del mapa GM: agudo en el primer beat del compás
+                    const auto& beat = metronome.getBeat(i);
+                    const auto clickNote = beat.isAccent ? 76 : 77;
+                    
+                    midiMessages.addEvent(juce::MidiMessage::noteOn(10, clickNote, (juce::uint8) (beat.isAccent ? 127 : 100)),
+                                          beat.sampleOffset);
+                    
+                    // En percusión la duración no importa: el Note Off va al final del bloque
+                    midiMessages.addEvent(juce::MidiMessage::noteOff(10, clickNote), numSamples - 1);
+                }
+            }
+        }
+        else
+        {
+            // Al volver a activarlo, la búsqueda de beats empieza en ese bloque
+            metronome.reset();
+        }
+    }
+    
+    // Golpes de pad posteriores al último paso del bloque (o todos, con el transporte parado)
+    playPadHitsUpTo(numSamples);
+    
+    // Note Offs que vencen dentro de este bloque, aunque se programaran en otro anterior
+    notes.endBlock(*this);
+    currentMidiOutput = nullptr;
+    
+    // Envía al hardware solo los LEDs que han cambiado en este bloque
+    flushLEDs();
+    telemetry.recordSendQueueDepth(hardwareSender.getAudioQueueDepth());
+    
+    // Transporte y LEDs para el editor; se publican en renderSamples con los picos
+    nextSnapshot.isPlaying = timing.isRunning;
+    nextSnapshot.bpm = timing.bpm;
+    
+    if (timing.numSegments > 0)
+        nextSnapshot.ppqPosition = timing.segments[0].ppqStart;
+    
+    nextSnapshot.ledsOn = ledCache.getWantedOnMask();
+    
+    for (int pad = 0; pad < ledCache.getNumLeds(); ++pad)
+        nextSnapshot.ledColours[(size_t) pad] = ledCache.getWantedColour(pad);
+}
+
+void MidiHandler::startSequencer()
+{
+    if (!editState.isPlaying)
+    {
+        editState.isPlaying = true;
+        pushCommand({ Command::Type::start });
+    }
+}
+
+void MidiHandler::stopSequencer()
+{
+    if (editState.isPlaying)
+    {
+        editState.isPlaying = false;
+        pushCommand({ Command::Type::stop });
+    }
+}
+
+void MidiHandler::transportStarted()
+{
+    nextSnapshot.currentStep = 0;
+    nextSnapshot.trackPlayheads.fill(0);
+    
+    // El motor se recoloca en la posición del primer bloque
+    engine.reset();
+    
+    // Cada toma empieza con todas las pistas por reemplazar
+    replacedTracks = 0;
+}
+
+void MidiHandler::transportStopped()
+{
+    metronome.reset();
+    
+    // Se cortan las notas que quedaban sonando, en el plugin y en el hardware
+    notes.releaseAll(0, *this);
+    suppressedTracks = 0;
     
-    // Inicializa la matriz de pasos a false
     for (int pad = 0; pad < maxPads; ++pad)
+        queueLED(pad, false, 0);
+}
+
+void MidiHandler::setTempo(double newBpm)
+{
+    editState.bpm = newBpm;
+    
+    Command command { Command::Type::setTempo };
+    command.value = newBpm;
+    pushCommand(command);
+}
+
+void MidiHandler::setRecording(bool shouldRecord)
+{
+    editState.isRecording = shouldRecord;
+    
+    Command command { Command::Type::setRecording };
+    command.flag = shouldRecord;
+    pushCommand(command);
+}
+
+void MidiHandler::setQuantiseStrength(int percent)
+{
+    editState.quantiseStrength = juce::jlimit(0, 100, percent);
+    
+    Command command { Command::Type::setQuantiseStrength };
+    command.pad = editState.quantiseStrength;
+    pushCommand(command);
+}
+
+void MidiHandler::setRecordMode(RecordMode mode)
+{
+    editState.recordMode = mode;
+    
+    Command command { Command::Type::setRecordMode };
+    command.flag = mode == RecordMode::replace;
+    pushCommand(command);
+}
+
+void MidiHandler::setClickEnabled(bool shouldBeEnabled)
+{
+    editState.clickEnabled = shouldBeEnabled;
+    
+    Command command { Command::Type::setClick };
+    command.flag = shouldBeEnabled;
+    pushCommand(command);
+}
+
+void MidiHandler::setMidiClickEnabled(bool shouldBeEnabled)
+{
+    editState.midiClickEnabled = shouldBeEnabled;
+    
+    Command command { Command::Type::setMidiClick };
+    command.flag = shouldBeEnabled;
+    pushCommand(command);
+}
+
+bool MidiHandler::pushCommand(const Command& command)
+{
+    // La cola solo tiene un productor: el hilo de mensajes
+    SPARKLE_NON_REALTIME_CALL("MidiHandler::pushCommand");
+    
+    // La cola es grande de sobra para el ritmo de edición del editor; si se llenara
+    // el hilo de audio no está procesando y el cambio se perdería
+    if (!commandQueue.push(command))
+    {
+        jassertfalse;
+        SPARKLE_LOG_ERROR("SparkLEPlugin: Cola de comandos llena, cambio descartado");
+        return false;
+    }
+    
+    return true;
+}
+
+template <typename QueueType, typename PointerType>
+void MidiHandler::retire(QueueType& queue, PointerType* pointer)
+{
+    // Nunca se libera memoria en el hilo de audio: se devuelve al hilo de mensajes.
+    // Si la cola se llenara se perdería memoria: el hilo de mensajes no la está vaciando
+    if (pointer != nullptr && !queue.push(pointer))
+        jassertfalse;
+}
+
+void MidiHandler::applyCommand(const Command& command)
+{
+    switch (command.type)
+    {
+        case Command::Type::setTempo:
+            audioState.bpm = command.value;
+            
+            // Tempo del reloj interno (el host manda cuando está reproduciendo)
+            clock.setTempo(audioState.bpm);
+            break;
+            
+        case Command::Type::setSwing:
+            audioState.swing = command.pad;
+            engine.setSwing(audioState.swing);
+            break;
+            
+        case Command::Type::setClick:
+            audioState.clickEnabled = command.flag;
+            break;
+            
+        case Command::Type::setMidiClick:
+            audioState.midiClickEnabled = command.flag;
+            break;
+            
+        case Command::Type::setLed:
+            ledCache.setLed(command.pad, command.flag, 0);
+            break;
+            
+        case Command::Type::setPadColour:
+        {
+            // Convertir el color a componentes RGB (0-127)
+            const juce::Colour color(command.argb);
+            ledCache.setColour(command.pad,
+                               static_cast<juce::uint8>(color.getRed() >> 1),
+                               static_cast<juce::uint8>(color.getGreen() >> 1),
+                               static_cast<juce::uint8>(color.getBlue() >> 1),
+                               0);
+            break;
+        }
+            
+        case Command::Type::resyncLeds:
+            ledCache.invalidateAll();
+            break;
+            
+        case Command::Type::start:
+            // El arranque en sí se atiende en processMidi, igual que el del host
+            if (!audioState.isPlaying)
+            {
+                audioState.isPlaying = true;
+                clock.start();
+            }
+            break;
+            
+        case Command::Type::stop:
+            if (audioState.isPlaying)
+            {
+                audioState.isPlaying = false;
+                clock.stop();
+            }
+            break;
+            
+        case Command::Type::installPattern:
+            retirePattern(engine.setPattern(command.pad, command.compiledPattern));
+            break;
+            
+        case Command::Type::selectPattern:
+            engine.selectPattern(command.pad);
+            
+            // Parado, el cambio es inmediato
+            if (!transportRunning)
+                engine.reset();
+            break;
+            
+        case Command::Type::setChainEntry:
+            engine.setChainEntry(command.pad, command.step);
+            break;
+            
+        case Command::Type::setChainLength:
+            engine.setChainLength(command.pad);
+            break;
+            
+        case Command::Type::setSongMode:
+            engine.setSongMode(command.flag);
+            break;
+            
+        case Command::Type::previewTrack:
+            // Se toca en processMidi, que es donde está el buffer de salida
+            pendingPreviews |= 1u << command.pad;
+            break;
+            
+        case Command::Type::installSample:
+            retire(retiredSamples, samplePlayer.setSample(command.pad, command.sample));
+            break;
+            
+        case Command::Type::installKit:
+            // El kit se lleva de vuelta los samples sustituidos
+            for (int pad = 0; pad < SamplePlayer::numPads; ++pad)
+                command.kit->samples[(size_t) pad] = samplePlayer.setSample(pad, command.kit->samples[(size_t) pad]);
+            
+            retire(retiredKits, command.kit);
+            break;
+            
+        case Command::Type::installBank:
+        {
+            // Todo el banco cambia en el mismo bloque; los compilados sustituidos vuelven con él
+            auto& update = *command.bank;
+            
+            for (int slot = 0; slot < PatternBank::numPatterns; ++slot)
+                update.patterns[(size_t) slot] = engine.setPattern(slot, update.patterns[(size_t) slot]);
+            
+            for (int i = 0; i < update.chainLength; ++i)
+                engine.setChainEntry(i, update.chain[(size_t) i]);
+            
+            engine.setChainLength(update.chainLength);
+            engine.setSongMode(update.songMode);
+            engine.selectPattern(update.selectedPattern);
+            
+            if (!transportRunning)
+                engine.reset();
+            
+            retire(retiredBanks, command.bank);
+            break;
+        }
+            
+        case Command::Type::installInputMap:
+            retire(retiredInputMaps, inputMap);
+            
+            inputMap = command.inputMap;
+            break;
+            
+        case Command::Type::setMidiLearn:
+            midiLearnArmed = command.flag;
+            break;
+            
+        case Command::Type::setRecording:
+            audioState.isRecording = command.flag;
+            replacedTracks = 0;
+            break;
+            
+        case Command::Type::setQuantiseStrength:
+            audioState.quantiseStrength = command.pad;
+            break;
+            
+        case Command::Type::setRecordMode:
+            audioState.recordMode = command.flag ? RecordMode::replace : RecordMode::overdub;
+            break;
+    }
+}
+
+void MidiHandler::retirePattern(const CompiledPattern* compiled)
+{
+    retire(retiredPatterns, compiled);
+}
+
+void MidiHandler::deleteRetiredPatterns()
+{
+    const CompiledPattern* compiled = nullptr;
+    
+    while (retiredPatterns.pop(compiled))
+        delete compiled;
+    
+    BankUpdate* update = nullptr;
+    
+    while (retiredBanks.pop(update))
+        deleteBankUpdate(update);
+}
+
+void MidiHandler::deleteBankUpdate(BankUpdate* update)
+{
+    for (auto* compiled : update->patterns)
+        delete compiled;
+    
+    delete update;
+}
+
+void MidiHandler::handleAsyncUpdate()
+{
+    compilePendingPatterns();
+    deleteRetiredSamples();
+    
+    // Se recargan como kit para que todos los pads cambien en el mismo bloque
+    if (samplesNeedReload.exchange(false))
+    {
+        juce::Array<juce::File> files;
+        
+        for (const auto& file : sampleFiles)
+            files.add(file);
+        
+        loadKit(files);
+    }
+}
+
+//==============================================================================
+void MidiHandler::handleInputMessage(MidiInputMap::Binding binding, const juce::uint8* data, int sampleOffset)
+{
+    // Un CC cuenta como pulsado por encima de 63, como los botones del Spark LE
+    const auto isController = (data[0] & 0xf0) == 0xb0;
+    const auto value = (int) data[2];
+    const auto isPress = isController ? value >= 64 : ((data[0] & 0xf0) == 0x90 && value > 0);
+    
+    switch (binding.action)
     {
-        for (int step = 0; step < maxSteps; ++step)
+        case MidiInputMap::Action::padTrigger:
+            // El pad suena (y enciende su LED) al empezar la nota, en orden con los pasos
+            // del patrón; si llegaran más golpes de los que caben se descartan
+            if (isPress && juce::isPositiveAndBelow((int) binding.argument, Pattern::maxTracks)
+                && numPadHits < maxPadHitsPerBlock)
+            {
+                padHits[(size_t) numPadHits++] = { binding.argument, sampleOffset, value };
+            }
+            break;
+            
+        case MidiInputMap::Action::tempoNudge:
         {
-            sequencerSteps[pad][step] = false;
+            // Un CC es relativo en complemento a dos (1-63 sube, 65-127 baja), como la rueda de jog
+            const auto amount = isController ? (value < 64 ? value : value - 128) : (isPress ? 1 : 0);
+            
+            if (amount != 0)
+            {
+                controllerActions.push({ binding, amount });
+                messageThreadWorkQueued.store(true, std::memory_order_release);
+            }
+            break;
         }
+            
+        case MidiInputMap::Action::none:
+        case MidiInputMap::Action::numActions:
+            break;
+            
+        default:
+            // Si la cola se llenara se pierde la pulsación, nunca se espera
+            if (isPress)
+            {
+                controllerActions.push({ binding, 1 });
+                messageThreadWorkQueued.store(true, std::memory_order_release);
+            }
+            break;
     }
+}
+
+void MidiHandler::applyControllerAction(const ControllerAction& action)
+{
+    const auto argument = (int) action.binding.argument;
     
-    // Busca el dispositivo Spark LE
-    try {
-        findSparkLEDevice();
-        juce::Logger::writeToLog("SparkLEPlugin: MidiHandler inicializado correctamente");
+    switch (action.binding.action)
+    {
+        case MidiInputMap::Action::muteTrack:
+            // El mute solo existe como parámetro del host
+            if (parameters != nullptr)
+                parameters->toggleTrackMute(argument);
+            break;
+            
+        case MidiInputMap::Action::selectPattern:
+            selectPattern(argument);
+            break;
+            
+        case MidiInputMap::Action::tempoNudge:
+            if (parameters != nullptr)
+                parameters->nudgeTempo(argument * action.amount);
+            else
+                setTempo(juce::jlimit((double) PluginParameters::minTempo, (double) PluginParameters::maxTempo,
+                                      editState.bpm + argument * action.amount));
+            break;
+            
+        case MidiInputMap::Action::toggleTransport:
+            if (editState.isPlaying)
+                stopSequencer();
+            else
+                startSequencer();
+            break;
+            
+        case MidiInputMap::Action::startTransport:
+            startSequencer();
+            break;
+            
+        case MidiInputMap::Action::stopTransport:
+            stopSequencer();
+            break;
+            
+        case MidiInputMap::Action::toggleRecording:
+            setRecording(!editState.isRecording);
+            break;
+            
+        case MidiInputMap::Action::none:
+        case MidiInputMap::Action::padTrigger:
+        case MidiInputMap::Action::numActions:
+            break;
     }
-    catch (const std::exception& e) {
-        juce::Logger::writeToLog("SparkLEPlugin ERROR en MidiHandler: " + juce::String(e.what()));
+}
+
+void MidiHandler::setInputMap(const MidiInputMap& map)
+{
+    inputMapEdit = map;
+    installInputMap();
+}
+
+void MidiHandler::installInputMap()
+{
+    SPARKLE_NON_REALTIME_CALL("MidiHandler::installInputMap");
+    deleteRetiredInputMaps();
+    
+    Command command { Command::Type::installInputMap };
+    command.inputMap = new MidiInputMap(inputMapEdit);
+    
+    if (!pushCommand(command))
+        delete command.inputMap;
+}
+
+void MidiHandler::deleteRetiredInputMaps()
+{
+    const MidiInputMap* map = nullptr;
+    
+    while (retiredInputMaps.pop(map))
+        delete map;
+}
+
+void MidiHandler::beginMidiLearn(MidiInputMap::Binding binding)
+{
+    learnTarget = binding;
+    learnedSource.store(-1);
+    
+    Command command { Command::Type::setMidiLearn };
+    command.flag = isMidiLearnActive();
+    pushCommand(command);
+}
+
+void MidiHandler::cancelMidiLearn()
+{
+    beginMidiLearn({});
+}
+
+void MidiHandler::timerCallback()
+{
+    // Ritmo rápido mientras llega trabajo o se espera un MIDI learn, lento en reposo
+    if (messageThreadWorkQueued.exchange(false, std::memory_order_acquire) || isMidiLearnActive())
+    {
+        quietTicks = 0;
+        
+        if (getTimerInterval() != activeTimerIntervalMs)
+            startTimer(activeTimerIntervalMs);
+    }
+    else if (++quietTicks >= activeTicksBeforeIdle && getTimerInterval() != idleTimerIntervalMs)
+    {
+        startTimer(idleTimerIntervalMs);
+    }
+    
+    ControllerAction action;
+    
+    while (controllerActions.pop(action))
+        applyControllerAction(action);
+    
+    // Notas grabadas desde los pads: se escriben en el patrón y se recompila enseguida
+    RecordedHit hit;
+    bool hasRecordedHits = false;
+    
+    while (recordedHits.pop(hit))
+    {
+        applyRecordedHit(hit);
+        hasRecordedHits = true;
+    }
+    
+    if (hasRecordedHits)
+        compilePendingPatterns();
+    
+    const auto source = learnedSource.exchange(-1, std::memory_order_acquire);
+    
+    if (source >= 0 && isMidiLearnActive())
+    {
+        SPARKLE_LOG_INFO("SparkLEPlugin: MIDI learn asignado a " + MidiInputMap::describeSource(source));
+        
+        inputMapEdit.removeBinding(learnTarget);
+        inputMapEdit.setBinding(source, learnTarget);
+        learnTarget = {};
+        installInputMap();
+    }
+    
+    deleteRetiredInputMaps();
+}
+
+//==============================================================================
+void MidiHandler::loadSample(int pad, const juce::File& file)
+{
+    if (!juce::isPositiveAndBelow(pad, SamplePlayer::numPads))
+        return;
+    
+    sampleFiles[(size_t) pad] = file;
+    
+    // Sin prepareToPlay todavía se carga al rate por defecto; se reconvertirá al preparar
+    const auto rate = preparedSampleRate.load();
+    sampleLoader.load(pad, file, rate > 0.0 ? rate : sampleRate);
+}
+
+void MidiHandler::sampleLoaded(int pad, const juce::File& file, std::unique_ptr<LoadedSample> sample)
+{
+    // Llega tarde una carga que ya se ha sustituido por otro fichero
+    if (file != sampleFiles[(size_t) pad])
+        return;
+    
+    if (sample == nullptr)
+    {
+        SPARKLE_LOG_ERROR("SparkLEPlugin: No se pudo cargar el sample " + file.getFullPathName());
+        return;
+    }
+    
+    SPARKLE_LOG_INFO("SparkLEPlugin: Sample cargado en el pad " + juce::String(pad + 1) + ": " + sample->name);
+    installSample(pad, std::move(sample));
+}
+
+void MidiHandler::installSample(int pad, std::unique_ptr<LoadedSample> sample)
+{
+    if (!juce::isPositiveAndBelow(pad, SamplePlayer::numPads))
+        return;
+    
+    deleteRetiredSamples();
+    sampleStreamer.prepareToStream(sample.get());
+    sampleNames[(size_t) pad] = sample != nullptr ? sample->name : juce::String();
+    
+    Command command { Command::Type::installSample };
+    command.pad = pad;
+    command.sample = sample.get();
+    
+    if (pushCommand(command))
+        sample.release();
+}
+
+void MidiHandler::loadKit(const juce::Array<juce::File>& files)
+{
+    // Los pads pasan ya a apuntar al kit nuevo: las cargas sueltas pendientes se descartan
+    for (int pad = 0; pad < SamplePlayer::numPads; ++pad)
+        sampleFiles[(size_t) pad] = pad < files.size() ? files[pad] : juce::File();
+    
+    pendingKitFiles = files;
+    
+    const auto rate = preparedSampleRate.load();
+    sampleLoader.loadKit(files, rate > 0.0 ? rate : sampleRate);
+}
+
+void MidiHandler::kitLoaded(const juce::Array<juce::File>& files, std::vector<std::unique_ptr<LoadedSample>> samples)
+{
+    // Llega tarde un kit que ya se ha sustituido por otro
+    if (files != pendingKitFiles)
+        return;
+    
+    pendingKitFiles.clear();
+    deleteRetiredSamples();
+    
+    auto kit = std::make_unique<SampleKit>();
+    
+    for (int pad = 0; pad < SamplePlayer::numPads; ++pad)
+    {
+        auto* sample = pad < (int) samples.size() ? samples[(size_t) pad].release() : nullptr;
+        
+        if (sample == nullptr && sampleFiles[(size_t) pad] != juce::File())
+            SPARKLE_LOG_ERROR("SparkLEPlugin: No se pudo cargar el sample " + sampleFiles[(size_t) pad].getFullPathName());
+        
+        sampleStreamer.prepareToStream(sample);
+        kit->samples[(size_t) pad] = sample;
+        sampleNames[(size_t) pad] = sample != nullptr ? sample->name : juce::String();
     }
+    
+    SPARKLE_LOG_INFO("SparkLEPlugin: Kit cargado (" + juce::String(files.size()) + " ficheros)");
+    
+    Command command { Command::Type::installKit };
+    command.kit = kit.get();
+    
+    if (pushCommand(command))
+        kit.release();
+    else
+        deleteSampleKit(kit.release());
 }
 
-MidiHandler::~MidiHandler()
+void MidiHandler::deleteSampleKit(SampleKit* kit)
+{
+    for (auto* sample : kit->samples)
+        sampleStreamer.deleteSample(sample);
+    
+    delete kit;
+}
+
+juce::String MidiHandler::getSampleName(int pad) const
 {
-    // Ya no necesitamos limpiar explícitamente el midiOutput
-    // unique_ptr se encargará de la liberación automáticamente
+    return juce::isPositiveAndBelow(pad, SamplePlayer::numPads) ? sampleNames[(size_t) pad] : juce::String();
 }
 
-void MidiHandler::prepareToPlay(double newSampleRate, int /*samplesPerBlock*/)
+void MidiHandler::deleteRetiredSamples()
 {
-    sampleRate = newSampleRate;
+    const LoadedSample* sample = nullptr;
+    
+    while (retiredSamples.pop(sample))
+        sampleStreamer.deleteSample(sample);
     
-    // Calcula muestras por beat (para un compás 4/4 a la velocidad actual)
-    samplesPerBeat = static_cast<int>((60.0 / bpm) * sampleRate);
+    SampleKit* kit = nullptr;
+    
+    while (retiredKits.pop(kit))
+        deleteSampleKit(kit);
 }
 
-void MidiHandler::releaseResources()
+void MidiHandler::renderSamples(juce::AudioBuffer<float>& buffer)
 {
-    // Detiene el secuenciador
-    stopSequencer();
+    samplePlayer.render(buffer, buffer.getNumSamples());
+    metronome.render(buffer, buffer.getNumSamples());
+    
+    publishSnapshot(buffer);
 }
 
-void MidiHandler::processMidi(juce::MidiBuffer& midiMessages)
+void MidiHandler::publishSnapshot(const juce::AudioBuffer<float>& buffer)
 {
-    // Procesa mensajes MIDI entrantes
-    for (const auto metadata : midiMessages)
+    for (int channel = 0; channel < EngineSnapshot::maxMeterChannels; ++channel)
     {
-        auto message = metadata.getMessage();
-        
-        // Procesa los mensajes según sea necesario
-        // Por ejemplo, detectar mensajes específicos del Spark LE
-        if (message.isNoteOn())
-        {
-            // Procesa nota activada
-            int noteNumber = message.getNoteNumber();
-            int velocity = message.getVelocity();
-            
-            // Mapea a pad si es necesario
-            // Por ejemplo, si la nota está en el rango de los pads del Spark
-            if (noteNumber >= SparkLEMidi::padNoteOffset && 
-                noteNumber < SparkLEMidi::padNoteOffset + maxPads)
-            {
-                int padIndex = noteNumber - SparkLEMidi::padNoteOffset;
-                // Enciende el LED correspondiente
-                setLED(padIndex, true);
-            }
-        }
-        else if (message.isNoteOff())
-        {
-            // Procesa nota desactivada
-            int noteNumber = message.getNoteNumber();
-            
-            if (noteNumber >= SparkLEMidi::padNoteOffset && 
-                noteNumber < SparkLEMidi::padNoteOffset + maxPads)
-            {
-                int padIndex = noteNumber - SparkLEMidi::padNoteOffset;
-                // Apaga el LED correspondiente
-                setLED(padIndex, false);
-            }
-        }
-        else if (message.isController())
-        {
-            // Procesa mensajes de control change
-            int controllerNumber = message.getControllerNumber();
-            int value = message.getControllerValue();
-            
-            // Aquí podrías responder a los controles específicos del Spark LE
-            // ...
-        }
+        nextSnapshot.outputPeaks[(size_t) channel] = channel < buffer.getNumChannels()
+            ? buffer.getMagnitude(channel, 0, buffer.getNumSamples()) : 0.0f;
     }
     
-    // Si el secuenciador está activo, avanza y genera eventos MIDI
-    if (isPlaying)
+    // Parado y en silencio no cambia nada: la versión se queda igual y el editor
+    // no tiene que repintar
+    if (nextSnapshot.hasSameContent(lastPublished))
+        return;
+    
+    nextSnapshot.version = lastPublished.version + 1;
+    engineSnapshot.publish(nextSnapshot);
+    lastPublished = nextSnapshot;
+}
+
+void MidiHandler::compilePendingPatterns()
+{
+    SPARKLE_NON_REALTIME_CALL("MidiHandler::compilePendingPatterns");
+    deleteRetiredPatterns();
+    
+    for (int slot = 0; slot < PatternBank::numPatterns; ++slot)
     {
-        // En modo standalone, necesitamos manejar nuestro propio timing
-        if (lastTimeInSamples == 0)
-        {
-            // Primera vez, inicializa el tiempo
-            lastTimeInSamples = juce::Time::getHighResolutionTicks();
-        }
+        const auto bit = 1u << slot;
+        
+        if ((dirtyPatterns & bit) == 0)
+            continue;
+        
+        Command command { Command::Type::installPattern };
+        command.pad = slot;
+        command.compiledPattern = CompiledPattern::compile(patternBank.patterns[(size_t) slot]).release();
+        
+        if (pushCommand(command))
+            dirtyPatterns &= ~bit;
         else
-        {
-            // Calcula el tiempo transcurrido en samples
-            juce::int64 currentTime = juce::Time::getHighResolutionTicks();
-            double elapsedTimeMs = juce::Time::highResolutionTicksToSeconds(currentTime - lastTimeInSamples) * 1000.0;
-            lastTimeInSamples = currentTime;
-            
-            // Convierte el tiempo transcurrido a samples (basado en sample rate)
-            int elapsedSamples = static_cast<int>(elapsedTimeMs * sampleRate / 1000.0);
-            
-            // Avanza el secuenciador con el tiempo transcurrido
-            advanceSequencer(elapsedSamples);
-            
-            // Dispara los eventos MIDI para el paso actual
-            triggerCurrentStep();
-        }
+            delete command.compiledPattern;
+    }
+}
+
+void MidiHandler::selectPattern(int patternIndex)
+{
+    if (juce::isPositiveAndBelow(patternIndex, PatternBank::numPatterns))
+    {
+        patternBank.selectedPattern = patternIndex;
         
-        // Genera un click si está habilitado y estamos en un beat principal
-        if (clickEnabled && currentStep % 4 == 0)
-        {
-            // Añadir una nota MIDI para el click
-            int clickNote = 37; // Generalmente un sonido de caja o palmas
-            auto message = juce::MidiMessage::noteOn(10, clickNote, (juce::uint8)100);
-            midiMessages.addEvent(message, 0);
-            
-            // Programar el note off
-            auto noteOff = juce::MidiMessage::noteOff(10, clickNote);
-            midiMessages.addEvent(noteOff, 10); // Después de 10 samples
-        }
+        Command command { Command::Type::selectPattern };
+        command.pad = patternIndex;
+        pushCommand(command);
     }
 }
 
-void MidiHandler::startSequencer()
+void MidiHandler::getSessionState(StateSerializer::State& state) const
 {
-    if (!isPlaying)
+    static_assert(StateSerializer::maxPads == SamplePlayer::numPads, "Un fichero por pad");
+    
+    state.bank = patternBank;
+    state.bpm = editState.bpm;
+    state.swing = editState.swing;
+    state.clickEnabled = editState.clickEnabled;
+    state.midiClickEnabled = editState.midiClickEnabled;
+    
+    for (int pad = 0; pad < SamplePlayer::numPads; ++pad)
+        state.sampleFiles[(size_t) pad] = sampleFiles[(size_t) pad].getFullPathName();
+    
+    state.inputMap = inputMapEdit;
+}
+
+void MidiHandler::restoreSessionState(const StateSerializer::State& state)
+{
+    SPARKLE_NON_REALTIME_CALL("MidiHandler::restoreSessionState");
+    deleteRetiredPatterns();
+    
+    setTempo(state.bpm);
+    setSwing(state.swing);
+    setClickEnabled(state.clickEnabled);
+    setMidiClickEnabled(state.midiClickEnabled);
+    setInputMap(state.inputMap);
+    
+    // El banco nuevo sustituye a las ediciones que quedaran por compilar
+    patternBank = state.bank;
+    dirtyPatterns = 0;
+    
+    auto update = std::make_unique<BankUpdate>();
+    
+    for (int slot = 0; slot < PatternBank::numPatterns; ++slot)
+        update->patterns[(size_t) slot] = CompiledPattern::compile(patternBank.patterns[(size_t) slot]).release();
+    
+    update->chain = patternBank.chain;
+    update->chainLength = patternBank.chainLength;
+    update->songMode = patternBank.songMode;
+    update->selectedPattern = patternBank.selectedPattern;
+    
+    Command command { Command::Type::installBank };
+    command.bank = update.get();
+    
+    if (pushCommand(command))
+        update.release();
+    else
+        deleteBankUpdate(update.release());
+    
+    // Los samples se vuelven a cargar como kit, con los pads vacíos en su sitio
+    juce::Array<juce::File> files;
+    bool filesChanged = false;
+    
+    for (int pad = 0; pad < SamplePlayer::numPads; ++pad)
     {
-        isPlaying = true;
-        currentStep = 0;
-        samplePosition = 0;
+        const auto& path = state.sampleFiles[(size_t) pad];
+        files.add(juce::File::isAbsolutePath(path) ? juce::File(path) : juce::File());
+        filesChanged = filesChanged || files.getLast() != sampleFiles[(size_t) pad];
     }
+    
+    if (filesChanged)
+        loadKit(files);
 }
 
-void MidiHandler::stopSequencer()
+juce::MidiFile MidiHandler::renderToMidiFile(const PatternRenderer::Settings& settings) const
 {
-    if (isPlaying)
+    // Swing, nivel y mute de cada pista, los mismos que sonarían en vivo
+    auto sessionSettings = settings;
+    sessionSettings.swing = parameters != nullptr ? parameters->getSwing() : editState.swing;
+    sessionSettings.trackLevels.fill(1.0f);
+    sessionSettings.mutedTracks = 0;
+    
+    if (parameters != nullptr)
     {
-        isPlaying = false;
-        
-        // Envía Note Off para todos los pads activos
-        for (int pad = 0; pad < maxPads; ++pad)
+        for (int track = 0; track < Pattern::maxTracks; ++track)
         {
-            sendNoteOff(SparkLEMidi::padNoteOffset + pad);
-            setLED(pad, false);
+            sessionSettings.trackLevels[(size_t) track] = parameters->getTrackLevel(track);
+            
+            if (parameters->isTrackMuted(track))
+                sessionSettings.mutedTracks |= 1u << track;
         }
     }
+    
+    return PatternRenderer::render(patternBank, sessionSettings);
 }
 
-void MidiHandler::setTempo(double newBpm)
+int MidiHandler::getPlayingPattern() const
 {
-    bpm = newBpm;
-    
-    // Recalcula muestras por beat
-    samplesPerBeat = static_cast<int>((60.0 / bpm) * sampleRate);
+    EngineSnapshot snapshot;
+    getEngineSnapshot(snapshot);
+    return snapshot.playingPattern;
 }
 
-void MidiHandler::sendNoteOn(int noteNumber, int velocity, int channel)
+void MidiHandler::setSongChain(const juce::Array<int>& patternIndices)
 {
-    if (midiOutput)
+    patternBank.chainLength = 0;
+    
+    for (auto index : patternIndices)
     {
-        midiOutput->sendMessageNow(juce::MidiMessage::noteOn(channel, noteNumber, (juce::uint8) velocity));
+        if (patternBank.chainLength >= PatternBank::maxChainLength)
+            break;
+        
+        if (!juce::isPositiveAndBelow(index, PatternBank::numPatterns))
+            continue;
+        
+        Command command { Command::Type::setChainEntry };
+        command.pad = patternBank.chainLength;
+        command.step = index;
+        pushCommand(command);
+        
+        patternBank.chain[(size_t) patternBank.chainLength++] = index;
     }
+    
+    Command command { Command::Type::setChainLength };
+    command.pad = patternBank.chainLength;
+    pushCommand(command);
+}
+
+void MidiHandler::setSongMode(bool shouldUseSongMode)
+{
+    patternBank.songMode = shouldUseSongMode;
+    
+    Command command { Command::Type::setSongMode };
+    command.flag = shouldUseSongMode;
+    pushCommand(command);
+}
+
+void MidiHandler::sendNoteOn(int noteNumber, int velocity, int channel)
+{
+    hardwareSender.pushFromMessageThread(juce::MidiMessage::noteOn(channel, noteNumber, (juce::uint8) velocity));
 }
 
 void MidiHandler::sendNoteOff(int noteNumber, int channel)
 {
-    if (midiOutput)
-    {
-        midiOutput->sendMessageNow(juce::MidiMessage::noteOff(channel, noteNumber));
-    }
+    hardwareSender.pushFromMessageThread(juce::MidiMessage::noteOff(channel, noteNumber));
 }
 
 void MidiHandler::sendControlChange(int controllerNumber, int value, int channel)
 {
-    if (midiOutput)
-    {
-        midiOutput->sendMessageNow(juce::MidiMessage::controllerEvent(channel, controllerNumber, value));
-    }
+    hardwareSender.pushFromMessageThread(juce::MidiMessage::controllerEvent(channel, controllerNumber, value));
+}
+
+void MidiHandler::queueHardwareMessage(const juce::MidiMessage& message, int sampleOffset)
+{
+    queueHardwareBytes(message.getRawData(), message.getRawDataSize(), sampleOffset);
+}
+
+void MidiHandler::queueHardwareBytes(const juce::uint8* data, int size, int sampleOffset)
+{
+    // Sin dispositivo no se envía nada, y tampoco se cuenta
+    if (!hardwareSender.hasOutputDevice())
+        return;
+    
+    // Hora prevista del evento: inicio del bloque más su posición dentro de él
+    const auto timeMs = blockStartTimeMs + sampleOffset * 1000.0 / sampleRate;
+    telemetry.recordHardwareMessage(hardwareSender.pushFromAudioThread(data, size, timeMs));
+}
+
+void MidiHandler::queueLED(int padIndex, bool isOn, int sampleOffset)
+{
+    // Solo actualiza la caché; los cambios reales salen una vez por bloque en flushLEDs
+    ledCache.setLed(padIndex, isOn, sampleOffset);
 }
 
 void MidiHandler::setLED(int padIndex, bool isOn)
 {
-    // Esta función envía un mensaje MIDI para controlar los LEDs del Spark LE
+    // El cambio pasa por la caché de LEDs del hilo de audio, que solo envía diferencias
     if (padIndex >= 0 && padIndex < maxPads)
     {
-        int controllerNumber = SparkLEMidi::ledControllerOffset + padIndex;
-        int value = isOn ? 127 : 0;  // 127 para encendido, 0 para apagado
-        
-        sendControlChange(controllerNumber, value);
+        Command command { Command::Type::setLed };
+        command.pad = padIndex;
+        command.flag = isOn;
+        pushCommand(command);
     }
 }
 
 void MidiHandler::setPadColor(int padIndex, juce::Colour color)
 {
-    // Nota: Esta es una función de ejemplo, ya que el Spark LE original 
-    // probablemente no tiene control de color RGB. Modifícala según el protocolo real.
-    
-    // En algunos controladores modernos, el color se podría enviar como una serie de
-    // mensajes SysEx o CC específicos.
-    
-    // Por ejemplo, podríamos enviar un System Exclusive para establecer el color:
-    if (midiOutput && padIndex >= 0 && padIndex < maxPads)
+    if (padIndex >= 0 && padIndex < maxPads)
     {
-        // Convertir el color a componentes RGB (0-127)
-        uint8_t r = static_cast<uint8_t>(color.getRed() >> 1);    // 0-127
-        uint8_t g = static_cast<uint8_t>(color.getGreen() >> 1);  // 0-127
-        uint8_t b = static_cast<uint8_t>(color.getBlue() >> 1);   // 0-127
-        
-        // Ejemplo de mensaje SysEx (deberías adaptar esto a tu controlador)
-        // F0 (SysEx), ID del fabricante, ID del dispositivo, comando de color, pad, r, g, b, F7 (End SysEx)
-        const uint8_t sysExData[] = { 0xF0, 0x00, 0x20, 0x6B, 0x7F, 0x42, static_cast<uint8_t>(padIndex), r, g, b, 0xF7 };
-        
-        juce::MidiMessage sysExMessage(sysExData, sizeof(sysExData));
-        midiOutput->sendMessageNow(sysExMessage);
+        Command command { Command::Type::setPadColour };
+        command.pad = padIndex;
+        command.argb = color.getARGB();
+        pushCommand(command);
     }
 }
 
+void MidiHandler::resyncLEDs()
+{
+    pushCommand({ Command::Type::resyncLeds });
+}
+
+void MidiHandler::flushLEDs()
+{
+    ledCache.flush([this](int padIndex, bool isOn, int sampleOffset)
+                   {
+                       int controllerNumber = SparkLEMidi::ledControllerOffset + padIndex;
+                       int value = isOn ? 127 : 0;  // 127 para encendido, 0 para apagado
+                       
+                       queueHardwareMessage(juce::MidiMessage::controllerEvent(1, controllerNumber, value), sampleOffset);
+                   },
+                   [this](int padIndex, juce::uint8 r, juce::uint8 g, juce::uint8 b, int sampleOffset)
+                   {
+                       // Nota: el Spark LE original probablemente no tiene control de color RGB.
+                       // Ejemplo de mensaje SysEx (deberías adaptar esto a tu controlador)
+                       // F0 (SysEx), ID del fabricante, ID del dispositivo, comando de color, pad, r, g, b, F7 (End SysEx)
+                       const juce::uint8 sysExData[] = { 0xF0, 0x00, 0x20, 0x6B, 0x7F, 0x42, static_cast<juce::uint8>(padIndex), r, g, b, 0xF7 };
+                       
+                       queueHardwareBytes(sysExData, (int) sizeof(sysExData), sampleOffset);
+                   });
+}
+
 void MidiHandler::setStepState(int padIndex, int step, bool isActive)
 {
-    if (padIndex >= 0 && padIndex < maxPads && step >= 0 && step < maxSteps)
+    if (padIndex >= 0 && padIndex < Pattern::maxTracks && step >= 0 && step < Pattern::maxSteps)
     {
-        sequencerSteps[padIndex][step] = isActive;
+        patternBank.getSelectedPattern().setStep(padIndex, step, isActive);
+        
+        // Se recompila de forma diferida: varios cambios seguidos (p. ej. arrastrando)
+        // generan una sola versión compilada
+        dirtyPatterns |= 1u << patternBank.selectedPattern;
+        triggerAsyncUpdate();
     }
 }
 
 bool MidiHandler::getStepState(int padIndex, int step) const
 {
-    if (padIndex >= 0 && padIndex < maxPads && step >= 0 && step < maxSteps)
+    return patternBank.getSelectedPattern().getStep(padIndex, step);
+}
+
+void MidiHandler::setStepGate(int step, int gate)
+{
+    if (step >= 0 && step < Pattern::maxSteps)
     {
-        return sequencerSteps[padIndex][step];
+        patternBank.getSelectedPattern().setGate(step, gate);
+        
+        dirtyPatterns |= 1u << patternBank.selectedPattern;
+        triggerAsyncUpdate();
     }
-    
-    return false;
 }
 
-int MidiHandler::getCurrentStep() const
+int MidiHandler::getStepGate(int step) const
 {
-    return currentStep;
+    return patternBank.getSelectedPattern().getGate(step);
 }
 
-void MidiHandler::advanceSequencer(int numSamples)
+void MidiHandler::setStepVelocity(int track, int step, int velocity)
 {
-    // Avanza la posición del sample
-    samplePosition += numSamples;
-    
-    // Si llegamos a un nuevo paso (16mo de nota)
-    int samplesPerStep = samplesPerBeat / 4;  // En un compás 4/4, 4 pasos por beat
+    if (track >= 0 && track < Pattern::maxTracks && step >= 0 && step < Pattern::maxSteps)
+    {
+        patternBank.getSelectedPattern().setVelocity(track, step, velocity);
+        
+        dirtyPatterns |= 1u << patternBank.selectedPattern;
+        triggerAsyncUpdate();
+    }
+}
+
+int MidiHandler::getStepVelocity(int track, int step) const
+{
+    return patternBank.getSelectedPattern().getVelocity(track, step);
+}
+
+void MidiHandler::setSwing(int swingPercent)
+{
+    editState.swing = juce::jlimit(Pattern::minSwing, Pattern::maxSwing, swingPercent);
     
-    if (samplePosition >= samplesPerStep)
+    Command command { Command::Type::setSwing };
+    command.pad = editState.swing;
+    pushCommand(command);
+}
+
+void MidiHandler::setStepMicroTiming(int step, int ticks)
+{
+    if (step >= 0 && step < Pattern::maxSteps)
     {
-        // Cuántos pasos completos han pasado
-        int stepsToAdvance = samplePosition / samplesPerStep;
+        patternBank.getSelectedPattern().setMicroTiming(step, ticks);
         
-        // Avanza el paso actual
-        currentStep = (currentStep + stepsToAdvance) % maxSteps;
+        dirtyPatterns |= 1u << patternBank.selectedPattern;
+        triggerAsyncUpdate();
+    }
+}
+
+int MidiHandler::getStepMicroTiming(int step) const
+{
+    return patternBank.getSelectedPattern().getMicroTiming(step);
+}
+
+void MidiHandler::previewTrack(int track)
+{
+    if (track >= 0 && track < Pattern::maxTracks)
+    {
+        Command command { Command::Type::previewTrack };
+        command.pad = track;
+        pushCommand(command);
+    }
+}
+
+bool MidiHandler::getEngineSnapshot(EngineSnapshot& snapshot) const
+{
+    return engineSnapshot.read(snapshot);
+}
+
+void MidiHandler::setNumTracks(int numTracks)
+{
+    patternBank.getSelectedPattern().setNumTracks(numTracks);
+    
+    dirtyPatterns |= 1u << patternBank.selectedPattern;
+    triggerAsyncUpdate();
+}
+
+void MidiHandler::setTrackLength(int track, int length)
+{
+    if (track >= 0 && track < Pattern::maxTracks)
+    {
+        patternBank.getSelectedPattern().setTrackLength(track, length);
         
-        // Dispara los eventos MIDI para el paso actual
-        triggerCurrentStep();
+        dirtyPatterns |= 1u << patternBank.selectedPattern;
+        triggerAsyncUpdate();
+    }
+}
+
+int MidiHandler::getTrackLength(int track) const
+{
+    return patternBank.getSelectedPattern().getTrackLength(track);
+}
+
+void MidiHandler::setTrackRate(int track, Pattern::StepRate rate)
+{
+    if (track >= 0 && track < Pattern::maxTracks)
+    {
+        patternBank.getSelectedPattern().setTrackRate(track, rate);
         
-        // Ajusta la posición del sample
-        samplePosition %= samplesPerStep;
+        dirtyPatterns |= 1u << patternBank.selectedPattern;
+        triggerAsyncUpdate();
+    }
+}
+
+Pattern::StepRate MidiHandler::getTrackRate(int track) const
+{
+    return patternBank.getSelectedPattern().getTrackRate(track);
+}
+
+void MidiHandler::noteStarted(int track, int sampleOffset, int velocity)
+{
+    // La velocidad de la nota, escalada por el nivel de la pista, da también la ganancia del sample
+    const auto level = trackLevels[(size_t) track] * (float) velocity / 127.0f;
+    const auto noteOn = juce::MidiMessage::noteOn(1, SparkLEMidi::padNoteOffset + track,
+                                                  NoteTracker::getOutputVelocity(velocity, trackLevels[(size_t) track]));
+    
+    // Note On en la salida del plugin, en su sample exacto, y en el pad del hardware
+    if (currentMidiOutput != nullptr)
+    {
+        currentMidiOutput->addEvent(noteOn, sampleOffset);
+        telemetry.recordEventEmitted();
+    }
+    
+    // El sample del pad, si tiene, suena en el mismo sample que la nota
+    samplePlayer.queueTrigger(track, sampleOffset, level);
+    
+    queueHardwareMessage(noteOn, sampleOffset);
+    
+    // El LED del pad sigue a la nota; la caché descarta los que no cambian
+    if (track < maxPads)
+        queueLED(track, true, sampleOffset);
+}
+
+void MidiHandler::noteStopped(int track, int sampleOffset)
+{
+    const auto noteOff = juce::MidiMessage::noteOff(1, SparkLEMidi::padNoteOffset + track);
+    
+    if (currentMidiOutput != nullptr)
+    {
+        currentMidiOutput->addEvent(noteOff, sampleOffset);
+        telemetry.recordEventEmitted();
     }
+    
+    queueHardwareMessage(noteOff, sampleOffset);
+    
+    if (track < maxPads)
+        queueLED(track, false, sampleOffset);
 }
 
 void MidiHandler::findSparkLEDevice()
 {
+    SPARKLE_NON_REALTIME_CALL("MidiHandler::findSparkLEDevice");
+    
     // Intenta encontrar el dispositivo Spark LE entre los dispositivos MIDI disponibles
     auto midiOutputs = juce::MidiOutput::getAvailableDevices();
     
-    juce::Logger::writeToLog("SparkLEPlugin: Buscando dispositivos MIDI disponibles");
-    juce::Logger::writeToLog("SparkLEPlugin: Número de dispositivos MIDI: " + juce::String(midiOutputs.size()));
+    SPARKLE_LOG_INFO("SparkLEPlugin: Buscando dispositivos MIDI disponibles");
+    SPARKLE_LOG_DEBUG("SparkLEPlugin: Número de dispositivos MIDI: " + juce::String(midiOutputs.size()));
     
     for (auto& device : midiOutputs)
     {
-        juce::Logger::writeToLog("SparkLEPlugin: Dispositivo MIDI encontrado: " + device.name);
+        SPARKLE_LOG_DEBUG("SparkLEPlugin: Dispositivo MIDI encontrado: " + device.name);
         
         // Busca un dispositivo que contenga "Spark" en su nombre
         if (device.name.containsIgnoreCase("Spark"))
         {
-            juce::Logger::writeToLog("SparkLEPlugin: Dispositivo Spark LE encontrado: " + device.name);
+            SPARKLE_LOG_INFO("SparkLEPlugin: Dispositivo Spark LE encontrado: " + device.name);
             sparkLEDeviceName = device.name;
             
             try {
                 // En versiones recientes de JUCE, openDevice devuelve un unique_ptr
-                midiOutput = juce::MidiOutput::openDevice(device.identifier);
+                auto midiOutput = juce::MidiOutput::openDevice(device.identifier);
                 
                 if (midiOutput) {
-                    juce::Logger::writeToLog("SparkLEPlugin: Conexión con Spark LE establecida correctamente");
+                    // El hilo de envío pasa a ser el dueño del dispositivo
+                    hardwareSender.setOutputDevice(std::move(midiOutput));
+                    
+                    // El estado real de los LEDs es desconocido: refresco completo
+                    resyncLEDs();
+                    SPARKLE_LOG_INFO("SparkLEPlugin: Conexión con Spark LE establecida correctamente");
                     return;
                 }
             }
             catch (const std::exception& e) {
-                juce::Logger::writeToLog("SparkLEPlugin ERROR: No se pudo abrir el dispositivo MIDI: " + juce::String(e.what()));
+                SPARKLE_LOG_ERROR("SparkLEPlugin: No se pudo abrir el dispositivo MIDI: " + juce::String(e.what()));
             }
         }
     }
     
     // Si no encontramos el Spark LE, muestra una alerta o registra un mensaje
-    juce::Logger::writeToLog("SparkLEPlugin: No se pudo encontrar el dispositivo Arturia Spark LE");
+    SPARKLE_LOG_WARNING("SparkLEPlugin: No se pudo encontrar el dispositivo Arturia Spark LE");
 }
 
-void MidiHandler::triggerCurrentStep()
+void MidiHandler::applyParameters(int numSamples)
 {
-    // Envía eventos MIDI para los pads activados en el paso actual
-    for (int pad = 0; pad < maxPads; ++pad)
+    // Solo cargas atómicas de punteros ya resueltos; el tempo solo se toca si cambia
+    const auto bpm = parameters->getTempo();
+    
+    if (bpm != audioState.bpm)
+    {
+        // En marcha el cambio se reparte en rampa a lo largo del bloque, así que una
+        // automatización por bloques no deja escalones en la rejilla
+        audioState.bpm = bpm;
+        clock.setTempo(bpm, transportRunning ? numSamples : 0);
+    }
+    
+    // El swing lo suma el motor al colocar cada evento: no hace falta recompilar nada
+    const auto swing = parameters->getSwing();
+    
+    if (swing != audioState.swing)
+    {
+        audioState.swing = swing;
+        engine.setSwing(swing);
+    }
+    
+    audioState.clickEnabled = parameters->isClickEnabled();
+    audioState.midiClickEnabled = parameters->isMidiClickEnabled();
+    
+    juce::uint32 muted = 0;
+    
+    for (int track = 0; track < Pattern::maxTracks; ++track)
+    {
+        trackLevels[(size_t) track] = parameters->getTrackLevel(track);
+        
+        if (parameters->isTrackMuted(track))
+            muted |= 1u << track;
+    }
+    
+    mutedTracks = muted;
+}
+
+void MidiHandler::stepTriggered(int sampleOffset, const CompiledPattern::Event& event)
+{
+    // Los golpes de pad anteriores al paso suenan antes, para que las notas salgan en orden
+    playPadHitsUpTo(sampleOffset);
+    
+    const auto trackBit = 1u << event.track;
+    
+    // Una pista en mute no empieza notas nuevas; las que suenan terminan con su gate
+    if ((trackBit & mutedTracks) != 0)
+        return;
+    
+    // La nota que se acaba de grabar en este paso ya sonó con el golpe
+    if ((trackBit & suppressedTracks) != 0 && suppressedSteps[(size_t) event.track] == event.step)
+    {
+        suppressedTracks &= ~trackBit;
+        return;
+    }
+    
+    notes.trigger(event, sampleOffset, *this);
+}
+
+void MidiHandler::playPadHitsUpTo(int sampleOffset)
+{
+    for (; numPadHitsPlayed < numPadHits; ++numPadHitsPlayed)
+    {
+        const auto& hit = padHits[(size_t) numPadHitsPlayed];
+        
+        if (hit.sampleOffset > sampleOffset)
+            break;
+        
+        // Un golpe dura un paso, como la previsualización
+        notes.releaseUpTo(hit.sampleOffset, *this);
+        notes.startNote(hit.track, hit.sampleOffset, CompiledPattern::ppqPerStep, hit.velocity, *this);
+    }
+}
+
+void MidiHandler::recordPadHits(const SequencerClock::BlockTiming& timing)
+{
+    const auto patternIndex = engine.getPlayingPattern();
+    auto* compiled = engine.getPattern(patternIndex);
+    
+    if (compiled == nullptr || compiled->cycleLengthPpq <= 0.0)
+        return;
+    
+    const auto strength = audioState.quantiseStrength / 100.0;
+    const auto swingOffset = engine.getSwingOffset();
+    
+    for (int i = 0; i < numPadHits; ++i)
     {
-        if (sequencerSteps[pad][currentStep])
+        const auto& hit = padHits[(size_t) i];
+        
+        if (hit.track >= compiled->numTracks)
+            continue;
+        
+        // Posición del golpe en pasos de su pista, desde el inicio de la vuelta
+        const auto& info = compiled->tracks[(size_t) hit.track];
+        const auto hitPpq = timing.ppqAt(hit.sampleOffset);
+        const auto position = engine.getPositionInCycle(hitPpq);
+        const auto exact = position / info.stepPpq;
+        const auto stepOf = [&info](juce::int64 index) { return (int) (((index % info.length) + info.length) % info.length); };
+        
+        // Paso más cercano contando el swing y el microtiming: con ellos un paso puede
+        // caer hasta un paso entero más allá de su sitio en la rejilla
+        auto index = (juce::int64) std::floor(exact) - 1;
+        auto grid = (double) index + compiled->getStepOffset(index, stepOf(index), swingOffset);
+        
+        for (auto candidate = index + 1; candidate <= index + 2; ++candidate)
         {
-            // Envía Note On para este pad
-            int noteNumber = SparkLEMidi::padNoteOffset + pad;
-            sendNoteOn(noteNumber, 127);  // Velocidad máxima
+            const auto candidateGrid = (double) candidate + compiled->getStepOffset(candidate, stepOf(candidate), swingOffset);
             
-            // Enciende el LED 
-            setLED(pad, true);
-            
-            // Programa un Note Off automático para la siguiente actualización
-            // En una implementación real, podrías calcular cuándo enviar el Note Off
-            // basado en la duración de la nota deseada
+            if (std::abs(exact - candidateGrid) < std::abs(exact - grid))
+            {
+                index = candidate;
+                grid = candidateGrid;
+            }
         }
-        else
+        
+        // Lo que la cuantización no corrige se queda como desplazamiento de la nota
+        const auto nudge = juce::jlimit(-Pattern::maxMicroTicks, Pattern::maxMicroTicks,
+                                        juce::roundToInt((exact - grid) * (1.0 - strength) * Pattern::microTicksPerStep));
+        
+        // Un paso cuantizado fuera de la vuelta es el último de la anterior o el primero
+        // de la siguiente
+        const auto stepsInCycle = (juce::int64) std::ceil(compiled->cycleLengthPpq / info.stepPpq - 1.0e-9);
+        const auto step = stepOf(index < 0 ? stepsInCycle - 1 : (index >= stepsInCycle ? 0 : index));
+        const auto trackBit = 1u << hit.track;
+        
+        // Si la nota queda por delante del golpe, al recompilar sonaría otra vez en esta vuelta
+        const auto targetPpq = hitPpq + (grid - exact) * info.stepPpq + nudge * info.stepPpq / Pattern::microTicksPerStep;
+        
+        if (targetPpq > hitPpq)
+        {
+            suppressedTracks |= trackBit;
+            suppressedSteps[(size_t) hit.track] = step;
+            suppressUntilPpq[(size_t) hit.track] = targetPpq;
+        }
+        
+        // Modo reemplazo: la pista se vacía con el primer golpe de la toma
+        auto clearTrack = false;
+        
+        if (audioState.recordMode == RecordMode::replace)
         {
-            // Si el pad no está activo en este paso, asegúrate de que el LED esté apagado
-            setLED(pad, false);
+            clearTrack = (replacedTracks & trackBit) == 0;
+            replacedTracks |= trackBit;
         }
+        
+        // Si la cola se llenara se pierde la nota, nunca se espera
+        recordedHits.push({ patternIndex, hit.track, step, hit.velocity, nudge, clearTrack });
+        messageThreadWorkQueued.store(true, std::memory_order_release);
     }
-}
\ No newline at end of file
+}
+
+void MidiHandler::applyRecordedHit(const RecordedHit& hit)
+{
+    auto& pattern = patternBank.patterns[(size_t) hit.pattern];
+    
+    if (hit.clearTrack)
+        pattern.clearTrack(hit.track);
+    
+    pattern.setStep(hit.track, hit.step, true);
+    pattern.setVelocity(hit.track, hit.step, hit.velocity);
+    pattern.setNudge(hit.track, hit.step, hit.nudge);
+    
+    dirtyPatterns |= 1u << hit.pattern;
+}
+
+void MidiHandler::updatePlayheads()
+{
+    auto* compiled = engine.getPattern(engine.getPlayingPattern());
+    
+    nextSnapshot.playingPattern = engine.getPlayingPattern();
+    
+    if (compiled == nullptr)
+        return;
+    
+    // Una sola pasada por bloque: cada cabezal sale de la posición dentro del ciclo
+    const auto position = engine.getPositionInCycle();
+    
+    if (compiled->numSteps > 0)
+        nextSnapshot.currentStep = (int) (position / CompiledPattern::ppqPerStep) % compiled->numSteps;
+    
+    for (int track = 0; track < compiled->numTracks; ++track)
+        nextSnapshot.trackPlayheads[(size_t) track] = compiled->getTrackStep(track, position);
+}
@@ -3,29 +3,73 @@
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_audio_devices/juce_audio_devices.h>
 #include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
 #include <juce_graphics/juce_graphics.h>
+#include "SequencerClock.h"
+#include "LockFreeQueue.h"
+#include "HardwareMidiSender.h"
+#include "LedStateCache.h"
+#include "Pattern.h"
+#include "PatternBank.h"
+#include "CompiledPattern.h"
+#include "SequencerEngine.h"
+#include "NoteTracker.h"
+#include "PatternRenderer.h"
+#include "AudioTelemetry.h"
+#include "SamplePlayer.h"
+#include "SampleLoader.h"
+#include "SampleStreamer.h"
+#include "Metronome.h"
+#include "EngineSnapshot.h"
+#include "StateSerializer.h"
+#include "MidiInputMap.h"
+
+class PluginParameters;
+
+// Sin salida al hardware (benchmarks y herramientas sin dispositivo MIDI)
+#ifndef SPARKLE_HEADLESS
+ #define SPARKLE_HEADLESS 0
+#endif
 
 //==============================================================================
-class MidiHandler
+class MidiHandler : private SequencerEngine::Listener,
+                    private NoteTracker::Output,
+                    private SampleLoader::Listener,
+                    private juce::AsyncUpdater,
+                    private juce::Timer
 {
 public:
     MidiHandler();
-    ~MidiHandler();
+    ~MidiHandler() override;
     
     // Preparación para reproducción y liberación de recursos
     void prepareToPlay(double sampleRate, int samplesPerBlock);
     void releaseResources();
     
-    // Procesa mensajes MIDI entrantes y genera salida
-    void processMidi(juce::MidiBuffer& midiMessages);
+    // Aplica en el hilo de audio los cambios pendientes del editor.
+    // Se llama al principio de cada processBlock, antes de processMidi
+    void processPendingCommands();
+    
+    // Procesa mensajes MIDI entrantes y genera salida con precisión de sample.
+    // playHead puede ser nullptr (se usa entonces el reloj interno)
+    void processMidi(juce::MidiBuffer& midiMessages, int numSamples, juce::AudioPlayHead* playHead);
     
-    // Funciones para el secuenciador
+    // Mezcla en buffer los samples y el metrónomo disparados en processMidi. Se llama
+    // justo después
+    void renderSamples(juce::AudioBuffer<float>& buffer);
+    
+    // Funciones para el secuenciador (hilo de mensajes)
     void startSequencer();
     void stopSequencer();
     void setTempo(double bpm);
-    bool isSequencerPlaying() const { return isPlaying; }
+    double getTempo() const { return editState.bpm; }
+    
+    // Última orden de transporte del editor. Lo que suena de verdad (también con el
+    // transporte del host) es el isPlaying de getEngineSnapshot()
+    bool isSequencerPlaying() const { return editState.isPlaying; }
     
-    // Funciones para interactuar con el Spark LE
+    // Funciones para interactuar con el Spark LE (hilo de mensajes).
+    // Los mensajes se entregan al hilo de envío, nunca se llama al driver directamente
     void sendNoteOn(int noteNumber, int velocity, int channel = 1);
     void sendNoteOff(int noteNumber, int channel = 1);
     void sendControlChange(int controllerNumber, int value, int channel = 1);
@@ -34,43 +78,364 @@ public:
     void setLED(int padIndex, bool isOn);
     void setPadColor(int padIndex, juce::Colour color);
     
-    // Funciones para gestionar los pasos del secuenciador
+    // Fuerza el reenvío de todos los LEDs (p. ej. tras reconectar el controlador)
+    void resyncLEDs();
+    
+    // Funciones para gestionar los pasos del secuenciador (hilo de mensajes)
     void setStepState(int padIndex, int step, bool isActive);
     bool getStepState(int padIndex, int step) const;
-    int getCurrentStep() const;
     
-    // Estado del click
-    bool clickEnabled = true;
+    // Estado del motor (transporte, cabezales de cada pista, LEDs y picos de salida),
+    // publicado por el hilo de audio al final de cada bloque en que cambia. Se puede
+    // leer desde cualquier hilo sin bloquear al de audio; devuelve false si no se ha
+    // podido obtener una copia coherente (snapshot no se toca)
+    bool getEngineSnapshot(EngineSnapshot& snapshot) const;
+    
+    // Pistas del patrón seleccionado: número de pistas, longitud (1-64 pasos) y
+    // duración de paso de cada una
+    void setNumTracks(int numTracks);
+    int getNumTracks() const { return getPattern().getNumTracks(); }
+    void setTrackLength(int track, int length);
+    int getTrackLength(int track) const;
+    void setTrackRate(int track, Pattern::StepRate rate);
+    Pattern::StepRate getTrackRate(int track) const;
+    
+    // Duración de las notas de un paso, en dieciseisavos de paso (Pattern::gateUnitsPerStep = un paso)
+    void setStepGate(int step, int gate);
+    int getStepGate(int step) const;
+    
+    // Swing de la sesión (Pattern::minSwing = recto): lo aplica el motor al tocar, y
+    // con parámetros del host manda el suyo. El microtiming de cada paso, en 1/96 de
+    // paso, se aplica al compilar el patrón
+    void setSwing(int swingPercent);
+    int getSwing() const { return editState.swing; }
+    void setStepMicroTiming(int step, int ticks);
+    int getStepMicroTiming(int step) const;
+    
+    // Velocidad de cada nota del patrón seleccionado (1-127)
+    void setStepVelocity(int track, int step, int velocity);
+    int getStepVelocity(int track, int step) const;
+    
+    // Grabación en vivo desde los pads (hilo de mensajes). Con el transporte en marcha
+    // cada golpe se escribe, con su velocidad, en el paso más cercano de su pista en
+    // el patrón que suena. quantiseStrength (0-100 %) es cuánto se acerca al paso; lo
+    // que queda se guarda como desplazamiento de la nota. En modo reemplazo el primer
+    // golpe de cada pad en la toma (desde que se activa la grabación o arranca el
+    // transporte) vacía antes su pista
+    enum class RecordMode { overdub, replace };
+    
+    void setRecording(bool shouldRecord);
+    bool isRecording() const { return editState.isRecording; }
+    void setQuantiseStrength(int percent);
+    int getQuantiseStrength() const { return editState.quantiseStrength; }
+    void setRecordMode(RecordMode mode);
+    RecordMode getRecordMode() const { return editState.recordMode; }
+    
+    // Toca una pista una vez (previsualización desde el editor). El Note Off lo
+    // programa el hilo de audio con el gate de un paso
+    void previewTrack(int track);
+    
+    // Samples de cada pad (hilo de mensajes). El fichero se decodifica en segundo
+    // plano y suena en cuanto llega al hilo de audio
+    void loadSample(int pad, const juce::File& file);
+    void installSample(int pad, std::unique_ptr<LoadedSample> sample);
+    juce::String getSampleName(int pad) const;
+    
+    // Cambia todos los pads a la vez, un fichero por pad en orden (los que sobran se
+    // vacían). El kit anterior sigue sonando hasta que están listas todas las cabezas
+    void loadKit(const juce::Array<juce::File>& files);
+    
+    // Patrón seleccionado tal y como lo ve el editor (hilo de mensajes)
+    const Pattern& getPattern() const { return patternBank.getSelectedPattern(); }
+    
+    // Banco de patrones y modo canción (hilo de mensajes). El cambio de patrón
+    // se hace efectivo en el siguiente compás
+    void selectPattern(int patternIndex);
+    int getSelectedPattern() const { return patternBank.selectedPattern; }
+    int getPlayingPattern() const;
+    void setSongChain(const juce::Array<int>& patternIndices);
+    void setSongMode(bool shouldUseSongMode);
+    bool isSongMode() const { return patternBank.songMode; }
+    
+    // Entrada MIDI del controlador (hilo de mensajes). El hilo de audio despacha cada
+    // nota o CC con una consulta a la tabla; una tabla nueva se instala entera
+    const MidiInputMap& getInputMap() const { return inputMapEdit; }
+    void setInputMap(const MidiInputMap& map);
+    
+    // MIDI learn: la siguiente nota o CC que llegue se asigna a binding (y deja de
+    // estar en las fuentes que la tuvieran)
+    void beginMidiLearn(MidiInputMap::Binding binding);
+    void cancelMidiLearn();
+    bool isMidiLearnActive() const { return learnTarget.action != MidiInputMap::Action::none; }
+    
+    // Estado que se guarda en el proyecto del host (hilo de mensajes). Al restaurarlo,
+    // el banco completo llega al hilo de audio en un solo comando, así que ningún
+    // bloque ve una mezcla del banco anterior y el nuevo
+    void getSessionState(StateSerializer::State& state) const;
+    void restoreSessionState(const StateSerializer::State& state);
+    
+    // Render offline del banco actual a un fichero MIDI, con el mismo motor que la
+    // reproducción en vivo (hilo de mensajes). El swing, el nivel y el mute de cada
+    // pista son los de la sesión, no los de settings, así que las notas salen igual
+    // que por la salida del plugin
+    juce::MidiFile renderToMidiFile(const PatternRenderer::Settings& settings) const;
+    
+    // Compila los patrones modificados y los envía al hilo de audio. Se llama sola
+    // de forma asíncrona; solo hace falta llamarla a mano sin bucle de mensajes
+    void compilePendingPatterns();
+    
+    // Estado del click (hilo de mensajes)
+    void setClickEnabled(bool shouldBeEnabled);
+    bool isClickEnabled() const { return editState.clickEnabled; }
+    
+    // Además del audio, el click sale como nota MIDI por el canal 10
+    void setMidiClickEnabled(bool shouldBeEnabled);
+    bool isMidiClickEnabled() const { return editState.midiClickEnabled; }
+    
+    // Estado del secuenciador. Cada hilo tiene su propia copia: el editor modifica
+    // editState y envía el cambio por la cola; el hilo de audio solo lee audioState
+    struct SequencerState
+    {
+        bool isPlaying = false;
+        bool clickEnabled = true;
+        bool midiClickEnabled = false;
+        double bpm = 120.0;
+        int swing = Pattern::minSwing;
+        bool isRecording = false;
+        int quantiseStrength = 100;
+        RecordMode recordMode = RecordMode::overdub;
+    };
+    
+    // Solo desde el hilo de audio
+    const SequencerState& getAudioThreadState() const { return audioState; }
+    
+    // Parámetros del host. Si hay, mandan sobre setTempo(), setSwing() y los clicks: el hilo de
+    // audio los lee al principio de cada bloque. Sin ellos (benchmarks, herramientas)
+    // todo va por comandos
+    void setParameters(PluginParameters* newParameters) { parameters = newParameters; }
+    
+    // Telemetría del hilo de audio: el procesador mide el bloque, el resto se registra aquí.
+    // El editor solo llama a getSnapshot() y requestReset()
+    AudioTelemetry& getTelemetry() { return telemetry; }
     
 private:
     // MIDI
-    std::unique_ptr<juce::MidiOutput> midiOutput;
+    HardwareMidiSender hardwareSender;
     juce::String sparkLEDeviceName;
     
+    struct SampleKit;
+    struct BankUpdate;
+    
+    // Comandos del editor hacia el hilo de audio
+    struct Command
+    {
+        enum class Type
+        {
+            setTempo, setSwing, setClick, setMidiClick, start, stop,
+            setLed, setPadColour, resyncLeds,
+            installPattern, selectPattern, setChainEntry, setChainLength, setSongMode,
+            previewTrack, installSample, installKit, installBank,
+            installInputMap, setMidiLearn,
+            setRecording, setQuantiseStrength, setRecordMode
+        };
+        
+        Type type = Type::setTempo;
+        int pad = 0;
+        int step = 0;
+        bool flag = false;
+        double value = 0.0;
+        juce::uint32 argb = 0;
+        const CompiledPattern* compiledPattern = nullptr;
+        const LoadedSample* sample = nullptr;
+        SampleKit* kit = nullptr;
+        BankUpdate* bank = nullptr;
+        const MidiInputMap* inputMap = nullptr;
+    };
+    
+    static constexpr int commandQueueSize = 1024;
+    LockFreeQueue<Command, commandQueueSize> commandQueue;
+    
+    // Patrones compilados que el hilo de audio ya no usa, para liberarlos aquí
+    static constexpr int retiredQueueSize = 256;
+    LockFreeQueue<const CompiledPattern*, retiredQueueSize> retiredPatterns;
+    
+    // Banco completo restaurado desde el proyecto. Vuelve del hilo de audio con los
+    // patrones compilados a los que sustituyó, igual que un kit de samples
+    struct BankUpdate
+    {
+        std::array<const CompiledPattern*, PatternBank::numPatterns> patterns {};
+        std::array<int, PatternBank::maxChainLength> chain {};
+        int chainLength = 0;
+        bool songMode = false;
+        int selectedPattern = 0;
+    };
+    
+    LockFreeQueue<BankUpdate*, retiredQueueSize> retiredBanks;
+    void deleteBankUpdate(BankUpdate* update);
+    
+    bool pushCommand(const Command& command);
+    void applyCommand(const Command& command);
+    void transportStarted();
+    void transportStopped();
+    void retirePattern(const CompiledPattern* compiled);
+    
+    template <typename QueueType, typename PointerType>
+    void retire(QueueType& queue, PointerType* pointer);
+    void deleteRetiredPatterns();
+    void handleAsyncUpdate() override;
+    
+    // Entrada MIDI. Las acciones que cambian estado del hilo de mensajes (transporte,
+    // patrón, mute, tempo) vuelven a él por una cola y se aplican con las mismas
+    // funciones que usa el editor; los pads se atienden en el propio hilo de audio
+    struct ControllerAction
+    {
+        MidiInputMap::Binding binding;
+        int amount = 1;     // Pasos de un CC relativo; 1 para una pulsación
+    };
+    
+    static constexpr int controllerActionQueueSize = 256;
+    
+    MidiInputMap inputMapEdit;                          // Hilo de mensajes
+    const MidiInputMap* inputMap = nullptr;             // Hilo de audio
+    MidiInputMap::Binding learnTarget;                  // Hilo de mensajes
+    bool midiLearnArmed = false;                        // Hilo de audio
+    std::atomic<int> learnedSource { -1 };
+    LockFreeQueue<ControllerAction, controllerActionQueueSize> controllerActions;
+    LockFreeQueue<const MidiInputMap*, retiredQueueSize> retiredInputMaps;
+    
+    // El hilo de audio no puede despertar al de mensajes: marca esta bandera al dejarle
+    // algo (acciones, golpes grabados, MIDI learn) y el timer que lo recoge va rápido
+    // mientras haya trabajo y baja de ritmo tras un segundo sin nada
+    static constexpr int activeTimerIntervalMs = 10;
+    static constexpr int idleTimerIntervalMs = 50;
+    static constexpr int activeTicksBeforeIdle = 100;
+    std::atomic<bool> messageThreadWorkQueued { false };
+    int quietTicks = 0;                                 // Hilo de mensajes
+    
+    void installInputMap();
+    void deleteRetiredInputMaps();
+    void handleInputMessage(MidiInputMap::Binding binding, const juce::uint8* data, int sampleOffset);
+    void applyControllerAction(const ControllerAction& action);
+    void timerCallback() override;
+    
+    // Grabación en vivo. Los golpes de pad del bloque se guardan en orden de sample:
+    // suenan intercalados con los pasos del patrón y, grabando, se cuantizan cuando el
+    // motor ya ha procesado el bloque. La nota resultante vuelve al hilo de mensajes,
+    // que la escribe en el patrón y lo recompila
+    struct PadHit
+    {
+        int track = 0;
+        int sampleOffset = 0;
+        int velocity = 0;
+    };
+    
+    struct RecordedHit
+    {
+        int pattern = 0;
+        int track = 0;
+        int step = 0;
+        int velocity = Pattern::defaultVelocity;
+        int nudge = 0;
+        bool clearTrack = false;    // Modo reemplazo: primer golpe de la pista en esta toma
+    };
+    
+    static constexpr int maxPadHitsPerBlock = 64;
+    static constexpr int recordedHitQueueSize = 256;
+    
+    std::array<PadHit, maxPadHitsPerBlock> padHits;     // Hilo de audio
+    int numPadHits = 0;
+    int numPadHitsPlayed = 0;
+    juce::uint32 replacedTracks = 0;                    // Pistas ya vaciadas en esta toma (modo reemplazo)
+    
+    // Un golpe cuantizado hacia delante ya ha sonado: su paso no se repite en esta vuelta
+    juce::uint32 suppressedTracks = 0;
+    std::array<int, Pattern::maxTracks> suppressedSteps {};
+    std::array<double, Pattern::maxTracks> suppressUntilPpq {};
+    
+    LockFreeQueue<RecordedHit, recordedHitQueueSize> recordedHits;
+    
+    void playPadHitsUpTo(int sampleOffset);
+    void recordPadHits(const SequencerClock::BlockTiming& timing);
+    void applyRecordedHit(const RecordedHit& hit);
+    
+    // Samples: el hilo de audio los reproduce y devuelve los sustituidos para liberarlos
+    // aquí. Un kit viaja entero en un comando y vuelve con los samples a los que sustituyó
+    struct SampleKit
+    {
+        std::array<const LoadedSample*, SamplePlayer::numPads> samples {};
+    };
+    
+    SampleStreamer sampleStreamer;
+    SamplePlayer samplePlayer;                          // Hilo de audio
+    SampleLoader sampleLoader { *this };
+    std::array<juce::File, SamplePlayer::numPads> sampleFiles;     // Hilo de mensajes
+    std::array<juce::String, SamplePlayer::numPads> sampleNames;   // Hilo de mensajes
+    std::atomic<double> preparedSampleRate { 0.0 };
+    std::atomic<bool> samplesNeedReload { false };
+    LockFreeQueue<const LoadedSample*, retiredQueueSize> retiredSamples;
+    LockFreeQueue<SampleKit*, retiredQueueSize> retiredKits;
+    juce::Array<juce::File> pendingKitFiles;                        // Hilo de mensajes
+    
+    void sampleLoaded(int pad, const juce::File& file, std::unique_ptr<LoadedSample> sample) override;
+    void kitLoaded(const juce::Array<juce::File>& files, std::vector<std::unique_ptr<LoadedSample>> samples) override;
+    void deleteSampleKit(SampleKit* kit);
+    void deleteRetiredSamples();
+    
     // Secuenciador
-    bool isPlaying;
-    double bpm;
+    SequencerState editState;   // Hilo de mensajes
+    SequencerState audioState;  // Hilo de audio
+    PatternBank patternBank;    // Hilo de mensajes
+    juce::uint32 dirtyPatterns; // Patrones pendientes de compilar (bit por patrón)
+    SequencerEngine engine;     // Hilo de audio
     double sampleRate;
-    int samplesPerBeat;
-    int samplePosition;
-    juce::int64 lastTimeInSamples;  // Para modo standalone
-    juce::AudioPlayHead::CurrentPositionInfo positionInfo;  // Info de posición desde el host
+    double blockStartTimeMs;    // Hora de inicio del bloque actual (hilo de audio)
+    SequencerClock clock;
+    Metronome metronome;        // Hilo de audio
+    
+    // Parámetros del host y lo que se ha leído de ellos en este bloque (hilo de audio)
+    PluginParameters* parameters = nullptr;
+    std::array<float, Pattern::maxTracks> trackLevels;
+    juce::uint32 mutedTracks = 0;
+    
+    static constexpr int maxPads = MidiInputMap::sparkLENumPads;   // Pads físicos del Spark LE
+    
+    // Estado para el editor: se va rellenando durante el bloque y se publica al final
+    EngineSnapshot nextSnapshot;            // Hilo de audio
+    EngineSnapshot lastPublished;           // Hilo de audio
+    SeqLock<EngineSnapshot> engineSnapshot;
     
-    // Matriz para almacenar el estado de los pasos
-    static constexpr int maxPads = 8;
-    static constexpr int maxSteps = 16;
-    bool sequencerSteps[maxPads][maxSteps];
-    int currentStep;
+    // Notas que siguen sonando y sus Note Offs programados (hilo de audio)
+    NoteTracker notes;
+    juce::uint32 pendingPreviews;   // Pistas a previsualizar en el siguiente bloque
+    bool transportRunning;          // El secuenciador avanzó en el último bloque
+    
+    // Salida MIDI del bloque en curso (válida solo dentro de processMidi)
+    juce::MidiBuffer* currentMidiOutput;
+    
+    AudioTelemetry telemetry;
     
     // Métodos auxiliares
-    void advanceSequencer(int numSamples);
+    void stepTriggered(int sampleOffset, const CompiledPattern::Event& event) override;
+    void noteStarted(int track, int sampleOffset, int velocity) override;
+    void noteStopped(int track, int sampleOffset) override;
+    void applyParameters(int numSamples);
+    void updatePlayheads();
+    void publishSnapshot(const juce::AudioBuffer<float>& buffer);
     void findSparkLEDevice();
-    void triggerCurrentStep();
+    
+    // Salida al hardware desde el hilo de audio, fechada según su sample en el bloque
+    void queueHardwareMessage(const juce::MidiMessage& message, int sampleOffset);
+    void queueHardwareBytes(const juce::uint8* data, int size, int sampleOffset);
+    void queueLED(int padIndex, bool isOn, int sampleOffset);
+    void flushLEDs();
+    
+    // Estado de los LEDs (hilo de audio)
+    LedStateCache ledCache { maxPads };
     
     // Constantes MIDI específicas del Spark LE
     struct SparkLEMidi
     {
-        static constexpr int padNoteOffset = 60;  // Nota MIDI para el primer pad
+        static constexpr int padNoteOffset = MidiInputMap::sparkLEFirstPadNote;  // Nota MIDI para el primer pad
         static constexpr int ledControllerOffset = 20;  // CC para el primer LED
     };
 };
\ No newline at end of file
@@ -0,0 +1,43 @@
+#include "MidiInputMap.h"
+
+//==============================================================================
+MidiInputMap::MidiInputMap()
+{
+    clear();
+
+    // Como antes de que hubiera tabla: el canal no importa
+    for (int channel = 0; channel < numChannels; ++channel)
+        for (int pad = 0; pad < sparkLENumPads; ++pad)
+            bindings[(size_t) getNoteSource(channel, sparkLEFirstPadNote + pad)] = { Action::padTrigger, (juce::int8) pad };
+}
+
+void MidiInputMap::clear()
+{
+    bindings.fill({});
+}
+
+void MidiInputMap::setBinding(int source, Binding binding)
+{
+    if (juce::isPositiveAndBelow(source, numSources))
+        bindings[(size_t) source] = binding;
+}
+
+void MidiInputMap::removeBinding(Binding binding)
+{
+    for (auto& entry : bindings)
+        if (entry == binding)
+            entry = {};
+}
+
+juce::String MidiInputMap::describeSource(int source)
+{
+    if (!juce::isPositiveAndBelow(source, numSources))
+        return {};
+
+    const auto index = source % (numChannels * numNumbers);
+    const auto channel = juce::String((index >> 7) + 1);
+    const auto number = juce::String(index & 0x7f);
+
+    return isControllerSource(source) ? "CC " + number + " (canal " + channel + ")"
+                                      : "Nota " + number + " (canal " + channel + ")";
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+
+//==============================================================================
+/**
+ * Tabla de entrada MIDI: a cada nota y a cada controlador de cada canal le
+ * corresponde una acción (tocar un pad, silenciar una pista, cambiar de patrón,
+ * mover el tempo o controlar el transporte).
+ *
+ * Son dos tablas de 16 x 128 entradas de dos bytes reservadas de antemano, así que
+ * despachar un mensaje es calcular un índice con sus dos primeros bytes y leer una
+ * entrada, sin comparar rangos. El hilo de audio nunca modifica la tabla: el hilo
+ * de mensajes edita su copia y envía una nueva entera.
+ */
+class MidiInputMap
+{
+public:
+    enum class Action : juce::uint8
+    {
+        none,
+        padTrigger,         // argument: pad
+        muteTrack,          // argument: pista; cada pulsación alterna el mute
+        selectPattern,      // argument: patrón
+        tempoNudge,         // argument: BPM por pulsación o por paso de un CC relativo, con signo
+        toggleTransport,
+        startTransport,
+        stopTransport,
+        toggleRecording,
+        numActions
+    };
+
+    struct Binding
+    {
+        Action action = Action::none;
+        juce::int8 argument = 0;
+
+        bool operator== (const Binding& other) const { return action == other.action && argument == other.argument; }
+        bool operator!= (const Binding& other) const { return !operator== (other); }
+    };
+
+    static constexpr int numChannels = 16;
+    static constexpr int numNumbers = 128;
+    static constexpr int numSources = 2 * numChannels * numNumbers;   // Notas y luego CCs
+
+    // Pads del Spark LE: notas consecutivas a partir de la primera
+    static constexpr int sparkLEFirstPadNote = 60;
+    static constexpr int sparkLENumPads = 8;
+
+    // Mapa por defecto del Spark LE: las notas de los pads en cualquier canal
+    MidiInputMap();
+
+    // Deja todas las entradas sin acción
+    void clear();
+
+    // Índice de la fuente: canal de 0 a 15, número de 0 a 127
+    static int getNoteSource(int channel, int noteNumber)        { return (channel << 7) | noteNumber; }
+    static int getControllerSource(int channel, int controller)  { return numChannels * numNumbers + ((channel << 7) | controller); }
+    static bool isControllerSource(int source)                   { return source >= numChannels * numNumbers; }
+
+    // Fuente de un mensaje en bruto, o -1 si no es una nota ni un CC
+    static int getSource(const juce::uint8* data, int numBytes) noexcept
+    {
+        if (numBytes < 3)
+            return -1;
+
+        const auto type = data[0] & 0xf0;
+        const auto index = ((data[0] & 0x0f) << 7) | (data[1] & 0x7f);
+
+        if (type == 0x90 || type == 0x80)
+            return index;
+
+        return type == 0xb0 ? numChannels * numNumbers + index : -1;
+    }
+
+    Binding getBinding(int source) const noexcept { return bindings[(size_t) source]; }
+    void setBinding(int source, Binding binding);
+
+    // Quita la acción de todas las fuentes que la tengan (MIDI learn la mueve a otra)
+    void removeBinding(Binding binding);
+
+    // Texto para el editor, p. ej. "Nota 60 (canal 1)"
+    static juce::String describeSource(int source);
+
+private:
+    std::array<Binding, numSources> bindings;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include <array>
+#include "Pattern.h"
+
+//==============================================================================
+/**
+ * Note Offs pendientes, ordenados por su sample absoluto (hilo de audio).
+ *
+ * Es un montículo de mínimos sobre un array fijo: programar y sacar un Note Off
+ * cuesta O(log n) y nunca reserva memoria. Cada pista tiene como mucho una nota
+ * sonando; al redisparar una pista antes de su Note Off, la entrada anterior se
+ * invalida subiendo la generación de la pista en vez de buscarla en el montículo.
+ */
+class NoteOffScheduler
+{
+public:
+    // Una entrada viva por pista más las invalidadas que aún no han vencido
+    // (como mucho maxGate / gateUnitsPerStep por pista)
+    static constexpr int capacity = 1024;
+
+    NoteOffScheduler() = default;
+
+    // Programa el Note Off de una pista. Devuelve false si no hay sitio
+    bool schedule(int track, juce::int64 sampleTime)
+    {
+        if (size >= capacity || !juce::isPositiveAndBelow(track, Pattern::maxTracks))
+            return false;
+
+        heap[(size_t) size++] = { sampleTime, track, generations[(size_t) track] };
+        std::push_heap(heap.begin(), heap.begin() + size, laterFirst);
+        return true;
+    }
+
+    // Anula el Note Off pendiente de una pista (se ha cortado antes)
+    void cancel(int track)
+    {
+        if (juce::isPositiveAndBelow(track, Pattern::maxTracks))
+            ++generations[(size_t) track];
+    }
+
+    // Saca en orden los Note Offs con sampleTime <= lastSample y llama a
+    // callback(track, sampleTime) por cada uno que siga vigente
+    template <typename Callback>
+    void releaseDue(juce::int64 lastSample, Callback&& callback)
+    {
+        while (size > 0 && heap[0].sampleTime <= lastSample)
+        {
+            std::pop_heap(heap.begin(), heap.begin() + size, laterFirst);
+            const auto entry = heap[(size_t) --size];
+
+            if (entry.generation == generations[(size_t) entry.track])
+                callback(entry.track, entry.sampleTime);
+        }
+    }
+
+    // Descarta todo lo pendiente (las notas se han cortado de golpe)
+    void clear()
+    {
+        size = 0;
+
+        for (auto& generation : generations)
+            ++generation;
+    }
+
+    bool isEmpty() const { return size == 0; }
+
+private:
+    struct Entry
+    {
+        juce::int64 sampleTime = 0;
+        int track = 0;
+        juce::uint32 generation = 0;
+    };
+
+    static bool laterFirst(const Entry& a, const Entry& b) { return a.sampleTime > b.sampleTime; }
+
+    std::array<Entry, capacity> heap {};
+    std::array<juce::uint32, Pattern::maxTracks> generations {};
+    int size = 0;
+
+    JUCE_DECLARE_NON_COPYABLE(NoteOffScheduler)
+};
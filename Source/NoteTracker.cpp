@@ -0,0 +1,80 @@
+#include "NoteTracker.h"
+
+//==============================================================================
+void NoteTracker::beginBlock(int numSamples, double newPpqPerSample)
+{
+    blockSize = numSamples;
+    ppqPerSample = newPpqPerSample;
+}
+
+void NoteTracker::endBlock(Output& output)
+{
+    // Note Offs que vencen dentro de este bloque, aunque se programaran en otro anterior
+    releaseDue(blockStartSample + blockSize - 1, output);
+    blockStartSample += blockSize;
+}
+
+void NoteTracker::trigger(const CompiledPattern::Event& event, int sampleOffset, Output& output)
+{
+    // Una nota que acaba justo donde empieza la siguiente se apaga antes
+    releaseUpTo(sampleOffset, output);
+    startNote(event.track, sampleOffset, event.gatePpq, event.velocity, output);
+}
+
+void NoteTracker::startNote(int track, int sampleOffset, double gatePpq, int velocity, Output& output)
+{
+    const auto bit = 1u << track;
+
+    // Si la pista sigue sonando se corta antes, para no apilar dos notas iguales
+    if ((activeNotes & bit) != 0)
+    {
+        noteOffs.cancel(track);
+        stopNote(track, sampleOffset, output);
+    }
+
+    output.noteStarted(track, sampleOffset, velocity);
+    activeNotes |= bit;
+
+    // El gate se pasa a samples con el tempo actual; dura al menos un sample
+    const auto gateSamples = juce::jmax((juce::int64) 1, (juce::int64) std::llround(gatePpq / ppqPerSample));
+
+    if (!noteOffs.schedule(track, blockStartSample + sampleOffset + gateSamples))
+    {
+        // Sin sitio en el montículo: mejor una nota corta que una colgada
+        jassertfalse;
+        stopNote(track, sampleOffset, output);
+    }
+}
+
+void NoteTracker::releaseUpTo(int sampleOffset, Output& output)
+{
+    releaseDue(blockStartSample + sampleOffset, output);
+}
+
+void NoteTracker::releaseAll(int sampleOffset, Output& output)
+{
+    for (int track = 0; activeNotes != 0 && track < Pattern::maxTracks; ++track)
+    {
+        if ((activeNotes & (1u << track)) != 0)
+            stopNote(track, sampleOffset, output);
+    }
+
+    noteOffs.clear();
+}
+
+void NoteTracker::stopNote(int track, int sampleOffset, Output& output)
+{
+    output.noteStopped(track, sampleOffset);
+    activeNotes &= ~(1u << track);
+}
+
+void NoteTracker::releaseDue(juce::int64 lastSample, Output& output)
+{
+    noteOffs.releaseDue(lastSample, [this, &output](int track, juce::int64 sampleTime)
+                        {
+                            // Un Note Off vencido antes de este bloque (no debería pasar) sale al principio
+                            const auto offset = juce::jlimit((juce::int64) 0, (juce::int64) juce::jmax(0, blockSize - 1),
+                                                             sampleTime - blockStartSample);
+                            stopNote(track, (int) offset, output);
+                        });
+}
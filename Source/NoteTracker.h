@@ -0,0 +1,65 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "CompiledPattern.h"
+#include "NoteOffScheduler.h"
+
+//==============================================================================
+/**
+ * Notas que genera el secuenciador: Note On de cada evento y su Note Off al
+ * cumplirse el gate, en samples absolutos.
+ *
+ * Es la misma lógica para la reproducción en vivo (MidiHandler) y para el render
+ * offline (PatternRenderer), de modo que ambos producen exactamente los mismos
+ * eventos. Quién recibe las notas lo decide el Output. No reserva memoria.
+ */
+class NoteTracker
+{
+public:
+    class Output
+    {
+    public:
+        virtual ~Output() = default;
+
+        virtual void noteStarted(int track, int sampleOffset, int velocity) = 0;
+        virtual void noteStopped(int track, int sampleOffset) = 0;
+    };
+
+    NoteTracker() = default;
+
+    // Velocidad MIDI de una nota: la del paso escalada por el nivel de la pista. La
+    // misma cuenta en vivo y en el render
+    static juce::uint8 getOutputVelocity(int velocity, float trackLevel)
+    {
+        return (juce::uint8) juce::jlimit(1, 127, juce::roundToInt(trackLevel * (float) velocity / 127.0f * 127.0f));
+    }
+
+    // Al principio de cada bloque, con el tempo vigente para pasar gates a samples
+    void beginBlock(int numSamples, double newPpqPerSample);
+
+    // Saca los Note Offs que vencen dentro del bloque y pasa al siguiente
+    void endBlock(Output& output);
+
+    // Evento del patrón compilado: primero los Note Offs que vencen hasta ese sample
+    // (incluido), después el Note On de su pista
+    void trigger(const CompiledPattern::Event& event, int sampleOffset, Output& output);
+
+    void startNote(int track, int sampleOffset, double gatePpq, int velocity, Output& output);
+    void releaseUpTo(int sampleOffset, Output& output);
+    void releaseAll(int sampleOffset, Output& output);
+
+    juce::uint32 getActiveNotes() const         { return activeNotes; }
+    juce::int64 getBlockStartSample() const     { return blockStartSample; }
+
+private:
+    NoteOffScheduler noteOffs;
+    juce::uint32 activeNotes = 0;       // Bit por pista
+    juce::int64 blockStartSample = 0;   // Sample absoluto del inicio del bloque en curso
+    int blockSize = 0;
+    double ppqPerSample = 0.0;
+
+    void stopNote(int track, int sampleOffset, Output& output);
+    void releaseDue(juce::int64 lastSample, Output& output);
+
+    JUCE_DECLARE_NON_COPYABLE(NoteTracker)
+};
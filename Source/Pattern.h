@@ -0,0 +1,262 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+
+//==============================================================================
+/**
+ * Patrón del secuenciador guardado en bits.
+ *
+ * Cada pista es una palabra de 64 bits (bit n = paso n). Cada paso guarda
+ * también su duración de nota (gate) y su desplazamiento fino (microtiming). Cada
+ * nota guarda su velocidad y su desplazamiento propio (lo que deja la cuantización
+ * al grabar en vivo). Todo cabe en unos 5 KB, así que copiarlo entero es barato.
+ * El swing no es del patrón sino de la sesión: es un parámetro del host que el
+ * motor aplica al tocar.
+ *
+ * Cada pista tiene además su propia longitud (1-64 pasos) y su propia duración de
+ * paso (de fusa a compás, con tresillos), de modo que las pistas pueden sonar en
+ * polimetría. numSteps es la longitud nominal del patrón, a semicorcheas.
+ */
+class Pattern
+{
+public:
+    static constexpr int maxTracks = 32;
+    static constexpr int maxSteps = 64;
+
+    static constexpr int defaultNumTracks = 8;
+    static constexpr int defaultNumSteps = 16;
+
+    // Gate en dieciseisavos de paso: 16 = la nota dura exactamente un paso
+    static constexpr int gateUnitsPerStep = 16;
+    static constexpr int maxGate = 255;
+
+    // Microtiming en 1/96 de paso, hasta medio paso hacia delante o hacia atrás
+    static constexpr int microTicksPerStep = 96;
+    static constexpr int maxMicroTicks = microTicksPerStep / 2;
+
+    // Velocidad de una nota recién activada
+    static constexpr int defaultVelocity = 127;
+
+    // Swing en porcentaje al estilo MPC: 50 = recto, 75 = tresillo marcado
+    static constexpr int minSwing = 50;
+    static constexpr int maxSwing = 75;
+
+    // Duración de paso de una pista. Las posiciones se miden en ticks de 1/24 de
+    // negra, así que todas las duraciones (también los tresillos) son enteras
+    enum class StepRate : juce::uint8
+    {
+        thirtySecond, sixteenthTriplet, sixteenth, eighthTriplet, eighth,
+        quarterTriplet, quarter, halfTriplet, half, bar,
+        numRates
+    };
+
+    static constexpr int ticksPerQuarter = 24;
+
+    static int getStepTicks(StepRate rate)
+    {
+        static constexpr int ticks[] = { 3, 4, 6, 8, 12, 16, 24, 32, 48, 96 };
+        return ticks[juce::jlimit(0, (int) StepRate::numRates - 1, (int) rate)];
+    }
+
+    static const char* getRateName(StepRate rate)
+    {
+        static const char* const names[] = { "1/32", "1/16T", "1/16", "1/8T", "1/8",
+                                             "1/4T", "1/4", "1/2T", "1/2", "1 bar" };
+        return names[juce::jlimit(0, (int) StepRate::numRates - 1, (int) rate)];
+    }
+
+    Pattern() = default;
+
+    int getNumTracks() const    { return numTracks; }
+    int getNumSteps() const     { return numSteps; }
+
+    void setNumTracks(int newNumTracks)     { numTracks = juce::jlimit(1, maxTracks, newNumTracks); }
+    void setNumSteps(int newNumSteps)       { numSteps = juce::jlimit(1, maxSteps, newNumSteps); }
+
+    void setStep(int track, int step, bool isActive)
+    {
+        if (!juce::isPositiveAndBelow(track, maxTracks) || !juce::isPositiveAndBelow(step, maxSteps))
+            return;
+
+        const auto stepBit = (juce::uint64) 1 << step;
+
+        if (isActive)
+        {
+            rows[(size_t) track] |= stepBit;
+        }
+        else
+        {
+            rows[(size_t) track] &= ~stepBit;
+
+            // Una nota que se vuelve a activar empieza con los valores por defecto
+            velocities[(size_t) track][(size_t) step] = (juce::uint8) defaultVelocity;
+            nudges[(size_t) track][(size_t) step] = 0;
+        }
+    }
+
+    bool getStep(int track, int step) const
+    {
+        return juce::isPositiveAndBelow(track, maxTracks)
+            && juce::isPositiveAndBelow(step, maxSteps)
+            && ((rows[(size_t) track] >> step) & 1) != 0;
+    }
+
+    // Fila completa de una pista, limitada a la longitud de la pista
+    juce::uint64 getRow(int track) const
+    {
+        return juce::isPositiveAndBelow(track, maxTracks) ? rows[(size_t) track] & getStepMask(getTrackLength(track)) : 0;
+    }
+
+    // Fila tal y como está guardada, con los pasos que quedan fuera de la longitud de
+    // la pista (vuelven a sonar si se alarga). Para guardar y cargar el patrón
+    juce::uint64 getStoredRow(int track) const
+    {
+        return juce::isPositiveAndBelow(track, maxTracks) ? rows[(size_t) track] : 0;
+    }
+
+    void setStoredRow(int track, juce::uint64 bits)
+    {
+        if (juce::isPositiveAndBelow(track, maxTracks))
+            rows[(size_t) track] = bits;
+    }
+
+    void setTrackLength(int track, int length)
+    {
+        if (juce::isPositiveAndBelow(track, maxTracks))
+            trackLengths[(size_t) track] = (juce::uint8) juce::jlimit(1, maxSteps, length);
+    }
+
+    int getTrackLength(int track) const
+    {
+        return juce::isPositiveAndBelow(track, maxTracks) ? trackLengths[(size_t) track] : defaultNumSteps;
+    }
+
+    void setTrackRate(int track, StepRate rate)
+    {
+        if (juce::isPositiveAndBelow(track, maxTracks) && juce::isPositiveAndBelow((int) rate, (int) StepRate::numRates))
+            trackRates[(size_t) track] = rate;
+    }
+
+    StepRate getTrackRate(int track) const
+    {
+        return juce::isPositiveAndBelow(track, maxTracks) ? trackRates[(size_t) track] : StepRate::sixteenth;
+    }
+
+    void setGate(int step, int gate)
+    {
+        if (juce::isPositiveAndBelow(step, maxSteps))
+            gates[(size_t) step] = (juce::uint8) juce::jlimit(1, maxGate, gate);
+    }
+
+    int getGate(int step) const
+    {
+        return juce::isPositiveAndBelow(step, maxSteps) ? gates[(size_t) step] : gateUnitsPerStep;
+    }
+
+    void setMicroTiming(int step, int ticks)
+    {
+        if (juce::isPositiveAndBelow(step, maxSteps))
+            microTimings[(size_t) step] = (juce::int8) juce::jlimit(-maxMicroTicks, maxMicroTicks, ticks);
+    }
+
+    int getMicroTiming(int step) const
+    {
+        return juce::isPositiveAndBelow(step, maxSteps) ? microTimings[(size_t) step] : 0;
+    }
+
+    // Velocidad de cada nota (1-127)
+    void setVelocity(int track, int step, int velocity)
+    {
+        if (juce::isPositiveAndBelow(track, maxTracks) && juce::isPositiveAndBelow(step, maxSteps))
+            velocities[(size_t) track][(size_t) step] = (juce::uint8) juce::jlimit(1, 127, velocity);
+    }
+
+    int getVelocity(int track, int step) const
+    {
+        return juce::isPositiveAndBelow(track, maxTracks) && juce::isPositiveAndBelow(step, maxSteps)
+            ? velocities[(size_t) track][(size_t) step] : defaultVelocity;
+    }
+
+    // Desplazamiento de una nota respecto a su paso, en las mismas unidades que el
+    // microtiming y sumado a él
+    void setNudge(int track, int step, int ticks)
+    {
+        if (juce::isPositiveAndBelow(track, maxTracks) && juce::isPositiveAndBelow(step, maxSteps))
+            nudges[(size_t) track][(size_t) step] = (juce::int8) juce::jlimit(-maxMicroTicks, maxMicroTicks, ticks);
+    }
+
+    int getNudge(int track, int step) const
+    {
+        return juce::isPositiveAndBelow(track, maxTracks) && juce::isPositiveAndBelow(step, maxSteps)
+            ? nudges[(size_t) track][(size_t) step] : 0;
+    }
+
+    // Vacía una pista entera (grabación en modo reemplazo)
+    void clearTrack(int track)
+    {
+        if (!juce::isPositiveAndBelow(track, maxTracks))
+            return;
+
+        setStoredRow(track, 0);
+        velocities[(size_t) track].fill((juce::uint8) defaultVelocity);
+        nudges[(size_t) track].fill(0);
+    }
+
+    bool operator== (const Pattern& other) const
+    {
+        return numTracks == other.numTracks && numSteps == other.numSteps
+            && rows == other.rows && gates == other.gates && microTimings == other.microTimings
+            && trackLengths == other.trackLengths && trackRates == other.trackRates
+            && velocities == other.velocities && nudges == other.nudges;
+    }
+
+    bool operator!= (const Pattern& other) const  { return !operator==(other); }
+
+private:
+    std::array<juce::uint64, maxTracks> rows {};
+    std::array<juce::uint8, maxSteps> gates = makeDefaultGates();
+    std::array<juce::int8, maxSteps> microTimings {};
+    std::array<juce::uint8, maxTracks> trackLengths = makeDefaultTrackLengths();
+    std::array<StepRate, maxTracks> trackRates = makeDefaultTrackRates();
+    std::array<std::array<juce::uint8, maxSteps>, maxTracks> velocities = makeDefaultVelocities();
+    std::array<std::array<juce::int8, maxSteps>, maxTracks> nudges {};
+    int numTracks = defaultNumTracks;
+    int numSteps = defaultNumSteps;
+
+    static std::array<juce::uint8, maxSteps> makeDefaultGates()
+    {
+        std::array<juce::uint8, maxSteps> defaultGates;
+        defaultGates.fill((juce::uint8) gateUnitsPerStep);
+        return defaultGates;
+    }
+
+    static std::array<juce::uint8, maxTracks> makeDefaultTrackLengths()
+    {
+        std::array<juce::uint8, maxTracks> defaultLengths;
+        defaultLengths.fill((juce::uint8) defaultNumSteps);
+        return defaultLengths;
+    }
+
+    static std::array<StepRate, maxTracks> makeDefaultTrackRates()
+    {
+        std::array<StepRate, maxTracks> defaultRates;
+        defaultRates.fill(StepRate::sixteenth);
+        return defaultRates;
+    }
+
+    static std::array<std::array<juce::uint8, maxSteps>, maxTracks> makeDefaultVelocities()
+    {
+        std::array<std::array<juce::uint8, maxSteps>, maxTracks> defaultVelocities;
+
+        for (auto& row : defaultVelocities)
+            row.fill((juce::uint8) defaultVelocity);
+
+        return defaultVelocities;
+    }
+
+    static juce::uint64 getStepMask(int length)
+    {
+        return length >= 64 ? ~(juce::uint64) 0 : (((juce::uint64) 1 << length) - 1);
+    }
+};
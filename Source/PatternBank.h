@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Pattern.h"
+
+//==============================================================================
+/**
+ * Banco de patrones y cadena del modo canción, tal y como los edita el usuario.
+ *
+ * Vive en el hilo de mensajes. El hilo de audio nunca lo lee: recibe versiones
+ * compiladas de cada patrón (ver CompiledPattern).
+ */
+struct PatternBank
+{
+    static constexpr int numPatterns = 16;
+    static constexpr int maxChainLength = 64;
+
+    std::array<Pattern, numPatterns> patterns {};
+
+    // Cadena del modo canción: índices de patrón que se tocan en orden
+    std::array<int, maxChainLength> chain {};
+    int chainLength = 0;
+    bool songMode = false;
+
+    // Patrón seleccionado para editar y tocar en modo patrón
+    int selectedPattern = 0;
+
+    Pattern& getSelectedPattern()               { return patterns[(size_t) selectedPattern]; }
+    const Pattern& getSelectedPattern() const   { return patterns[(size_t) selectedPattern]; }
+};
@@ -0,0 +1,185 @@
+#include "PatternRenderer.h"
+#include "CompiledPattern.h"
+#include "NoteTracker.h"
+#include "RealtimeSafetyChecker.h"
+#include "SequencerClock.h"
+#include "SequencerEngine.h"
+
+namespace
+{
+    // Nota MIDI de la primera pista, igual que en la salida del plugin
+    constexpr int firstTrackNote = 60;
+
+    //==============================================================================
+    // Recibe los eventos del motor y los escribe en la secuencia, en ticks
+    class RenderSession : public SequencerEngine::Listener,
+                          public NoteTracker::Output
+    {
+    public:
+        RenderSession(const PatternRenderer::Settings& s, juce::MidiMessageSequence& target)
+            : settings(s), sequence(target)
+        {
+        }
+
+        void stepTriggered(int sampleOffset, const CompiledPattern::Event& event) override
+        {
+            // Las pistas en mute no suenan, igual que en vivo
+            if ((settings.mutedTracks & (1u << event.track)) == 0)
+                notes.trigger(event, sampleOffset, *this);
+        }
+
+        void noteStarted(int track, int sampleOffset, int velocity) override
+        {
+            const auto outputVelocity = NoteTracker::getOutputVelocity(velocity, settings.trackLevels[(size_t) track]);
+            sequence.addEvent(juce::MidiMessage::noteOn(settings.midiChannel, firstTrackNote + track, outputVelocity),
+                              toTicks(sampleOffset));
+        }
+
+        void noteStopped(int track, int sampleOffset) override
+        {
+            sequence.addEvent(juce::MidiMessage::noteOff(settings.midiChannel, firstTrackNote + track),
+                              toTicks(sampleOffset));
+        }
+
+        void renderBlock(const SequencerClock::BlockTiming& timing, SequencerEngine& engine, int numSamples)
+        {
+            // Sin host el bloque es un solo tramo lineal
+            blockStartPpq = timing.segments[0].ppqStart;
+            ppqPerSample = timing.ppqPerSample;
+
+            notes.beginBlock(numSamples, ppqPerSample);
+            engine.process(timing, *this);
+            notes.endBlock(*this);
+
+            blockStartPpq += numSamples * ppqPerSample;
+        }
+
+        // Las notas que siguen sonando se cortan al final del render
+        void finish()
+        {
+            notes.releaseAll(0, *this);
+        }
+
+    private:
+        const PatternRenderer::Settings& settings;
+        juce::MidiMessageSequence& sequence;
+        NoteTracker notes;
+
+        double blockStartPpq = 0.0;
+        double ppqPerSample = 0.0;
+
+        double toTicks(int sampleOffset) const
+        {
+            // Posición del sample en el que cae el evento, igual que en vivo
+            const auto ppq = blockStartPpq + sampleOffset * ppqPerSample;
+            return std::round(ppq * settings.ticksPerQuarterNote);
+        }
+    };
+
+    double getPpqPerSample(double bpm, double sampleRate)
+    {
+        return bpm / (60.0 * sampleRate);
+    }
+}
+
+//==============================================================================
+juce::MidiFile PatternRenderer::render(const PatternBank& bank, const Settings& settings)
+{
+    SPARKLE_NON_REALTIME_CALL("PatternRenderer::render");
+    jassert(settings.sampleRate > 0.0 && settings.blockSize > 0 && settings.bpm > 0.0);
+
+    // Patrones compilados igual que para el hilo de audio
+    std::array<std::unique_ptr<CompiledPattern>, PatternBank::numPatterns> compiled;
+    SequencerEngine engine;
+
+    for (int slot = 0; slot < PatternBank::numPatterns; ++slot)
+    {
+        compiled[(size_t) slot] = CompiledPattern::compile(bank.patterns[(size_t) slot]);
+        engine.setPattern(slot, compiled[(size_t) slot].get());
+    }
+
+    for (int position = 0; position < bank.chainLength; ++position)
+        engine.setChainEntry(position, bank.chain[(size_t) position]);
+
+    engine.setChainLength(bank.chainLength);
+    engine.setSongMode(bank.songMode);
+    engine.selectPattern(bank.selectedPattern);
+    engine.setSwing(settings.swing);
+    engine.reset();
+
+    SequencerClock clock;
+    clock.prepare(settings.sampleRate);
+    clock.setTempo(settings.bpm);
+    clock.start();
+
+    // Pista de tempo y pista de notas
+    juce::MidiMessageSequence tempoTrack, noteTrack;
+    tempoTrack.addEvent(juce::MidiMessage::timeSignatureMetaEvent(4, 4), 0.0);
+    tempoTrack.addEvent(juce::MidiMessage::tempoMetaEvent(juce::roundToInt(60.0e6 / settings.bpm)), 0.0);
+
+    RenderSession session(settings, noteTrack);
+
+    const auto endPpq = settings.lengthInBars * SequencerEngine::ppqPerBar;
+    auto bpm = settings.bpm;
+    auto ppq = 0.0;
+    int nextTempoChange = 0;
+
+    while (ppq < endPpq)
+    {
+        // Aplica los cambios de tempo que ya se han alcanzado
+        while (nextTempoChange < settings.tempoChanges.size()
+               && settings.tempoChanges.getReference(nextTempoChange).ppq <= ppq)
+        {
+            const auto& change = settings.tempoChanges.getReference(nextTempoChange++);
+
+            if (change.bpm > 0.0)
+            {
+                bpm = change.bpm;
+                clock.setTempo(bpm);
+                tempoTrack.addEvent(juce::MidiMessage::tempoMetaEvent(juce::roundToInt(60.0e6 / bpm)),
+                                    std::round(change.ppq * settings.ticksPerQuarterNote));
+            }
+        }
+
+        // El bloque termina en el siguiente cambio de tempo o en el final
+        auto boundaryPpq = endPpq;
+
+        if (nextTempoChange < settings.tempoChanges.size())
+            boundaryPpq = juce::jmin(boundaryPpq, settings.tempoChanges.getReference(nextTempoChange).ppq);
+
+        const auto samplesToBoundary = std::ceil((boundaryPpq - ppq) / getPpqPerSample(bpm, settings.sampleRate) - 1.0e-9);
+        const auto numSamples = (int) juce::jlimit(1.0, (double) settings.blockSize, samplesToBoundary);
+
+        const auto timing = clock.advance(numSamples, nullptr);
+        session.renderBlock(timing, engine, numSamples);
+        ppq = timing.segments[0].ppqEnd;
+    }
+
+    session.finish();
+
+    const auto endTick = std::round(endPpq * settings.ticksPerQuarterNote);
+    tempoTrack.addEvent(juce::MidiMessage::endOfTrack(), endTick);
+    noteTrack.addEvent(juce::MidiMessage::endOfTrack(), endTick);
+    noteTrack.updateMatchedPairs();
+
+    juce::MidiFile midiFile;
+    midiFile.setTicksPerQuarterNote(settings.ticksPerQuarterNote);
+    midiFile.addTrack(tempoTrack);
+    midiFile.addTrack(noteTrack);
+
+    // El motor solo guarda punteros: se sueltan antes de liberar los patrones
+    for (int slot = 0; slot < PatternBank::numPatterns; ++slot)
+        engine.setPattern(slot, nullptr);
+
+    return midiFile;
+}
+
+bool PatternRenderer::renderToFile(const PatternBank& bank, const Settings& settings, const juce::File& file)
+{
+    const auto midiFile = render(bank, settings);
+
+    file.deleteFile();
+    juce::FileOutputStream stream(file);
+
+    return stream.openedOk() && midiFile.writeTo(stream);
+}
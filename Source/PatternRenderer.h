@@ -0,0 +1,58 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+#include "PatternBank.h"
+
+//==============================================================================
+/**
+ * Render offline de patrones y canciones a un fichero MIDI estándar.
+ *
+ * Usa el mismo reloj (SequencerClock), el mismo motor (SequencerEngine) y la misma
+ * lógica de notas (NoteTracker) que la reproducción en vivo, pero sin dispositivo
+ * de audio ni salida al hardware y con bloques grandes, así que cada evento cae en
+ * el mismo sample que en vivo y el render va miles de veces más rápido que el
+ * tiempo real. Se puede llamar desde cualquier hilo: no comparte estado con el
+ * MidiHandler.
+ */
+class PatternRenderer
+{
+public:
+    // Cambio de tempo en una posición (en negras desde el inicio)
+    struct TempoChange
+    {
+        double ppq = 0.0;
+        double bpm = 120.0;
+    };
+
+    struct Settings
+    {
+        double lengthInBars = 4.0;
+        double bpm = 120.0;                     // Tempo inicial
+        juce::Array<TempoChange> tempoChanges;  // Ordenados por posición
+        int swing = Pattern::minSwing;          // Swing de la sesión
+
+        // Nivel de cada pista, que escala la velocidad igual que en vivo, y pistas
+        // en mute (bit por pista), que no suenan
+        std::array<float, Pattern::maxTracks> trackLevels = getUnityLevels();
+        juce::uint32 mutedTracks = 0;
+
+        int ticksPerQuarterNote = 960;
+        double sampleRate = 48000.0;            // Resolución temporal del render
+        int blockSize = 4096;                   // No cambia el resultado, solo la velocidad
+        int midiChannel = 1;
+
+        static std::array<float, Pattern::maxTracks> getUnityLevels()
+        {
+            std::array<float, Pattern::maxTracks> levels;
+            levels.fill(1.0f);
+            return levels;
+        }
+    };
+
+    // Toca el banco tal y como lo haría el plugin: la cadena si está en modo
+    // canción o el patrón seleccionado en bucle
+    static juce::MidiFile render(const PatternBank& bank, const Settings& settings);
+
+    static bool renderToFile(const PatternBank& bank, const Settings& settings, const juce::File& file);
+};
@@ -5,14 +5,15 @@
 SparkLEPluginAudioProcessorEditor::SparkLEPluginAudioProcessorEditor(SparkLEPluginAudioProcessor& p)
     : AudioProcessorEditor(&p), audioProcessor(p)
 {
-    juce::Logger::writeToLog("SparkLEPlugin: Creando el editor del plugin");
+    SPARKLE_LOG_DEBUG("SparkLEPlugin: Creando el editor del plugin");
     
     // Configura un tamaño mayor para acomodar el secuenciador
     setSize(800, 600);
+    setOpaque(true);
     
     // Primero creamos el secuenciador antes que otros componentes
     try {
-        juce::Logger::writeToLog("SparkLEPlugin: Inicializando componente del secuenciador");
+        SPARKLE_LOG_DEBUG("SparkLEPlugin: Inicializando componente del secuenciador");
         sequencerComponent = std::make_unique<SequencerComponent>(audioProcessor);
         
         // Forzamos un tamaño específico para el secuenciador para depuración
@@ -20,10 +21,10 @@ SparkLEPluginAudioProcessorEditor::SparkLEPluginAudioProcessorEditor(SparkLEPlug
         
         // Lo añadimos a la jerarquía de componentes
         addAndMakeVisible(*sequencerComponent);
-        juce::Logger::writeToLog("SparkLEPlugin: Secuenciador añadido correctamente");
+        SPARKLE_LOG_DEBUG("SparkLEPlugin: Secuenciador añadido correctamente");
     }
     catch (const std::exception& e) {
-        juce::Logger::writeToLog("SparkLEPlugin ERROR: Error al crear secuenciador: " + juce::String(e.what()));
+        SPARKLE_LOG_ERROR("SparkLEPlugin: Error al crear secuenciador: " + juce::String(e.what()));
     }
     
     // Añade el botón de carga de samples por encima
@@ -31,67 +32,91 @@ SparkLEPluginAudioProcessorEditor::SparkLEPluginAudioProcessorEditor(SparkLEPlug
     loadSampleButton.setBounds(20, 60, 120, 30);
     loadSampleButton.setButtonText("Cargar Sample");
     loadSampleButton.onClick = [this] { 
-        juce::Logger::writeToLog("SparkLEPlugin: Botón de carga pulsado");
+        SPARKLE_LOG_DEBUG("SparkLEPlugin: Botón de carga pulsado");
         loadSampleButtonClicked();
     };
     
+    // El click también puede salir como nota MIDI (canal 10)
+    addAndMakeVisible(midiClickToggle);
+    midiClickToggle.setBounds(150, 20, 110, 30);
+    midiClickAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+        audioProcessor.getParameters(), PluginParameters::midiClickId, midiClickToggle);
+    
+    // Carga de un kit completo desde una carpeta
+    addAndMakeVisible(loadKitButton);
+    loadKitButton.setBounds(20, 20, 120, 30);
+    loadKitButton.setButtonText("Cargar Kit");
+    loadKitButton.onClick = [this] { loadKitButtonClicked(); };
+    
     // Añade el botón de reproducción
     addAndMakeVisible(playButton);
     playButton.setBounds(150, 60, 40, 30);
     playButton.setColour(juce::TextButton::buttonColourId, juce::Colours::green);
     playButton.setButtonText("Play");
     playButton.onClick = [this] {
-        if (audioProcessor.getMidiHandler()->isSequencerPlaying()) {
+        // Alterna lo que está sonando; el texto y el color cambian cuando el motor lo publica
+        if (enginePlaying) {
             audioProcessor.getMidiHandler()->stopSequencer();
-            playButton.setButtonText("Play");
-            playButton.setColour(juce::TextButton::buttonColourId, juce::Colours::green);
-            juce::Logger::writeToLog("SparkLEPlugin: Secuenciador detenido");
+            SPARKLE_LOG_INFO("SparkLEPlugin: Secuenciador detenido");
         } else {
             audioProcessor.getMidiHandler()->startSequencer();
-            playButton.setButtonText("Stop");
-            playButton.setColour(juce::TextButton::buttonColourId, juce::Colours::red);
-            juce::Logger::writeToLog("SparkLEPlugin: Secuenciador iniciado");
+            SPARKLE_LOG_INFO("SparkLEPlugin: Secuenciador iniciado");
         }
     };
 
-    // Añade el botón de click
+    // Añade el botón de click: alterna el parámetro "click"
     addAndMakeVisible(clickButton);
     clickButton.setBounds(220, 60, 80, 30);
-    clickButton.setColour(juce::TextButton::buttonColourId, juce::Colours::darkgreen);
+    clickButton.setClickingTogglesState(true);
+    clickButton.setColour(juce::TextButton::buttonColourId, juce::Colours::darkgrey);
+    clickButton.setColour(juce::TextButton::buttonOnColourId, juce::Colours::darkgreen);
     clickButton.onClick = [this] {
-        // Actualiza el estado del click en el MidiHandler
-        audioProcessor.getMidiHandler()->clickEnabled = !audioProcessor.getMidiHandler()->clickEnabled;
-        clickButton.setButtonText(audioProcessor.getMidiHandler()->clickEnabled ? "Click ON" : "Click OFF");
-        clickButton.setColour(juce::TextButton::buttonColourId, 
-                        audioProcessor.getMidiHandler()->clickEnabled ? juce::Colours::darkgreen : juce::Colours::darkgrey);
-        juce::Logger::writeToLog("SparkLEPlugin: Click " + juce::String(audioProcessor.getMidiHandler()->clickEnabled ? "activado" : "desactivado"));
+        updateClickButton();
+        SPARKLE_LOG_DEBUG("SparkLEPlugin: Click " + juce::String(clickButton.getToggleState() ? "activado" : "desactivado"));
     };
+    clickAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+        audioProcessor.getParameters(), PluginParameters::clickId, clickButton);
+    updateClickButton();
     
     // Añade el control de tempo
     addAndMakeVisible(tempoLabel);
     tempoLabel.setBounds(310, 60, 60, 30);
     tempoLabel.setJustificationType(juce::Justification::right);
 
+    // El rango y el valor los pone el parámetro "tempo"
     addAndMakeVisible(tempoSlider);
-    tempoSlider.setRange(60.0, 200.0, 1.0);
-    tempoSlider.setValue(120.0);
     tempoSlider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 50, 20);
     tempoSlider.setBounds(370, 60, 150, 30);
-    tempoSlider.onValueChange = [this] {
-        double newTempo = tempoSlider.getValue();
-        audioProcessor.getMidiHandler()->setTempo(newTempo);
-        juce::Logger::writeToLog("SparkLEPlugin: Tempo establecido a " + juce::String(newTempo) + " BPM");
-    };
+    tempoAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(
+        audioProcessor.getParameters(), PluginParameters::tempoId, tempoSlider);
+    
+    // Añade el selector de patrón del banco
+    setupPatternSelector();
+    
+    // Pad en el que se carga el sample
+    setupSamplePadSelector();
+    
+    // Asignación de notas y CCs del controlador
+    setupMidiLearn();
+    
+    // Grabación en vivo desde los pads
+    setupRecording();
+    
+    // Panel de diagnóstico, oculto hasta que se pide con el teclado
+    diagnostics = std::make_unique<DiagnosticsComponent>(audioProcessor.getMidiHandler()->getTelemetry());
+    diagnostics->setBounds(20, 100, 760, 400);
+    addChildComponent(*diagnostics);
+    setWantsKeyboardFocus(true);
     
     // Inicia el timer para actualizar la UI
     startTimer(16); // Aproximadamente 60 fps
     
-    juce::Logger::writeToLog("SparkLEPlugin: Editor creado correctamente");
+    SPARKLE_LOG_DEBUG("SparkLEPlugin: Editor creado correctamente");
 }
 
 SparkLEPluginAudioProcessorEditor::~SparkLEPluginAudioProcessorEditor()
 {
-    juce::Logger::writeToLog("SparkLEPlugin: Destruyendo el editor del plugin");
+    SPARKLE_LOG_DEBUG("SparkLEPlugin: Destruyendo el editor del plugin");
 }
 
 //==============================================================================
@@ -110,7 +135,7 @@ void SparkLEPluginAudioProcessorEditor::resized()
 {
     // Nota: No hacemos nada aquí porque hemos establecido las posiciones explícitamente
     // en el constructor para fines de depuración
-    juce::Logger::writeToLog("SparkLEPlugin: resized() llamado - no ajustamos posiciones aquí");
+    SPARKLE_LOG_DEBUG("SparkLEPlugin: resized() llamado - no ajustamos posiciones aquí");
 }
 
 void SparkLEPluginAudioProcessorEditor::timerCallback()
@@ -119,38 +144,258 @@ void SparkLEPluginAudioProcessorEditor::timerCallback()
     if (sequencerComponent != nullptr)
         sequencerComponent->updateDisplay();
     
-    repaint();
+    // El host puede restaurar un proyecto con el editor abierto
+    updateControlsFromState();
+    
+    // Nombre del sample de cada pad, que llega cuando termina de decodificarse
+    auto* midiHandler = audioProcessor.getMidiHandler();
+    
+    for (int pad = 0; pad < SamplePlayer::numPads; ++pad)
+    {
+        const auto name = midiHandler->getSampleName(pad);
+        const auto text = "Pad " + juce::String(pad + 1) + (name.isNotEmpty() ? ": " + name : juce::String());
+        
+        if (samplePadSelector.getItemText(pad) != text)
+            samplePadSelector.changeItemText(pad + 1, text);
+    }
+    
+    // La telemetría se lee aunque el panel esté oculto si se está registrando a CSV
+    if (diagnostics != nullptr && (diagnostics->isVisible() || diagnostics->isRecording()))
+        diagnostics->update();
+    
+    // El fondo y el título no cambian: el editor solo se repinta al cambiar de tamaño
+}
+
+bool SparkLEPluginAudioProcessorEditor::keyPressed(const juce::KeyPress& key)
+{
+    const auto toggleDiagnostics = juce::KeyPress('d', juce::ModifierKeys::commandModifier | juce::ModifierKeys::shiftModifier, 0);
+    
+    if (key == toggleDiagnostics && diagnostics != nullptr)
+    {
+        diagnostics->setVisible(!diagnostics->isVisible());
+        diagnostics->toFront(false);
+        return true;
+    }
+    
+    return false;
 }
 
 void SparkLEPluginAudioProcessorEditor::loadSampleButtonClicked()
 {
-    juce::Logger::writeToLog("SparkLEPlugin: Función de carga de samples llamada");
+    SPARKLE_LOG_DEBUG("SparkLEPlugin: Función de carga de samples llamada");
+    
+    // El FileChooser tiene que seguir vivo mientras el diálogo asíncrono está abierto
+    sampleChooser = std::make_unique<juce::FileChooser>("Selecciona un sample...",
+                                                        juce::File::getSpecialLocation(juce::File::userHomeDirectory),
+                                                        "*.wav;*.aif;*.aiff;*.flac");
     
-    // Crea un FileChooser básico para probar
-    juce::FileChooser chooser("Selecciona un sample...",
-                             juce::File::getSpecialLocation(juce::File::userHomeDirectory),
-                             "*.wav;*.aif;*.aiff");
+    const auto pad = samplePadSelector.getSelectedId() - 1;
     
     // La API moderna de JUCE usa launchAsync
-    chooser.launchAsync(juce::FileBrowserComponent::openMode, 
-                       [this](const juce::FileChooser& fc)
+    sampleChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                               [this, pad](const juce::FileChooser& fc)
     {
         if (fc.getResults().size() > 0)
         {
             juce::File file = fc.getResults().getReference(0);
-            juce::Logger::writeToLog("SparkLEPlugin: Archivo seleccionado: " + file.getFullPathName());
+            SPARKLE_LOG_INFO("SparkLEPlugin: Archivo seleccionado: " + file.getFullPathName());
+            
+            // Se decodifica en segundo plano; el nombre aparece en el selector al terminar
+            audioProcessor.getMidiHandler()->loadSample(pad, file);
         }
     });
 }
 
+void SparkLEPluginAudioProcessorEditor::loadKitButtonClicked()
+{
+    sampleChooser = std::make_unique<juce::FileChooser>("Selecciona la carpeta del kit...",
+                                                        juce::File::getSpecialLocation(juce::File::userHomeDirectory));
+    
+    sampleChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectDirectories,
+                               [this](const juce::FileChooser& fc)
+    {
+        if (fc.getResults().size() == 0)
+            return;
+        
+        // Un fichero por pad, en orden alfabético
+        const auto folder = fc.getResults().getReference(0);
+        auto files = folder.findChildFiles(juce::File::findFiles, false, "*.wav;*.aif;*.aiff;*.flac");
+        files.sort();
+        
+        SPARKLE_LOG_INFO("SparkLEPlugin: Kit seleccionado: " + folder.getFullPathName()
+                         + " (" + juce::String(files.size()) + " ficheros)");
+        
+        // El kit actual sigue sonando hasta que el nuevo está listo
+        audioProcessor.getMidiHandler()->loadKit(files);
+    });
+}
+
 void SparkLEPluginAudioProcessorEditor::setupPatternSelector()
 {
-    // Versión simplificada sin implementación
-    juce::Logger::writeToLog("SparkLEPlugin: setupPatternSelector - no implementado en versión simple");
+    addAndMakeVisible(patternSelector);
+    patternSelector.setBounds(530, 60, 110, 30);
+    
+    for (int i = 0; i < PatternBank::numPatterns; ++i)
+        patternSelector.addItem("Patrón " + juce::String(i + 1), i + 1);
+    
+    patternSelector.setSelectedId(audioProcessor.getMidiHandler()->getSelectedPattern() + 1, juce::dontSendNotification);
+    
+    // El patrón elegido se edita en la cuadrícula y empieza a sonar en el siguiente compás
+    patternSelector.onChange = [this] {
+        audioProcessor.getMidiHandler()->selectPattern(patternSelector.getSelectedId() - 1);
+        
+        if (sequencerComponent != nullptr)
+            sequencerComponent->repaint();
+    };
+}
+
+void SparkLEPluginAudioProcessorEditor::setupSamplePadSelector()
+{
+    addAndMakeVisible(samplePadSelector);
+    samplePadSelector.setBounds(650, 60, 130, 30);
+    
+    for (int pad = 0; pad < SamplePlayer::numPads; ++pad)
+        samplePadSelector.addItem("Pad " + juce::String(pad + 1), pad + 1);
+    
+    samplePadSelector.setSelectedId(1, juce::dontSendNotification);
+}
+
+void SparkLEPluginAudioProcessorEditor::setupMidiLearn()
+{
+    using Action = MidiInputMap::Action;
+    
+    const auto addTarget = [this](const juce::String& name, Action action, int argument)
+    {
+        learnTargets.add({ action, (juce::int8) argument });
+        learnTargetSelector.addItem(name, learnTargets.size());
+    };
+    
+    learnTargetSelector.addSectionHeading("Pads");
+    
+    for (int pad = 0; pad < MidiInputMap::sparkLENumPads; ++pad)
+        addTarget("Pad " + juce::String(pad + 1), Action::padTrigger, pad);
+    
+    learnTargetSelector.addSectionHeading("Mute");
+    
+    for (int track = 0; track < Pattern::maxTracks; ++track)
+        addTarget("Mute pista " + juce::String(track + 1), Action::muteTrack, track);
+    
+    learnTargetSelector.addSectionHeading("Patrones");
+    
+    for (int i = 0; i < PatternBank::numPatterns; ++i)
+        addTarget("Patrón " + juce::String(i + 1), Action::selectPattern, i);
+    
+    learnTargetSelector.addSectionHeading("Transporte");
+    addTarget("Play/Stop", Action::toggleTransport, 0);
+    addTarget("Play", Action::startTransport, 0);
+    addTarget("Stop", Action::stopTransport, 0);
+    addTarget("Grabar", Action::toggleRecording, 0);
+    addTarget("Tempo +1", Action::tempoNudge, 1);
+    addTarget("Tempo -1", Action::tempoNudge, -1);
+    
+    addAndMakeVisible(learnTargetSelector);
+    learnTargetSelector.setBounds(280, 20, 150, 30);
+    learnTargetSelector.setSelectedId(1, juce::dontSendNotification);
+    
+    // Pulsar otra vez mientras espera cancela
+    addAndMakeVisible(midiLearnButton);
+    midiLearnButton.setBounds(440, 20, 110, 30);
+    midiLearnButton.onClick = [this] {
+        auto* midiHandler = audioProcessor.getMidiHandler();
+        
+        if (midiHandler->isMidiLearnActive())
+            midiHandler->cancelMidiLearn();
+        else if (learnTargetSelector.getSelectedId() > 0)
+            midiHandler->beginMidiLearn(learnTargets[learnTargetSelector.getSelectedId() - 1]);
+    };
+}
+
+void SparkLEPluginAudioProcessorEditor::setupRecording()
+{
+    auto* midiHandler = audioProcessor.getMidiHandler();
+    
+    addAndMakeVisible(recordButton);
+    recordButton.setBounds(560, 20, 50, 30);
+    recordButton.setColour(juce::TextButton::buttonOnColourId, juce::Colours::red);
+    recordButton.setToggleState(midiHandler->isRecording(), juce::dontSendNotification);
+    recordButton.onClick = [this] {
+        auto* handler = audioProcessor.getMidiHandler();
+        handler->setRecording(!handler->isRecording());
+        SPARKLE_LOG_DEBUG("SparkLEPlugin: Grabación " + juce::String(handler->isRecording() ? "activada" : "desactivada"));
+    };
+    
+    addAndMakeVisible(recordModeSelector);
+    recordModeSelector.setBounds(615, 20, 85, 30);
+    recordModeSelector.addItem("Overdub", 1);
+    recordModeSelector.addItem("Reemplazo", 2);
+    recordModeSelector.setSelectedId(midiHandler->getRecordMode() == MidiHandler::RecordMode::replace ? 2 : 1,
+                                     juce::dontSendNotification);
+    recordModeSelector.onChange = [this] {
+        audioProcessor.getMidiHandler()->setRecordMode(recordModeSelector.getSelectedId() == 2 ? MidiHandler::RecordMode::replace
+                                                                                               : MidiHandler::RecordMode::overdub);
+    };
+    
+    // Fuerza de la cuantización: el Id es el porcentaje + 1
+    addAndMakeVisible(quantiseSelector);
+    quantiseSelector.setBounds(705, 20, 75, 30);
+    
+    for (int percent : { 100, 75, 50, 25, 0 })
+        quantiseSelector.addItem("Q " + juce::String(percent) + "%", percent + 1);
+    
+    quantiseSelector.setSelectedId(midiHandler->getQuantiseStrength() + 1, juce::dontSendNotification);
+    quantiseSelector.onChange = [this] {
+        audioProcessor.getMidiHandler()->setQuantiseStrength(quantiseSelector.getSelectedId() - 1);
+    };
+}
+
+void SparkLEPluginAudioProcessorEditor::updateControlsFromState()
+{
+    // El tempo y los clicks se sincronizan solos a través de sus attachments
+    auto* midiHandler = audioProcessor.getMidiHandler();
+    
+    if (patternSelector.getSelectedId() != midiHandler->getSelectedPattern() + 1)
+    {
+        patternSelector.setSelectedId(midiHandler->getSelectedPattern() + 1, juce::dontSendNotification);
+        
+        if (sequencerComponent != nullptr)
+            sequencerComponent->repaint();
+    }
+    
+    updateClickButton();
+    
+    // El transporte es el que publica el motor: también lo mueven el controlador y el host
+    EngineSnapshot snapshot;
+    
+    if (midiHandler->getEngineSnapshot(snapshot))
+        enginePlaying = snapshot.isPlaying;
+    
+    if (playButton.getButtonText() != (enginePlaying ? "Stop" : "Play"))
+    {
+        playButton.setButtonText(enginePlaying ? "Stop" : "Play");
+        playButton.setColour(juce::TextButton::buttonColourId, enginePlaying ? juce::Colours::red : juce::Colours::green);
+    }
+    
+    // La grabación también se activa desde el controlador
+    if (recordButton.getToggleState() != midiHandler->isRecording())
+        recordButton.setToggleState(midiHandler->isRecording(), juce::dontSendNotification);
+    
+    const juce::String learnText = midiHandler->isMidiLearnActive() ? "Esperando..." : "MIDI Learn";
+    
+    if (midiLearnButton.getButtonText() != learnText)
+        midiLearnButton.setButtonText(learnText);
+}
+
+void SparkLEPluginAudioProcessorEditor::updateClickButton()
+{
+    // El color ya cambia con el estado del botón; solo falta el texto
+    const juce::String text = clickButton.getToggleState() ? "Click ON" : "Click OFF";
+    
+    if (clickButton.getButtonText() != text)
+        clickButton.setButtonText(text);
 }
 
 void SparkLEPluginAudioProcessorEditor::setupTempoControl()
 {
     // Versión simplificada sin implementación
-    juce::Logger::writeToLog("SparkLEPlugin: setupTempoControl - no implementado en versión simple");
+    SPARKLE_LOG_DEBUG("SparkLEPlugin: setupTempoControl - no implementado en versión simple");
 }
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include <juce_gui_basics/juce_gui_basics.h>
 #include <juce_audio_processors/juce_audio_processors.h>
 #include "SequencerComponent.h"
+#include "DiagnosticsComponent.h"
+#include "MidiInputMap.h"
 
 // Forward declarations
 class SparkLEPluginAudioProcessor;
@@ -21,6 +23,9 @@ public:
     
     // Timer callback para actualizar la UI periódicamente
     void timerCallback() override;
+    
+    // Ctrl/Cmd + Mayús + D muestra u oculta el panel de diagnóstico
+    bool keyPressed(const juce::KeyPress& key) override;
 
 private:
     // Referencia al procesador de audio
@@ -28,16 +33,40 @@ private:
 
     // Componentes de la UI
     juce::TextButton loadSampleButton { "Load Sample" };
+    juce::TextButton loadKitButton { "Load Kit" };
     juce::TextButton playButton { "Play" };
     juce::TextButton clickButton { "Click ON" };
+    juce::ToggleButton midiClickToggle { "Click MIDI" };
     juce::Slider tempoSlider;
     juce::Label tempoLabel { {}, "Tempo:" };
+    juce::ComboBox patternSelector;
+    juce::ComboBox samplePadSelector;
+    juce::ComboBox learnTargetSelector;
+    juce::TextButton midiLearnButton { "MIDI Learn" };
+    juce::TextButton recordButton { "Rec" };
+    juce::ComboBox recordModeSelector;
+    juce::ComboBox quantiseSelector;
+    juce::Array<MidiInputMap::Binding> learnTargets;   // Una por elemento del selector, en orden
+    std::unique_ptr<juce::FileChooser> sampleChooser;
     std::unique_ptr<SequencerComponent> sequencerComponent;
+    std::unique_ptr<DiagnosticsComponent> diagnostics;
+    bool enginePlaying = false;     // Transporte del último snapshot del motor
+    
+    // Enlaces con los parámetros automatizables (después de los controles, que se destruyen antes)
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> tempoAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> clickAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> midiClickAttachment;
     
     // Métodos para responder a los botones
     void loadSampleButtonClicked();
+    void loadKitButtonClicked();
+    void updateClickButton();
     void setupPatternSelector();
+    void setupSamplePadSelector();
+    void setupMidiLearn();
+    void setupRecording();
     void setupTempoControl();
+    void updateControlsFromState();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SparkLEPluginAudioProcessorEditor)
 };
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "PluginParameters.h"
+
+//==============================================================================
+juce::AudioProcessorValueTreeState::ParameterLayout PluginParameters::createLayout()
+{
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { tempoId, 1 }, "Tempo",
+                                                           juce::NormalisableRange<float>(minTempo, maxTempo, 0.01f), 120.0f));
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID { clickId, 1 }, "Click", true));
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID { midiClickId, 1 }, "Click MIDI", false));
+    layout.add(std::make_unique<juce::AudioParameterInt>(juce::ParameterID { swingId, 1 }, "Swing",
+                                                         Pattern::minSwing, Pattern::maxSwing, Pattern::minSwing));
+
+    for (int track = 0; track < Pattern::maxTracks; ++track)
+    {
+        const auto name = "Pista " + juce::String(track + 1);
+
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { getTrackLevelId(track), 1 }, name + " Nivel",
+                                                               juce::NormalisableRange<float>(0.0f, 1.0f), 1.0f));
+        layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID { getTrackMuteId(track), 1 }, name + " Mute", false));
+    }
+
+    return layout;
+}
+
+//==============================================================================
+PluginParameters::PluginParameters(juce::AudioProcessorValueTreeState& s)
+    : state(s)
+{
+    // Las búsquedas por nombre se hacen aquí, una vez
+    tempo = state.getRawParameterValue(tempoId);
+    click = state.getRawParameterValue(clickId);
+    midiClick = state.getRawParameterValue(midiClickId);
+    swing = state.getRawParameterValue(swingId);
+
+    for (int track = 0; track < Pattern::maxTracks; ++track)
+    {
+        trackLevels[(size_t) track] = state.getRawParameterValue(getTrackLevelId(track));
+        trackMutes[(size_t) track] = state.getRawParameterValue(getTrackMuteId(track));
+    }
+
+    jassert(tempo != nullptr && click != nullptr && midiClick != nullptr && swing != nullptr);
+}
+
+//==============================================================================
+void PluginParameters::writeTo(StateSerializer::State& sessionState) const
+{
+    sessionState.bpm = getTempo();
+    sessionState.swing = getSwing();
+    sessionState.clickEnabled = isClickEnabled();
+    sessionState.midiClickEnabled = isMidiClickEnabled();
+}
+
+void PluginParameters::restoreFrom(const StateSerializer::State& sessionState)
+{
+    setParameter(tempoId, (float) sessionState.bpm);
+    setParameter(swingId, (float) sessionState.swing);
+    setParameter(clickId, sessionState.clickEnabled ? 1.0f : 0.0f);
+    setParameter(midiClickId, sessionState.midiClickEnabled ? 1.0f : 0.0f);
+}
+
+void PluginParameters::toggleTrackMute(int track)
+{
+    if (juce::isPositiveAndBelow(track, Pattern::maxTracks))
+        setParameter(getTrackMuteId(track), isTrackMuted(track) ? 0.0f : 1.0f);
+}
+
+void PluginParameters::nudgeTempo(double deltaBpm)
+{
+    setParameter(tempoId, juce::jlimit(minTempo, maxTempo, (float) (getTempo() + deltaBpm)));
+}
+
+void PluginParameters::setParameter(const juce::String& parameterId, float value)
+{
+    if (auto* parameter = state.getParameter(parameterId))
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+}
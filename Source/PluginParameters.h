@@ -0,0 +1,66 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <array>
+#include "Pattern.h"
+#include "StateSerializer.h"
+
+//==============================================================================
+/**
+ * Parámetros automatizables del plugin: tempo, click, click MIDI, swing y nivel y
+ * mute de cada pista.
+ *
+ * Los punteros a los valores se resuelven una sola vez al construir, así que el hilo
+ * de audio los lee con una carga atómica relajada, sin buscar por nombre ni recibir
+ * callbacks de listeners.
+ */
+class PluginParameters
+{
+public:
+    // Identificadores: no cambian nunca, el host los guarda en las automatizaciones
+    static constexpr const char* tempoId = "tempo";
+    static constexpr const char* clickId = "click";
+    static constexpr const char* midiClickId = "midiClick";
+    static constexpr const char* swingId = "swing";
+
+    static constexpr float minTempo = 20.0f;
+    static constexpr float maxTempo = 300.0f;
+
+    static juce::String getTrackLevelId(int track)  { return "track" + juce::String(track + 1) + "Level"; }
+    static juce::String getTrackMuteId(int track)   { return "track" + juce::String(track + 1) + "Mute"; }
+
+    static juce::AudioProcessorValueTreeState::ParameterLayout createLayout();
+
+    explicit PluginParameters(juce::AudioProcessorValueTreeState& state);
+
+    // Hilo de audio (o cualquier otro): lectura directa del valor en bruto
+    double getTempo() const             { return tempo->load(std::memory_order_relaxed); }
+    bool isClickEnabled() const         { return click->load(std::memory_order_relaxed) >= 0.5f; }
+    bool isMidiClickEnabled() const     { return midiClick->load(std::memory_order_relaxed) >= 0.5f; }
+    int getSwing() const                { return juce::roundToInt(swing->load(std::memory_order_relaxed)); }
+    float getTrackLevel(int track) const { return trackLevels[(size_t) track]->load(std::memory_order_relaxed); }
+    bool isTrackMuted(int track) const  { return trackMutes[(size_t) track]->load(std::memory_order_relaxed) >= 0.5f; }
+
+    // Hilo de mensajes: el estado guardado lleva el tempo, el swing y el click en su
+    // sección de transporte, que manda sobre lo que traigan los parámetros
+    void writeTo(StateSerializer::State& state) const;
+    void restoreFrom(const StateSerializer::State& state);
+
+    // Hilo de mensajes: acciones de los controles del Spark LE, con aviso al host
+    void toggleTrackMute(int track);
+    void nudgeTempo(double deltaBpm);
+
+private:
+    juce::AudioProcessorValueTreeState& state;
+
+    std::atomic<float>* tempo = nullptr;
+    std::atomic<float>* click = nullptr;
+    std::atomic<float>* midiClick = nullptr;
+    std::atomic<float>* swing = nullptr;
+    std::array<std::atomic<float>*, Pattern::maxTracks> trackLevels {};
+    std::array<std::atomic<float>*, Pattern::maxTracks> trackMutes {};
+
+    void setParameter(const juce::String& parameterId, float value);
+
+    JUCE_DECLARE_NON_COPYABLE(PluginParameters)
+};
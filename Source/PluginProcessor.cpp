@@ -1,28 +1,28 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 #include "MidiHandler.h"
+#include "RealtimeSafetyChecker.h"
 
 //==============================================================================
 SparkLEPluginAudioProcessor::SparkLEPluginAudioProcessor()
     : AudioProcessor(BusesProperties()
                      .withOutput("Output", juce::AudioChannelSet::stereo(), true)),
-      parameters(*this, nullptr, "Parameters", {})
+      parameters(*this, nullptr, "Parameters", PluginParameters::createLayout())
 {
-    // Inicialización del plugin
-    juce::Logger::writeToLog("SparkLEPlugin: Inicializando el procesador de audio");
-    
-    // Intenta abrir un archivo de registro para DEBUG
-    juce::File logFile = juce::File::getSpecialLocation(juce::File::userDesktopDirectory).getChildFile("sparkle_plugin_log.txt");
-    juce::FileLogger* fileLogger = new juce::FileLogger(logFile, "SparkLE Plugin Log");
-    juce::Logger::setCurrentLogger(fileLogger);
-    
-    juce::Logger::writeToLog("SparkLEPlugin: Procesador creado correctamente");
+    // El registro (AsyncLogger) ya existe: es el primer miembro
+    midiHandler.setParameters(&pluginParameters);
+    SPARKLE_LOG_INFO("SparkLEPlugin: Procesador creado correctamente");
 }
 
 SparkLEPluginAudioProcessor::~SparkLEPluginAudioProcessor()
 {
-    juce::Logger::writeToLog("SparkLEPlugin: Destruyendo el procesador de audio");
-    juce::Logger::setCurrentLogger(nullptr);
+    SPARKLE_LOG_INFO("SparkLEPlugin: Destruyendo el procesador de audio");
+    midiHandler.setParameters(nullptr);
+
+   #if SPARKLE_RT_CHECKS && ! SPARKLE_HEADLESS
+    // Las herramientas sin interfaz imprimen su propio resumen al terminar
+    RealtimeSafetyChecker::printSummary();
+   #endif
 }
 
 //==============================================================================
@@ -101,7 +101,13 @@ bool SparkLEPluginAudioProcessor::isBusesLayoutSupported(const BusesLayout& layo
 
 void SparkLEPluginAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    SPARKLE_AUDIO_THREAD_SCOPE
     juce::ScopedNoDenormals noDenormals;
+    
+    // Coste del bloque completo, para el panel de diagnóstico
+    auto& telemetry = midiHandler.getTelemetry();
+    telemetry.beginBlock();
+    
     auto totalNumInputChannels = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -109,28 +115,16 @@ void SparkLEPluginAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer,
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear(i, 0, buffer.getNumSamples());
 
+    // Aplica primero los cambios del editor para que todo el bloque vea un estado coherente
+    midiHandler.processPendingCommands();
+    
     // Procesa el MIDI
-    midiHandler.processMidi(midiMessages);
+    midiHandler.processMidi(midiMessages, buffer.getNumSamples(), getPlayHead());
     
-    // Añade un pequeño sonido para verificar que el secuenciador está funcionando
-    // Solo si el click está habilitado
-    if (midiHandler.isSequencerPlaying() && midiHandler.clickEnabled)
-    {
-        int currentStep = midiHandler.getCurrentStep();
-        if (currentStep % 4 == 0)  // En cada beat principal
-        {
-            // Generar un pequeño click para indicar el tempo (solo durante desarrollo)
-            float clickVolume = 0.1f; // Volumen bajo
-            for (int i = 0; i < std::min(100, buffer.getNumSamples()); i++) {
-                float sample = clickVolume * std::sin(i * 0.1f);
-                if (i > 50) sample *= (1.0f - ((i - 50) / 50.0f)); // fade out
-                
-                for (int channel = 0; channel < totalNumOutputChannels; ++channel) {
-                    buffer.addSample(channel, i, sample);
-                }
-            }
-        }
-    }
+    // Samples de los pads y metrónomo disparados en este bloque, cada uno en su sample
+    midiHandler.renderSamples(buffer);
+    
+    telemetry.endBlock(buffer.getNumSamples(), getSampleRate());
 }
 
 //==============================================================================
@@ -147,15 +141,45 @@ juce::AudioProcessorEditor* SparkLEPluginAudioProcessor::createEditor()
 //==============================================================================
 void SparkLEPluginAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
 {
-    // Guarda el estado del plugin para recuperarlo después
-    auto state = parameters.copyState();
-    std::unique_ptr<juce::XmlElement> xml(state.createXml());
-    copyXmlToBinary(*xml, destData);
+    // Patrones, tempo, click y samples en binario compacto. Los hosts lo piden a menudo
+    // (p. ej. para deshacer), así que no pasa por XML
+    StateSerializer::State state;
+    midiHandler.getSessionState(state);
+    pluginParameters.writeTo(state);
+    
+    {
+        juce::MemoryOutputStream parameterStream(state.parameters, false);
+        parameters.copyState().writeToStream(parameterStream);
+    }
+    
+    StateSerializer::write(state, destData);
 }
 
 void SparkLEPluginAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
 {
-    // Restaura el estado previo
+    if (StateSerializer::hasValidHeader(data, (size_t) sizeInBytes))
+    {
+        StateSerializer::State state;
+        
+        if (!StateSerializer::read(data, (size_t) sizeInBytes, state))
+        {
+            SPARKLE_LOG_ERROR("SparkLEPlugin: Estado guardado dañado o de una versión posterior, se ignora");
+            return;
+        }
+        
+        midiHandler.restoreSessionState(state);
+        
+        const auto parameterState = juce::ValueTree::readFromData(state.parameters.getData(), state.parameters.getSize());
+        
+        if (parameterState.hasType(parameters.state.getType()))
+            parameters.replaceState(parameterState);
+        
+        // El tempo y el click de la sección de transporte mandan sobre los parámetros
+        pluginParameters.restoreFrom(state);
+        return;
+    }
+    
+    // Proyectos guardados antes del formato binario: solo los parámetros, en XML
     std::unique_ptr<juce::XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
     
     if (xmlState.get() != nullptr)
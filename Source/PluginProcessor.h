@@ -3,6 +3,8 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_gui_extra/juce_gui_extra.h>
 #include "MidiHandler.h"
+#include "AsyncLogger.h"
+#include "PluginParameters.h"
 
 class SparkLEPluginAudioProcessorEditor;
 
@@ -47,13 +49,20 @@ public:
 
     // Acceso al MidiHandler
     MidiHandler* getMidiHandler() { return &midiHandler; }
+    
+    // Parámetros automatizables, para enlazar los controles del editor
+    juce::AudioProcessorValueTreeState& getParameters() { return parameters; }
 
 private:
+    // Registro compartido por todas las instancias. Va primero para que se destruya el último
+    juce::SharedResourcePointer<AsyncLogger> logger;
+    
     // Secuenciador interno y Midi
     MidiHandler midiHandler;
     
-    // Parámetros del plugin
+    // Parámetros del plugin y su lectura desde el hilo de audio
     juce::AudioProcessorValueTreeState parameters;
+    PluginParameters pluginParameters { parameters };
     
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SparkLEPluginAudioProcessor)
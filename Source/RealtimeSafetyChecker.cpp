@@ -0,0 +1,187 @@
+#include "RealtimeSafetyChecker.h"
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if SPARKLE_RT_CHECKS && ! JUCE_WINDOWS
+ #include <dlfcn.h>
+ #include <pthread.h>
+#endif
+
+namespace
+{
+    // Estado por hilo: tipos triviales, sin inicialización dinámica (se usan desde operator new)
+    thread_local int audioScopeDepth = 0;
+    thread_local bool isReporting = false;
+    thread_local juce::int64 threadAllocations = 0;
+
+    constexpr int numKinds = (int) RealtimeSafetyChecker::Violation::numKinds;
+    std::array<std::atomic<juce::int64>, numKinds> violationCounts {};
+
+    // Solo se imprime la pila de las primeras violaciones; el resto solo se cuenta
+    constexpr juce::int64 maxReportedTraces = 32;
+    std::atomic<juce::int64> numReportedTraces { 0 };
+
+    const char* getKindName(RealtimeSafetyChecker::Violation kind)
+    {
+        switch (kind)
+        {
+            case RealtimeSafetyChecker::Violation::allocation:       return "reserva de memoria";
+            case RealtimeSafetyChecker::Violation::deallocation:     return "liberación de memoria";
+            case RealtimeSafetyChecker::Violation::lock:             return "bloqueo de mutex";
+            case RealtimeSafetyChecker::Violation::logger:           return "escritura en el Logger";
+            case RealtimeSafetyChecker::Violation::nonRealtimeCall:  return "llamada no apta para tiempo real";
+            case RealtimeSafetyChecker::Violation::numKinds:         break;
+        }
+
+        return "";
+    }
+}
+
+//==============================================================================
+RealtimeSafetyChecker::ScopedAudioThread::ScopedAudioThread()
+{
+    ++audioScopeDepth;
+}
+
+RealtimeSafetyChecker::ScopedAudioThread::~ScopedAudioThread()
+{
+    --audioScopeDepth;
+}
+
+bool RealtimeSafetyChecker::isInAudioThreadScope()
+{
+    return audioScopeDepth > 0 && !isReporting;
+}
+
+void RealtimeSafetyChecker::reportViolation(Violation kind, const char* description)
+{
+    // Informar también reserva memoria: mientras tanto no se vigila este hilo
+    if (isReporting)
+        return;
+
+    isReporting = true;
+    violationCounts[(size_t) kind].fetch_add(1, std::memory_order_relaxed);
+
+    if (numReportedTraces.fetch_add(1, std::memory_order_relaxed) < maxReportedTraces)
+    {
+        const auto trace = juce::SystemStats::getStackBacktrace();
+        std::fprintf(stderr, "[RT] Violación en el hilo de audio (%s): %s\n%s\n",
+                     getKindName(kind), description, trace.toRawUTF8());
+    }
+
+    isReporting = false;
+}
+
+void RealtimeSafetyChecker::noteAllocation()
+{
+    ++threadAllocations;
+
+    if (isInAudioThreadScope())
+        reportViolation(Violation::allocation, "operator new");
+}
+
+void RealtimeSafetyChecker::noteDeallocation()
+{
+    if (isInAudioThreadScope())
+        reportViolation(Violation::deallocation, "operator delete");
+}
+
+void RealtimeSafetyChecker::noteLock(const char* description)
+{
+    if (isInAudioThreadScope())
+        reportViolation(Violation::lock, description);
+}
+
+juce::int64 RealtimeSafetyChecker::getAllocationsOnThisThread()
+{
+    return threadAllocations;
+}
+
+juce::int64 RealtimeSafetyChecker::getNumViolations(Violation kind)
+{
+    return violationCounts[(size_t) kind].load(std::memory_order_relaxed);
+}
+
+juce::int64 RealtimeSafetyChecker::getTotalViolations()
+{
+    juce::int64 total = 0;
+
+    for (auto& count : violationCounts)
+        total += count.load(std::memory_order_relaxed);
+
+    return total;
+}
+
+juce::String RealtimeSafetyChecker::getSummary()
+{
+    juce::String summary;
+    summary << "Comprobación de tiempo real: " << getTotalViolations() << " violaciones";
+
+    for (int kind = 0; kind < numKinds; ++kind)
+        summary << "\n  " << getKindName((Violation) kind) << ": " << getNumViolations((Violation) kind);
+
+    return summary;
+}
+
+void RealtimeSafetyChecker::printSummary()
+{
+    std::fprintf(stderr, "%s\n", getSummary().toRawUTF8());
+}
+
+//==============================================================================
+// Interceptores. Solo existen con las comprobaciones activas
+#if SPARKLE_RT_CHECKS
+
+namespace
+{
+    void* checkedAllocation(std::size_t size)
+    {
+        RealtimeSafetyChecker::noteAllocation();
+
+        if (auto* ptr = std::malloc(size == 0 ? 1 : size))
+            return ptr;
+
+        throw std::bad_alloc();
+    }
+
+    void checkedDeallocation(void* ptr) noexcept
+    {
+        if (ptr != nullptr)
+            RealtimeSafetyChecker::noteDeallocation();
+
+        std::free(ptr);
+    }
+}
+
+void* operator new (std::size_t size)                       { return checkedAllocation(size); }
+void* operator new[] (std::size_t size)                     { return checkedAllocation(size); }
+void operator delete (void* ptr) noexcept                   { checkedDeallocation(ptr); }
+void operator delete[] (void* ptr) noexcept                 { checkedDeallocation(ptr); }
+void operator delete (void* ptr, std::size_t) noexcept      { checkedDeallocation(ptr); }
+void operator delete[] (void* ptr, std::size_t) noexcept    { checkedDeallocation(ptr); }
+
+#if ! JUCE_WINDOWS
+// CriticalSection, std::mutex y casi cualquier bloqueo acaban aquí en POSIX
+extern "C" int pthread_mutex_lock(pthread_mutex_t* mutex)
+{
+    using LockFunction = int (*)(pthread_mutex_t*);
+
+    // Sin estáticas con guarda: la propia guarda usaría un mutex
+    static std::atomic<LockFunction> realLock { nullptr };
+    auto lock = realLock.load(std::memory_order_relaxed);
+
+    if (lock == nullptr)
+    {
+        lock = reinterpret_cast<LockFunction>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+        realLock.store(lock, std::memory_order_relaxed);
+    }
+
+    RealtimeSafetyChecker::noteLock("pthread_mutex_lock");
+    return lock(mutex);
+}
+#endif
+
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+// Comprobaciones de tiempo real (modo depuración/CI, ver SPARKLE_ENABLE_RT_CHECKS)
+#ifndef SPARKLE_RT_CHECKS
+ #define SPARKLE_RT_CHECKS 0
+#endif
+
+//==============================================================================
+/**
+ * Vigila que el hilo de audio no haga nada que pueda bloquearlo.
+ *
+ * processBlock marca su ámbito con SPARKLE_AUDIO_THREAD_SCOPE. Con las
+ * comprobaciones activas se interceptan operator new/delete, los bloqueos de mutex
+ * (pthread, en Linux y macOS), las escrituras en el registro (AsyncLogger, también
+ * las que llegan por juce::Logger) y las funciones marcadas con
+ * SPARKLE_NON_REALTIME_CALL; cada una que ocurra dentro del ámbito se cuenta y se
+ * informa por stderr con su pila de llamadas. Al final se puede pedir un resumen.
+ *
+ * La intercepción de new/delete y de los mutex solo funciona en ejecutables
+ * (Standalone, SparkLEBenchmark): en un plugin cargado por el host esas llamadas
+ * se resuelven antes en las bibliotecas del sistema.
+ */
+class RealtimeSafetyChecker
+{
+public:
+    enum class Violation
+    {
+        allocation, deallocation, lock, logger, nonRealtimeCall,
+        numKinds
+    };
+
+    // Marca el hilo actual como hilo de audio mientras existe
+    class ScopedAudioThread
+    {
+    public:
+        ScopedAudioThread();
+        ~ScopedAudioThread();
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedAudioThread)
+    };
+
+    static bool isInAudioThreadScope();
+    static void reportViolation(Violation kind, const char* description);
+
+    // Llamadas desde los interceptores
+    static void noteAllocation();
+    static void noteDeallocation();
+    static void noteLock(const char* description);
+
+    // Reservas de memoria hechas por el hilo actual desde que arrancó (en cualquier ámbito)
+    static juce::int64 getAllocationsOnThisThread();
+
+    static juce::int64 getNumViolations(Violation kind);
+    static juce::int64 getTotalViolations();
+    static juce::String getSummary();
+    static void printSummary();
+
+private:
+    RealtimeSafetyChecker() = delete;
+};
+
+#if SPARKLE_RT_CHECKS
+ #define SPARKLE_AUDIO_THREAD_SCOPE \
+    const RealtimeSafetyChecker::ScopedAudioThread sparkleAudioThreadScope;
+
+ #define SPARKLE_NON_REALTIME_CALL(description) \
+    do { if (RealtimeSafetyChecker::isInAudioThreadScope()) \
+             RealtimeSafetyChecker::reportViolation(RealtimeSafetyChecker::Violation::nonRealtimeCall, description); } while (false)
+#else
+ #define SPARKLE_AUDIO_THREAD_SCOPE
+ #define SPARKLE_NON_REALTIME_CALL(description)  do {} while (false)
+#endif
@@ -0,0 +1,196 @@
+#include "SampleLoader.h"
+#include "SampleStreamer.h"
+#include "RealtimeSafetyChecker.h"
+#include <algorithm>
+
+//==============================================================================
+SampleLoader::SampleLoader(Listener& listenerToUse)
+    : juce::Thread("SparkLE Sample Loader"),
+      listener(listenerToUse)
+{
+    formatManager.registerBasicFormats();
+    startThread(juce::Thread::Priority::low);
+}
+
+SampleLoader::~SampleLoader()
+{
+    cancelPendingUpdate();
+    stopThread(4000);
+}
+
+void SampleLoader::load(int pad, const juce::File& file, double targetSampleRate)
+{
+    SPARKLE_NON_REALTIME_CALL("SampleLoader::load");
+
+    {
+        const juce::ScopedLock scopedLock(lock);
+
+        // Un pad solo necesita su última petición
+        jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [pad](const Job& job) { return job.pad == pad; }),
+                   jobs.end());
+        jobs.push_back({ pad, file, {}, targetSampleRate });
+    }
+
+    notify();
+}
+
+void SampleLoader::loadKit(const juce::Array<juce::File>& files, double targetSampleRate)
+{
+    SPARKLE_NON_REALTIME_CALL("SampleLoader::loadKit");
+
+    {
+        const juce::ScopedLock scopedLock(lock);
+
+        jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [](const Job& job) { return job.pad == kitPad; }),
+                   jobs.end());
+        jobs.push_back({ kitPad, {}, files, targetSampleRate });
+    }
+
+    notify();
+}
+
+//==============================================================================
+std::unique_ptr<juce::AudioFormatReader> SampleLoader::createReader(juce::AudioFormatManager& formatManager,
+                                                                   const juce::File& file)
+{
+    // WAV y AIFF se leen mapeados: sin copias ni llamadas al sistema por lectura,
+    // y la caché del sistema se comparte entre instancias del plugin
+    if (auto* format = formatManager.findFormatForFileExtension(file.getFileExtension()))
+    {
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped(format->createMemoryMappedReader(file));
+
+        if (mapped != nullptr && mapped->mapEntireFile())
+            return mapped;
+    }
+
+    return std::unique_ptr<juce::AudioFormatReader>(formatManager.createReaderFor(file));
+}
+
+std::unique_ptr<LoadedSample> SampleLoader::decode(juce::AudioFormatManager& formatManager,
+                                                   const juce::File& file,
+                                                   double targetSampleRate)
+{
+    auto reader = createReader(formatManager, file);
+
+    if (reader == nullptr || reader->sampleRate <= 0.0 || targetSampleRate <= 0.0 || reader->lengthInSamples <= 0)
+        return nullptr;
+
+    const auto numChannels = (int) juce::jlimit(1u, 2u, reader->numChannels);
+    const auto ratio = reader->sampleRate / targetSampleRate;
+    const auto isStreamed = reader->lengthInSamples > (juce::int64) (streamingThresholdSeconds * reader->sampleRate)
+                            && ratio <= SampleStreamer::maxSourceRatio;
+
+    // Entero o solo la cabeza, más unos samples para el interpolador
+    const auto numSourceSamples = (int) juce::jmin(reader->lengthInSamples,
+                                                   isStreamed ? (juce::int64) std::ceil(headSeconds * reader->sampleRate) + 4
+                                                              : (juce::int64) (maxSampleSeconds * reader->sampleRate));
+
+    juce::AudioBuffer<float> source(numChannels, numSourceSamples);
+    reader->read(&source, 0, numSourceSamples, 0, true, numChannels > 1);
+
+    auto sample = std::make_unique<LoadedSample>();
+    sample->sampleRate = targetSampleRate;
+    sample->name = file.getFileNameWithoutExtension();
+    sample->sourceRatio = ratio;
+
+    if (ratio == 1.0)
+    {
+        sample->audio = std::move(source);
+        sample->headSourceSamples = numSourceSamples;
+    }
+    else
+    {
+        // Se convierte aquí para que el hilo de audio solo tenga que sumar
+        const auto numSamples = isStreamed ? (int) (headSeconds * targetSampleRate)
+                                           : (int) std::ceil(numSourceSamples / ratio);
+        sample->audio.setSize(numChannels, numSamples);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            juce::LagrangeInterpolator interpolator;
+            sample->headSourceSamples = interpolator.process(ratio, source.getReadPointer(channel),
+                                                             sample->audio.getWritePointer(channel),
+                                                             numSamples, numSourceSamples, 0);
+        }
+    }
+
+    if (isStreamed)
+    {
+        sample->lengthInSamples = (juce::int64) (reader->lengthInSamples / ratio);
+        sample->streamReader = std::move(reader);
+    }
+    else
+    {
+        sample->lengthInSamples = sample->audio.getNumSamples();
+    }
+
+    return sample;
+}
+
+void SampleLoader::run()
+{
+    while (!threadShouldExit())
+    {
+        Job job;
+        bool hasJob = false;
+
+        {
+            const juce::ScopedLock scopedLock(lock);
+
+            if (!jobs.empty())
+            {
+                job = jobs.front();
+                jobs.erase(jobs.begin());
+                hasJob = true;
+            }
+        }
+
+        if (!hasJob)
+        {
+            wait(-1);
+            continue;
+        }
+
+        Result result { job.pad, job.file, nullptr, job.kitFiles, {} };
+
+        if (job.pad == kitPad)
+        {
+            for (const auto& file : job.kitFiles)
+            {
+                if (threadShouldExit())
+                    return;
+
+                result.kitSamples.push_back(decode(formatManager, file, job.targetSampleRate));
+            }
+        }
+        else
+        {
+            result.sample = decode(formatManager, job.file, job.targetSampleRate);
+        }
+
+        {
+            const juce::ScopedLock scopedLock(lock);
+            results.push_back(std::move(result));
+        }
+
+        triggerAsyncUpdate();
+    }
+}
+
+void SampleLoader::handleAsyncUpdate()
+{
+    std::vector<Result> finished;
+
+    {
+        const juce::ScopedLock scopedLock(lock);
+        finished.swap(results);
+    }
+
+    for (auto& result : finished)
+    {
+        if (result.pad == kitPad)
+            listener.kitLoaded(result.kitFiles, std::move(result.kitSamples));
+        else
+            listener.sampleLoaded(result.pad, result.file, std::move(result.sample));
+    }
+}
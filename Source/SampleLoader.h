@@ -0,0 +1,94 @@
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_events/juce_events.h>
+#include "SamplePlayer.h"
+
+//==============================================================================
+/**
+ * Decodifica samples en un hilo propio.
+ *
+ * Lee el fichero, lo convierte al sample rate pedido y deja el resultado en un
+ * LoadedSample del tamaño justo; el Listener lo recibe después en el hilo de
+ * mensajes. Ni el disco ni el decodificador se tocan nunca desde el hilo de audio.
+ *
+ * Los ficheros largos no se cargan enteros: solo la cabeza, y el sample se queda
+ * con un lector (mapeado en memoria si el formato lo permite) para que
+ * SampleStreamer sirva el resto. Así un kit de varios GB cabe en cada instancia
+ * del plugin y, como basta con las cabezas, se carga y se cambia enseguida.
+ */
+class SampleLoader : private juce::Thread,
+                     private juce::AsyncUpdater
+{
+public:
+    // Tope para los que se cargan enteros (cuando no se pueden leer del disco)
+    static constexpr double maxSampleSeconds = 30.0;
+
+    // A partir de esta duración el sample se lee del disco y solo se carga la cabeza
+    static constexpr double streamingThresholdSeconds = 4.0;
+    static constexpr double headSeconds = 0.5;
+
+    class Listener
+    {
+    public:
+        virtual ~Listener() = default;
+
+        // Hilo de mensajes. sample es nullptr si no se pudo leer el fichero
+        virtual void sampleLoaded(int pad, const juce::File& file, std::unique_ptr<LoadedSample> sample) = 0;
+
+        // Hilo de mensajes. Un sample por fichero del kit, nullptr en los que fallaron
+        virtual void kitLoaded(const juce::Array<juce::File>& files,
+                               std::vector<std::unique_ptr<LoadedSample>> samples) = 0;
+    };
+
+    explicit SampleLoader(Listener& listenerToUse);
+    ~SampleLoader() override;
+
+    // Pide cargar un fichero en un pad (hilo de mensajes)
+    void load(int pad, const juce::File& file, double targetSampleRate);
+
+    // Pide cargar un kit entero, un fichero por pad; se entrega de una vez cuando
+    // están todos. Sustituye al kit que estuviera pendiente
+    void loadKit(const juce::Array<juce::File>& files, double targetSampleRate);
+
+    // Decodificación síncrona, para herramientas sin bucle de mensajes
+    static std::unique_ptr<LoadedSample> decode(juce::AudioFormatManager& formatManager,
+                                                const juce::File& file,
+                                                double targetSampleRate);
+
+private:
+    static constexpr int kitPad = -1;
+
+    struct Job
+    {
+        int pad = 0;                        // kitPad para un kit
+        juce::File file;
+        juce::Array<juce::File> kitFiles;
+        double targetSampleRate = 0.0;
+    };
+
+    struct Result
+    {
+        int pad = 0;
+        juce::File file;
+        std::unique_ptr<LoadedSample> sample;
+        juce::Array<juce::File> kitFiles;
+        std::vector<std::unique_ptr<LoadedSample>> kitSamples;
+    };
+
+    Listener& listener;
+    juce::AudioFormatManager formatManager;
+
+    // Solo los comparten este hilo y el de mensajes, nunca el de audio
+    juce::CriticalSection lock;
+    std::vector<Job> jobs;
+    std::vector<Result> results;
+
+    static std::unique_ptr<juce::AudioFormatReader> createReader(juce::AudioFormatManager& formatManager,
+                                                                 const juce::File& file);
+
+    void run() override;
+    void handleAsyncUpdate() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleLoader)
+};
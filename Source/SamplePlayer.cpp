@@ -0,0 +1,198 @@
+#include "SamplePlayer.h"
+#include "SampleStreamer.h"
+
+//==============================================================================
+void SamplePlayer::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    stopAllVoices();
+}
+
+const LoadedSample* SamplePlayer::setSample(int pad, const LoadedSample* sample)
+{
+    if (!juce::isPositiveAndBelow(pad, numPads))
+        return sample;
+
+    auto* previous = samples[(size_t) pad];
+    samples[(size_t) pad] = sample;
+
+    // Ninguna voz puede seguir leyendo el sample que se va a liberar
+    if (previous != nullptr)
+        for (auto& voice : voices)
+            if (voice.sample == previous)
+                stopVoice(voice);
+
+    return previous;
+}
+
+const LoadedSample* SamplePlayer::getSample(int pad) const
+{
+    return juce::isPositiveAndBelow(pad, numPads) ? samples[(size_t) pad] : nullptr;
+}
+
+void SamplePlayer::queueTrigger(int pad, int sampleOffset, float gain)
+{
+    // Un pad sin sample no ocupa sitio. Un bloque enorme lleno de pasos podría
+    // superar la lista: entonces se pierde el disparo
+    if (numTriggers < maxTriggersPerBlock && getSample(pad) != nullptr)
+        triggers[(size_t) numTriggers++] = { pad, sampleOffset, gain };
+}
+
+void SamplePlayer::stopAllVoices()
+{
+    for (auto& voice : voices)
+        if (voice.sample != nullptr)
+            stopVoice(voice);
+
+    numTriggers = 0;
+}
+
+int SamplePlayer::getNumActiveVoices() const
+{
+    int numActive = 0;
+
+    for (const auto& voice : voices)
+        if (voice.sample != nullptr)
+            ++numActive;
+
+    return numActive;
+}
+
+//==============================================================================
+void SamplePlayer::render(juce::AudioBuffer<float>& output, int numSamples)
+{
+    int position = 0;
+
+    for (int i = 0; i < numTriggers; ++i)
+    {
+        const auto& trigger = triggers[(size_t) i];
+        const auto offset = juce::jlimit(position, numSamples, trigger.sampleOffset);
+
+        // Todo lo anterior al disparo se mezcla antes de tocar las voces
+        renderVoices(output, position, offset);
+        position = offset;
+
+        auto* sample = samples[(size_t) trigger.pad];
+
+        // Un sample aún sin convertir al sample rate actual no suena
+        if (sample == nullptr || sample->sampleRate != sampleRate || sample->audio.getNumSamples() == 0)
+            continue;
+
+        auto& voice = allocateVoice(output, position, numSamples - position);
+        voice.sample = sample;
+        voice.position = 0;
+        voice.gain = trigger.gain;
+        voice.age = nextAge++;
+
+        // El stream se pide ya: el disco tiene toda la cabeza para ponerse al día
+        if (sample->isStreamed() && streamer != nullptr)
+            voice.stream = streamer->startStream(sample);
+    }
+
+    numTriggers = 0;
+    renderVoices(output, position, numSamples);
+}
+
+SamplePlayer::Voice& SamplePlayer::allocateVoice(juce::AudioBuffer<float>& output, int startSample, int numSamples)
+{
+    Voice* oldest = &voices[0];
+
+    for (auto& voice : voices)
+    {
+        if (voice.sample == nullptr)
+            return voice;
+
+        // Diferencia con signo: sigue funcionando cuando el contador da la vuelta
+        if ((juce::int32) (voice.age - oldest->age) < 0)
+            oldest = &voice;
+    }
+
+    // Sin voces libres: la más antigua se apaga con un fundido corto y se reutiliza
+    fadeOutVoice(*oldest, output, startSample, juce::jmin(numSamples, stealFadeSamples));
+    return *oldest;
+}
+
+void SamplePlayer::renderVoices(juce::AudioBuffer<float>& output, int startSample, int endSample)
+{
+    if (endSample <= startSample)
+        return;
+
+    for (auto& voice : voices)
+        if (voice.sample != nullptr)
+            mixVoice(voice, output, startSample, endSample - startSample);
+}
+
+void SamplePlayer::mixVoice(Voice& voice, juce::AudioBuffer<float>& output, int startSample, int numSamples)
+{
+    const auto& audio = voice.sample->audio;
+    const auto numToMix = juce::jmin(numSamples, audio.getNumSamples() - voice.position);
+
+    if (numToMix > 0)
+    {
+        // Un sample mono suena igual en los dos canales
+        for (int channel = 0; channel < output.getNumChannels(); ++channel)
+        {
+            const auto sourceChannel = juce::jmin(channel, audio.getNumChannels() - 1);
+
+            juce::FloatVectorOperations::addWithMultiply(output.getWritePointer(channel, startSample),
+                                                         audio.getReadPointer(sourceChannel, voice.position),
+                                                         voice.gain,
+                                                         numToMix);
+        }
+
+        voice.position += numToMix;
+    }
+
+    if (voice.position < audio.getNumSamples())
+        return;
+
+    // Pasada la cabeza, un sample largo sigue desde su stream. Si el disco no ha
+    // llegado a tiempo la voz se corta: es preferible a desfasarse
+    const auto numRemaining = numSamples - juce::jmax(0, numToMix);
+
+    if (voice.stream >= 0)
+    {
+        if (numRemaining == 0)
+            return;
+
+        bool isFinished = false;
+        const auto numStreamed = streamer->mixStream(voice.stream, output, startSample + numSamples - numRemaining,
+                                                     numRemaining, voice.gain, isFinished);
+        voice.position += numStreamed;
+
+        if (numStreamed == numRemaining)
+            return;
+    }
+
+    stopVoice(voice);
+}
+
+void SamplePlayer::fadeOutVoice(Voice& voice, juce::AudioBuffer<float>& output, int startSample, int numSamples)
+{
+    // El fundido sale de la cabeza; una voz ya en el stream se corta sin él
+    const auto& audio = voice.sample->audio;
+    const auto numToMix = juce::jmin(numSamples, audio.getNumSamples() - voice.position);
+
+    if (numToMix > 0)
+    {
+        for (int channel = 0; channel < output.getNumChannels(); ++channel)
+        {
+            const auto sourceChannel = juce::jmin(channel, audio.getNumChannels() - 1);
+
+            output.addFromWithRamp(channel, startSample,
+                                   audio.getReadPointer(sourceChannel, voice.position),
+                                   numToMix, voice.gain, 0.0f);
+        }
+    }
+
+    stopVoice(voice);
+}
+
+void SamplePlayer::stopVoice(Voice& voice)
+{
+    if (voice.stream >= 0 && streamer != nullptr)
+        streamer->stopStream(voice.stream);
+
+    voice.sample = nullptr;
+    voice.stream = -1;
+}
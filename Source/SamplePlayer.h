@@ -0,0 +1,103 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <array>
+#include "Pattern.h"
+
+class SampleStreamer;
+
+//==============================================================================
+// Sample ya decodificado y convertido al sample rate del dispositivo. Es inmutable:
+// se crea fuera del hilo de audio y se libera de vuelta en el hilo de mensajes.
+// Los largos solo guardan la cabeza en audio; el resto lo sirve SampleStreamer
+// leyendo de streamReader, que no toca ningún otro hilo
+struct LoadedSample
+{
+    juce::AudioBuffer<float> audio;
+    double sampleRate = 0.0;
+    juce::String name;
+
+    std::unique_ptr<juce::AudioFormatReader> streamReader;
+    juce::int64 lengthInSamples = 0;        // Longitud total al sample rate del dispositivo
+    juce::int64 headSourceSamples = 0;      // Samples del fichero que ya cubre la cabeza
+    double sourceRatio = 1.0;               // Sample rate del fichero / del dispositivo
+
+    bool isStreamed() const { return streamReader != nullptr; }
+};
+
+//==============================================================================
+/**
+ * Reproductor de samples por pad (hilo de audio).
+ *
+ * Tiene un grupo fijo de voces: disparar un pad toma una voz libre o, si no queda
+ * ninguna, roba la que lleva más tiempo sonando (con un fundido muy corto para que
+ * no haga clic). Los disparos del bloque se guardan con su sample y se resuelven en
+ * render() en orden, mezclando cada voz solo hasta el siguiente disparo; así un robo
+ * a mitad de bloque respeta el sample exacto. Como los samples ya están al sample
+ * rate del dispositivo, la mezcla es una suma escalada con FloatVectorOperations.
+ * Una voz de un sample largo toca primero la cabeza y sigue con el stream que pidió
+ * a SampleStreamer al dispararse. No reserva memoria ni bloquea.
+ */
+class SamplePlayer
+{
+public:
+    static constexpr int numPads = Pattern::maxTracks;
+    static constexpr int maxVoices = 64;
+    static constexpr int maxTriggersPerBlock = 512;
+    static constexpr int stealFadeSamples = 64;
+
+    SamplePlayer() = default;
+
+    void prepare(double newSampleRate);
+
+    // Sin streamer, los samples largos solo suenan hasta el final de la cabeza
+    void setStreamer(SampleStreamer* newStreamer) { streamer = newStreamer; }
+
+    // Coloca el sample de un pad. Devuelve el anterior, que el llamante debe
+    // liberar fuera del hilo de audio
+    const LoadedSample* setSample(int pad, const LoadedSample* sample);
+    const LoadedSample* getSample(int pad) const;
+
+    // Apunta un disparo dentro del bloque en curso (en orden de sampleOffset)
+    void queueTrigger(int pad, int sampleOffset, float gain);
+
+    // Mezcla en output las voces y los disparos apuntados, y vacía la lista
+    void render(juce::AudioBuffer<float>& output, int numSamples);
+
+    void stopAllVoices();
+    int getNumActiveVoices() const;
+
+private:
+    struct Voice
+    {
+        const LoadedSample* sample = nullptr;
+        int position = 0;
+        int stream = -1;            // Stream de SampleStreamer, solo en samples largos
+        float gain = 1.0f;
+        juce::uint32 age = 0;       // Orden de disparo, para robar la más antigua
+    };
+
+    struct Trigger
+    {
+        int pad = 0;
+        int sampleOffset = 0;
+        float gain = 1.0f;
+    };
+
+    std::array<const LoadedSample*, numPads> samples {};
+    std::array<Voice, maxVoices> voices {};
+    std::array<Trigger, maxTriggersPerBlock> triggers {};
+    int numTriggers = 0;
+    juce::uint32 nextAge = 0;
+    double sampleRate = 44100.0;
+    SampleStreamer* streamer = nullptr;
+
+    Voice& allocateVoice(juce::AudioBuffer<float>& output, int startSample, int numSamples);
+    void renderVoices(juce::AudioBuffer<float>& output, int startSample, int endSample);
+    void mixVoice(Voice& voice, juce::AudioBuffer<float>& output, int startSample, int numSamples);
+    void fadeOutVoice(Voice& voice, juce::AudioBuffer<float>& output, int startSample, int numSamples);
+    void stopVoice(Voice& voice);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SamplePlayer)
+};
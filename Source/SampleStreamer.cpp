@@ -0,0 +1,245 @@
+#include "SampleStreamer.h"
+#include "RealtimeSafetyChecker.h"
+
+//==============================================================================
+SampleStreamer::SampleStreamer()
+    : juce::Thread("SparkLE Sample Streamer")
+{
+    // Todo se reserva aquí: ni este hilo ni el de audio reservan después
+    for (auto& stream : streams)
+        stream.ring.setSize(2, ringSize);
+
+    sourceBuffer.setSize(2, (int) std::ceil(chunkSize * maxSourceRatio) + 8);
+    resampledBuffer.setSize(2, chunkSize);
+}
+
+SampleStreamer::~SampleStreamer()
+{
+    stopThread(2000);
+}
+
+//==============================================================================
+void SampleStreamer::prepareToStream(const LoadedSample* sample)
+{
+    SPARKLE_NON_REALTIME_CALL("SampleStreamer::prepareToStream");
+
+    // El hilo de lectura no existe hasta que hay algo que leer de disco
+    if (sample != nullptr && sample->isStreamed() && !isThreadRunning())
+        startThread(juce::Thread::Priority::high);
+}
+
+int SampleStreamer::startStream(const LoadedSample* sample)
+{
+    for (int i = 0; i < maxStreams; ++i)
+    {
+        auto& stream = streams[(size_t) i];
+
+        if (stream.state.load(std::memory_order_acquire) != freeState)
+            continue;
+
+        // El hilo de lectura prepara el stream en cuanto ve el estado pedido
+        stream.sample = sample;
+        stream.state.store(requestedState, std::memory_order_release);
+        return i;
+    }
+
+    return -1;
+}
+
+void SampleStreamer::stopStream(int index)
+{
+    if (juce::isPositiveAndBelow(index, maxStreams))
+        streams[(size_t) index].state.store(releasedState, std::memory_order_release);
+}
+
+int SampleStreamer::mixStream(int index, juce::AudioBuffer<float>& output, int startSample, int numSamples,
+                              float gain, bool& isFinished)
+{
+    isFinished = false;
+
+    if (!juce::isPositiveAndBelow(index, maxStreams))
+        return 0;
+
+    auto& stream = streams[(size_t) index];
+
+    // Aún sin preparar: la cabeza se ha quedado corta
+    if (stream.state.load(std::memory_order_acquire) != activeState)
+    {
+        underruns.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    const auto finished = stream.finished.load(std::memory_order_acquire);
+    const auto consumed = stream.consumed.load(std::memory_order_relaxed);
+    const auto available = (int) (stream.written.load(std::memory_order_acquire) - consumed);
+    const auto numToMix = juce::jmin(numSamples, available);
+    const auto numChannels = stream.sample->audio.getNumChannels();
+
+    // El anillo puede dar la vuelta dentro del bloque: como mucho dos trozos
+    const auto ringStart = (int) (consumed % ringSize);
+    const auto firstPart = juce::jmin(numToMix, ringSize - ringStart);
+
+    for (int channel = 0; channel < output.getNumChannels(); ++channel)
+    {
+        const auto sourceChannel = juce::jmin(channel, numChannels - 1);
+        auto* destination = output.getWritePointer(channel, startSample);
+
+        juce::FloatVectorOperations::addWithMultiply(destination, stream.ring.getReadPointer(sourceChannel, ringStart),
+                                                     gain, firstPart);
+
+        if (numToMix > firstPart)
+            juce::FloatVectorOperations::addWithMultiply(destination + firstPart, stream.ring.getReadPointer(sourceChannel),
+                                                         gain, numToMix - firstPart);
+    }
+
+    stream.consumed.store(consumed + numToMix, std::memory_order_release);
+
+    if (numToMix < numSamples)
+    {
+        if (finished)
+            isFinished = true;
+        else
+            underruns.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return numToMix;
+}
+
+void SampleStreamer::deleteSample(const LoadedSample* sample)
+{
+    SPARKLE_NON_REALTIME_CALL("SampleStreamer::deleteSample");
+
+    const juce::ScopedLock scopedLock(readerLock);
+    delete sample;
+}
+
+//==============================================================================
+void SampleStreamer::run()
+{
+    while (!threadShouldExit())
+    {
+        bool didWork = false;
+        bool hasActiveStreams = false;
+
+        for (auto& stream : streams)
+        {
+            // Un stream libre no toca el sample: se salta sin tomar el lock
+            if (stream.state.load(std::memory_order_acquire) == freeState)
+                continue;
+
+            // El estado se vuelve a leer con el lock tomado: si el audio ha soltado el
+            // stream entretanto, deleteSample puede haber borrado ya el sample
+            const juce::ScopedLock scopedLock(readerLock);
+            const auto state = stream.state.load(std::memory_order_acquire);
+
+            if (state == releasedState)
+            {
+                stream.sample = nullptr;
+                stream.state.store(freeState, std::memory_order_release);
+            }
+            else if (state == requestedState)
+            {
+                // Continúa donde terminó la cabeza
+                stream.sourcePosition = stream.sample->headSourceSamples;
+                stream.written.store(0, std::memory_order_relaxed);
+                stream.consumed.store(0, std::memory_order_relaxed);
+                stream.finished.store(false, std::memory_order_relaxed);
+
+                for (auto& interpolator : stream.interpolators)
+                    interpolator.reset();
+
+                // Si el audio lo ha soltado mientras tanto, se libera en la siguiente vuelta
+                auto expected = (int) requestedState;
+                stream.state.compare_exchange_strong(expected, activeState, std::memory_order_acq_rel);
+                didWork = true;
+                hasActiveStreams = true;
+            }
+            else if (state == activeState)
+            {
+                didWork = fill(stream) || didWork;
+                hasActiveStreams = true;
+            }
+        }
+
+        // El hilo de audio no despierta a este (notify toma un mutex): sin streams en
+        // uso se mira cada idleIntervalMs si ha pedido alguno, muy por debajo de lo
+        // que dura la cabeza. Con los anillos llenos no hay prisa; 2 ms es mucho
+        // menos que un anillo
+        if (!hasActiveStreams)
+            wait(idleIntervalMs);
+        else if (!didWork)
+            wait(2);
+    }
+}
+
+bool SampleStreamer::fill(Stream& stream)
+{
+    if (stream.finished.load(std::memory_order_relaxed))
+        return false;
+
+    const auto* sample = stream.sample;
+    auto* reader = sample->streamReader.get();
+    const auto written = stream.written.load(std::memory_order_relaxed);
+    const auto space = ringSize - (int) (written - stream.consumed.load(std::memory_order_acquire));
+
+    // Se espera a tener sitio para un trozo decente
+    if (space < chunkSize / 2)
+        return false;
+
+    const auto remaining = reader->lengthInSamples - stream.sourcePosition;
+
+    if (remaining <= 0)
+    {
+        stream.finished.store(true, std::memory_order_release);
+        return false;
+    }
+
+    const auto ratio = sample->sourceRatio;
+    const auto numChannels = sample->audio.getNumChannels();
+    auto numOut = juce::jmin(space, chunkSize);
+    const auto wantedIn = ratio == 1.0 ? numOut : (int) std::ceil(numOut * ratio) + 4;
+    const auto numIn = (int) juce::jmin((juce::int64) wantedIn, remaining);
+
+    reader->read(&sourceBuffer, 0, numIn, stream.sourcePosition, true, numChannels > 1);
+
+    int numUsed = numIn;
+
+    if (ratio == 1.0)
+    {
+        numOut = numIn;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            resampledBuffer.copyFrom(channel, 0, sourceBuffer, channel, 0, numOut);
+    }
+    else
+    {
+        // Al final del fichero salen menos samples
+        if (numIn < wantedIn)
+            numOut = juce::jmax(1, (int) ((numIn - 1) / ratio));
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            numUsed = stream.interpolators[(size_t) channel].process(ratio, sourceBuffer.getReadPointer(channel),
+                                                                     resampledBuffer.getWritePointer(channel),
+                                                                     numOut, numIn, 0);
+    }
+
+    // Copia al anillo, partiendo en dos si da la vuelta
+    const auto ringStart = (int) (written % ringSize);
+    const auto firstPart = juce::jmin(numOut, ringSize - ringStart);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        stream.ring.copyFrom(channel, ringStart, resampledBuffer, channel, 0, firstPart);
+
+        if (numOut > firstPart)
+            stream.ring.copyFrom(channel, 0, resampledBuffer, channel, firstPart, numOut - firstPart);
+    }
+
+    stream.sourcePosition += juce::jmax(1, numUsed);
+    stream.written.store(written + numOut, std::memory_order_release);
+
+    if (stream.sourcePosition >= reader->lengthInSamples)
+        stream.finished.store(true, std::memory_order_release);
+
+    return true;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <array>
+#include <atomic>
+#include "SamplePlayer.h"
+
+//==============================================================================
+/**
+ * Lectura desde disco de los samples largos.
+ *
+ * Un sample largo solo tiene en memoria su cabeza (LoadedSample::audio); el resto
+ * lo lee este hilo del fichero, normalmente mapeado en memoria, y lo deja ya
+ * convertido al sample rate del dispositivo en el anillo de un stream. Cada voz que
+ * toca un sample largo ocupa un stream: empieza a sonar con la cabeza y, cuando la
+ * termina, sigue leyendo del anillo, que para entonces ya está lleno.
+ *
+ * Estados de un stream: libre -> pedido (audio) -> activo (este hilo) -> liberado
+ * (audio) -> libre (este hilo). El hilo de audio solo toma streams libres y solo
+ * lee el anillo de uno activo, así que nunca bloquea. Los samples con lector se
+ * liberan con deleteSample(), que espera a que este hilo no esté leyendo de ellos.
+ *
+ * El hilo arranca con el primer sample largo. El hilo de audio no lo despierta
+ * nunca: mientras ningún stream está en uso solo mira los estados cada
+ * idleIntervalMs, que es mucho menos de lo que dura la cabeza.
+ */
+class SampleStreamer : private juce::Thread
+{
+public:
+    static constexpr int maxStreams = 32;
+    static constexpr int ringSize = 16384;          // Samples por canal de cada anillo
+    static constexpr int chunkSize = 2048;          // Samples producidos por lectura
+    static constexpr double maxSourceRatio = 8.0;   // Fichero a 8x el rate del dispositivo como mucho
+    static constexpr int idleIntervalMs = 20;       // Sin streams en uso; la cabeza dura 500 ms
+
+    SampleStreamer();
+    ~SampleStreamer() override;
+
+    // Hilo de mensajes: llamar antes de instalar un sample; arranca el hilo de
+    // lectura si el sample es largo
+    void prepareToStream(const LoadedSample* sample);
+
+    // Hilo de audio. startStream devuelve -1 si no queda ningún stream libre
+    int startStream(const LoadedSample* sample);
+    void stopStream(int index);
+
+    // Suma al buffer hasta numSamples del stream con la ganancia dada. Devuelve los
+    // que ha podido mezclar; si son menos de los pedidos, el sample ha terminado
+    // (isFinished) o el disco no ha llegado a tiempo (se cuenta como corte)
+    int mixStream(int index, juce::AudioBuffer<float>& output, int startSample, int numSamples,
+                  float gain, bool& isFinished);
+
+    // Hilo de mensajes: libera un sample asegurándose de que no se está leyendo
+    void deleteSample(const LoadedSample* sample);
+
+    int getNumUnderruns() const { return underruns.load(std::memory_order_relaxed); }
+
+private:
+    enum State { freeState, requestedState, activeState, releasedState };
+
+    struct Stream
+    {
+        std::atomic<int> state { freeState };
+        const LoadedSample* sample = nullptr;
+
+        // Solo los toca este hilo
+        juce::int64 sourcePosition = 0;
+        std::array<juce::LagrangeInterpolator, 2> interpolators;
+
+        std::atomic<juce::int64> written { 0 };
+        std::atomic<juce::int64> consumed { 0 };
+        std::atomic<bool> finished { false };
+        juce::AudioBuffer<float> ring;
+    };
+
+    std::array<Stream, maxStreams> streams;
+    std::atomic<int> underruns { 0 };
+
+    // Entre este hilo y el de mensajes: nunca lo toma el hilo de audio
+    juce::CriticalSection readerLock;
+
+    juce::AudioBuffer<float> sourceBuffer;
+    juce::AudioBuffer<float> resampledBuffer;
+
+    void run() override;
+    bool fill(Stream& stream);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleStreamer)
+};
@@ -0,0 +1,263 @@
+#include "SequencerClock.h"
+
+//==============================================================================
+int SequencerClock::BlockTiming::sampleOffsetFor(const Segment& segment, double ppq) const
+{
+    if (segment.ppqPerSample <= 0.0)
+        return segment.sampleStart;
+
+    // Redondea hacia arriba: el evento cae en el primer sample que alcanza su posición
+    auto offset = static_cast<int>(std::ceil((ppq - segment.ppqStart) / segment.ppqPerSample - 1.0e-9));
+    offset = juce::jlimit(0, juce::jmax(0, segment.numSamples - 1), offset);
+
+    return segment.sampleStart + offset;
+}
+
+double SequencerClock::BlockTiming::exactSampleFor(const Segment& segment, double ppq) const
+{
+    if (segment.ppqPerSample <= 0.0)
+        return (double) segment.sampleStart;
+
+    return segment.sampleStart + (ppq - segment.ppqStart) / segment.ppqPerSample;
+}
+
+double SequencerClock::BlockTiming::ppqAt(int sampleOffset) const
+{
+    if (numSegments == 0)
+        return 0.0;
+
+    // Tramo que contiene el sample; uno posterior al último cuenta en el último tramo
+    auto* segment = &segments[0];
+
+    for (int i = 1; i < numSegments && segments[i].sampleStart <= sampleOffset; ++i)
+        segment = &segments[i];
+
+    return segment->ppqStart + (sampleOffset - segment->sampleStart) * segment->ppqPerSample;
+}
+
+//==============================================================================
+void SequencerClock::prepare(double newSampleRate)
+{
+    // Conserva la posición musical actual al cambiar el sample rate
+    reanchor();
+    sampleRate = newSampleRate;
+}
+
+void SequencerClock::start()
+{
+    if (!running)
+    {
+        running = true;
+        sampleCounter = 0;
+        anchorSample = 0;
+        anchorPpq = 0.0;
+        hasLastPpqEnd = false;
+    }
+}
+
+void SequencerClock::stop()
+{
+    running = false;
+    hasLastPpqEnd = false;
+}
+
+void SequencerClock::setTempo(double newBpm, int rampSamples)
+{
+    if (newBpm <= 0.0 || newBpm == (rampLength > 0 ? rampTargetBpm : bpm))
+        return;
+
+    // Fija el ancla en la posición actual para que el cambio no mueva la rejilla
+    reanchor();
+
+    if (rampSamples > 0)
+    {
+        // La rampa parte del tempo actual, aunque otra rampa no hubiera terminado
+        rampStartBpm = bpm;
+        rampTargetBpm = newBpm;
+        rampLength = rampSamples;
+        rampPosition = 0;
+    }
+    else
+    {
+        bpm = newBpm;
+        rampLength = 0;
+    }
+}
+
+SequencerClock::BlockTiming SequencerClock::advance(int numSamples, juce::AudioPlayHead* playHead)
+{
+    BlockTiming timing;
+
+    // Si el host informa de su posición, su transporte decide si el reloj avanza
+    juce::Optional<juce::AudioPlayHead::PositionInfo> position;
+
+    if (playHead != nullptr)
+        position = playHead->getPosition();
+
+    const bool hasHostTransport = position.hasValue() && position->getPpqPosition().hasValue();
+
+    const bool hostDriven = hasHostTransport
+                         && position->getIsPlaying()
+                         && position->getBpm().hasValue()
+                         && *position->getBpm() > 0.0;
+
+    timing.isRunning = hasHostTransport ? hostDriven : running;
+
+    if (!timing.isRunning || numSamples <= 0)
+    {
+        sampleCounter += juce::jmax(0, numSamples);
+
+        // Al volver a arrancar, la posición se toma de nuevo
+        if (!timing.isRunning)
+        {
+            wasHostDriven = false;
+            hasLastPpqEnd = false;
+        }
+
+        return timing;
+    }
+
+    timing.isHostDriven = hostDriven;
+
+    if (hostDriven)
+    {
+        // El tempo del host manda: una rampa del reloj interno termina de golpe
+        if (rampLength > 0)
+        {
+            bpm = rampTargetBpm;
+            rampLength = 0;
+        }
+
+        timing.bpm = *position->getBpm();
+        timing.ppqPerSample = timing.bpm / (60.0 * sampleRate);
+
+        const double ppqStart = *position->getPpqPosition();
+        const double ppqEnd = ppqStart + numSamples * timing.ppqPerSample;
+
+        // Un salto mayor que medio sample se considera reposicionamiento
+        timing.hasJumped = !wasHostDriven
+                        || !hasLastPpqEnd
+                        || std::abs(ppqStart - lastPpqEnd) > timing.ppqPerSample * 0.5;
+
+        auto loopPoints = position->getLoopPoints();
+
+        if (position->getIsLooping() && loopPoints.hasValue()
+            && loopPoints->ppqEnd > loopPoints->ppqStart
+            && ppqStart < loopPoints->ppqEnd && ppqEnd > loopPoints->ppqEnd)
+        {
+            // El loop termina dentro del bloque: dos tramos
+            auto firstSamples = static_cast<int>(std::ceil((loopPoints->ppqEnd - ppqStart) / timing.ppqPerSample));
+            firstSamples = juce::jlimit(1, numSamples, firstSamples);
+
+            timing.segments[0] = { ppqStart, loopPoints->ppqEnd, 0, firstSamples, timing.ppqPerSample };
+            timing.numSegments = 1;
+
+            if (firstSamples < numSamples)
+            {
+                const auto rest = numSamples - firstSamples;
+                const auto loopStart = loopPoints->ppqStart;
+                timing.segments[1] = { loopStart, loopStart + rest * timing.ppqPerSample, firstSamples, rest, timing.ppqPerSample };
+                timing.numSegments = 2;
+            }
+        }
+        else
+        {
+            timing.segments[0] = { ppqStart, ppqEnd, 0, numSamples, timing.ppqPerSample };
+            timing.numSegments = 1;
+        }
+
+        // Mantiene el reloj interno alineado por si el host deja de informar
+        anchorPpq = timing.segments[timing.numSegments - 1].ppqEnd;
+        sampleCounter += numSamples;
+        anchorSample = sampleCounter;
+    }
+    else if (rampLength > 0)
+    {
+        timing.hasJumped = wasHostDriven || !hasLastPpqEnd;
+        advanceRamp(timing, numSamples);
+    }
+    else
+    {
+        // Contador de samples propio (Standalone)
+        timing.bpm = bpm;
+        timing.ppqPerSample = bpm / (60.0 * sampleRate);
+        timing.hasJumped = wasHostDriven || !hasLastPpqEnd;
+
+        const double ppqStart = internalPpqAt(sampleCounter);
+        sampleCounter += numSamples;
+        const double ppqEnd = internalPpqAt(sampleCounter);
+
+        timing.segments[0] = { ppqStart, ppqEnd, 0, numSamples, timing.ppqPerSample };
+        timing.numSegments = 1;
+    }
+
+    wasHostDriven = hostDriven;
+    hasLastPpqEnd = true;
+    lastPpqEnd = timing.segments[timing.numSegments - 1].ppqEnd;
+
+    return timing;
+}
+
+double SequencerClock::internalPpqAt(juce::int64 sample) const
+{
+    return anchorPpq + static_cast<double>(sample - anchorSample) * bpm / (60.0 * sampleRate);
+}
+
+void SequencerClock::advanceRamp(BlockTiming& timing, int numSamples)
+{
+    // Tramos iguales a lo largo de la rampa; el último tramo libre se queda con lo que
+    // falte del bloque, ya al tempo final si la rampa termina dentro
+    const auto segmentSamples = juce::jmax(minRampSegmentSamples, (numSamples + maxSegments - 2) / (maxSegments - 1));
+    const auto ppqStart = internalPpqAt(sampleCounter);
+    auto ppq = ppqStart;
+    int sample = 0;
+
+    timing.numSegments = 0;
+
+    while (sample < numSamples)
+    {
+        auto length = numSamples - sample;
+
+        if (rampLength > 0 && timing.numSegments < maxSegments - 1)
+            length = juce::jmin(length, segmentSamples, rampLength - rampPosition);
+
+        // Tempo del punto medio del tramo: el error frente a la rampa continua es
+        // de una fracción de sample
+        auto segmentBpm = bpm;
+
+        if (rampLength > 0)
+        {
+            const auto middle = juce::jmin(1.0, (rampPosition + length * 0.5) / rampLength);
+            segmentBpm = rampStartBpm + (rampTargetBpm - rampStartBpm) * middle;
+
+            rampPosition += length;
+            bpm = rampStartBpm + (rampTargetBpm - rampStartBpm) * juce::jmin(1.0, (double) rampPosition / rampLength);
+
+            if (rampPosition >= rampLength)
+            {
+                bpm = rampTargetBpm;
+                rampLength = 0;
+            }
+        }
+
+        const auto segmentPpqPerSample = segmentBpm / (60.0 * sampleRate);
+        timing.segments[timing.numSegments++] = { ppq, ppq + length * segmentPpqPerSample, sample, length, segmentPpqPerSample };
+
+        ppq += length * segmentPpqPerSample;
+        sample += length;
+    }
+
+    timing.bpm = bpm;
+    timing.ppqPerSample = (ppq - ppqStart) / numSamples;
+
+    // La posición sigue desde el final del bloque con el tempo que ha quedado
+    sampleCounter += numSamples;
+    anchorSample = sampleCounter;
+    anchorPpq = ppq;
+}
+
+void SequencerClock::reanchor()
+{
+    anchorPpq = internalPpqAt(sampleCounter);
+    anchorSample = sampleCounter;
+}
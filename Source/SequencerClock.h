@@ -0,0 +1,97 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+//==============================================================================
+/**
+ * Reloj del secuenciador.
+ *
+ * Traduce cada bloque de audio a un rango de posiciones musicales (en negras, PPQ).
+ * Si el host informa de su posición manda su transporte: se usan su PPQ y su tempo,
+ * y con el host parado el reloj está parado. Sin posición del host (Standalone) se
+ * cuenta en samples a partir de un ancla, con el transporte propio del plugin, de
+ * modo que la posición nunca acumula error aunque cambie el tempo.
+ *
+ * Un cambio de tempo del reloj interno puede hacerse en rampa: el bloque se parte en
+ * tramos cortos, cada uno con el tempo de su punto medio, así que los eventos caen en
+ * el sample que les toca a lo largo de la rampa y no solo al principio del bloque.
+ */
+class SequencerClock
+{
+public:
+    // Tramo contiguo del bloque con tempo constante: un loop del host parte un bloque
+    // en dos, y una rampa de tempo en varios
+    struct Segment
+    {
+        double ppqStart = 0.0;
+        double ppqEnd = 0.0;
+        int sampleStart = 0;
+        int numSamples = 0;
+        double ppqPerSample = 0.0;
+    };
+
+    static constexpr int maxSegments = 16;
+    static constexpr int minRampSegmentSamples = 16;
+
+    struct BlockTiming
+    {
+        bool isRunning = false;
+        bool hasJumped = false;        // Reposicionamiento o vuelta de loop
+        bool isHostDriven = false;
+        double bpm = 120.0;            // Al final del bloque
+        double ppqPerSample = 0.0;     // Media del bloque
+        int numSegments = 0;
+        Segment segments[maxSegments];
+
+        // Primer sample del bloque cuya posición es >= ppq (dentro del tramo)
+        int sampleOffsetFor(const Segment& segment, double ppq) const;
+
+        // Posición exacta (fraccionaria) de ppq en el bloque, sin redondear ni recortar
+        double exactSampleFor(const Segment& segment, double ppq) const;
+
+        // Posición musical de un sample del bloque (la inversa de las dos anteriores)
+        double ppqAt(int sampleOffset) const;
+    };
+
+    SequencerClock() = default;
+
+    void prepare(double newSampleRate);
+
+    // Transporte interno (Standalone): sin efecto mientras el host informa de su posición
+    void start();
+    void stop();
+    bool isRunning() const { return running; }
+
+    // Con rampSamples > 0 el tempo cambia linealmente a lo largo de esos samples
+    // (solo en el reloj interno: con el host manda su tempo)
+    void setTempo(double newBpm, int rampSamples = 0);
+    double getTempo() const { return bpm; }
+
+    // Avanza el reloj un bloque. playHead puede ser nullptr.
+    BlockTiming advance(int numSamples, juce::AudioPlayHead* playHead);
+
+private:
+    double sampleRate = 44100.0;
+    double bpm = 120.0;
+    bool running = false;
+
+    // Modo interno: posición = anchorPpq + (sampleCounter - anchorSample) * ppqPerSample
+    juce::int64 sampleCounter = 0;
+    juce::int64 anchorSample = 0;
+    double anchorPpq = 0.0;
+
+    // Para detectar saltos de posición del host
+    bool wasHostDriven = false;
+    bool hasLastPpqEnd = false;
+    double lastPpqEnd = 0.0;
+
+    // Rampa de tempo en curso
+    double rampStartBpm = 120.0;
+    double rampTargetBpm = 120.0;
+    int rampLength = 0;
+    int rampPosition = 0;
+
+    double internalPpqAt(juce::int64 sample) const;
+    void reanchor();
+    void advanceRamp(BlockTiming& timing, int numSamples);
+};
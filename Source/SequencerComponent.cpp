@@ -5,212 +5,550 @@
 SequencerComponent::SequencerComponent(SparkLEPluginAudioProcessor& p)
     : audioProcessor(p)
 {
-    // Inicializa algunos pasos para visualización
-    sequencerGrid[0][0] = true;
-    sequencerGrid[0][4] = true;
-    sequencerGrid[0][8] = true;
-    sequencerGrid[0][12] = true;
-    sequencerGrid[2][2] = true;
-    sequencerGrid[2][6] = true;
-    sequencerGrid[2][10] = true;
-    sequencerGrid[2][14] = true;
-    
-    // Crea los botones de la cuadrícula
-    createGridButtons();
-    
+    // Pinta todo su área: lo que hay detrás no se repinta con cada cabezal
+    setOpaque(true);
+    setWantsKeyboardFocus(true);
+
+    // Las barras solo aparecen cuando la cuadrícula no cabe
+    for (auto* scrollBar : { &horizontalScrollBar, &verticalScrollBar })
+    {
+        scrollBar->setAutoHide(true);
+        scrollBar->addListener(this);
+        addAndMakeVisible(scrollBar);
+    }
+
     debug();
 }
 
 SequencerComponent::~SequencerComponent()
 {
-    // Los objetos en OwnedArray se eliminan automáticamente
+    horizontalScrollBar.removeListener(this);
+    verticalScrollBar.removeListener(this);
 }
 
 void SequencerComponent::debug()
 {
-    juce::Logger::writeToLog("SequencerComponent::debug()");
-    juce::Logger::writeToLog("- numPads: " + juce::String(numPads));
-    juce::Logger::writeToLog("- numSteps: " + juce::String(numSteps));
-    juce::Logger::writeToLog("- currentStep: " + juce::String(currentStep));
-    juce::Logger::writeToLog("- padButtons size: " + juce::String(padButtons.size()));
-    juce::Logger::writeToLog("- Step 0,0: " + juce::String(sequencerGrid[0][0] ? "ON" : "OFF"));
+    SPARKLE_LOG_DEBUG("SequencerComponent::debug()");
+    SPARKLE_LOG_DEBUG("- numRows: " + juce::String(getNumRows()));
+    SPARKLE_LOG_DEBUG("- numColumns: " + juce::String(numColumns));
+    SPARKLE_LOG_DEBUG("- currentStep: " + juce::String(snapshot.currentStep));
+    SPARKLE_LOG_DEBUG("- Step 0,0: " + juce::String(getPattern().getStep(0, 0) ? "ON" : "OFF"));
+}
+
+const Pattern& SequencerComponent::getPattern() const
+{
+    return audioProcessor.getMidiHandler()->getPattern();
+}
+
+int SequencerComponent::getPlayheadStep(const EngineSnapshot& state, int row) const
+{
+    // Los cabezales son del patrón que suena; en modo canción o con un cambio en cola
+    // puede ser otro, y sobre este no significan nada
+    if (state.playingPattern != audioProcessor.getMidiHandler()->getSelectedPattern())
+        return -1;
+
+    return state.trackPlayheads[(size_t) row];
+}
+
+//==============================================================================
+juce::Rectangle<int> SequencerComponent::getGridArea() const
+{
+    return getLocalBounds().withTrimmedRight(scrollBarThickness).withTrimmedBottom(scrollBarThickness);
+}
+
+float SequencerComponent::getCellWidth() const
+{
+    return getGridArea().getWidth() / (float) Pattern::defaultNumSteps * zoom;
+}
+
+float SequencerComponent::getCellHeight() const
+{
+    return getGridArea().getHeight() / (float) Pattern::defaultNumTracks * zoom;
+}
+
+juce::Rectangle<int> SequencerComponent::getStepRect(int row, int col) const
+{
+    // Bordes redondeados por separado: las casillas encajan sin huecos con cualquier zoom
+    const auto area = getGridArea();
+    const auto cellWidth = getCellWidth();
+    const auto cellHeight = getCellHeight();
+    const auto left = juce::roundToInt(col * cellWidth);
+    const auto top = juce::roundToInt(row * cellHeight);
+
+    return { area.getX() + left - scrollX,
+             area.getY() + top - scrollY,
+             juce::roundToInt((col + 1) * cellWidth) - left,
+             juce::roundToInt((row + 1) * cellHeight) - top };
 }
 
+bool SequencerComponent::getCellAt(juce::Point<int> position, int& row, int& col) const
+{
+    const auto area = getGridArea();
+
+    if (!area.contains(position))
+        return false;
+
+    col = (int) std::floor((position.x - area.getX() + scrollX) / getCellWidth());
+    row = (int) std::floor((position.y - area.getY() + scrollY) / getCellHeight());
+
+    return juce::isPositiveAndBelow(col, numColumns) && juce::isPositiveAndBelow(row, getNumRows());
+}
+
+juce::Range<int> SequencerComponent::getVisibleColumns(juce::Rectangle<int> area) const
+{
+    const auto gridX = getGridArea().getX() - scrollX;
+    const auto cellWidth = getCellWidth();
+
+    return { juce::jlimit(0, numColumns, (int) std::floor((area.getX() - gridX) / cellWidth)),
+             juce::jlimit(0, numColumns, (int) std::ceil((area.getRight() - gridX) / cellWidth)) };
+}
+
+juce::Range<int> SequencerComponent::getVisibleRows(juce::Rectangle<int> area) const
+{
+    const auto gridY = getGridArea().getY() - scrollY;
+    const auto cellHeight = getCellHeight();
+
+    return { juce::jlimit(0, getNumRows(), (int) std::floor((area.getY() - gridY) / cellHeight)),
+             juce::jlimit(0, getNumRows(), (int) std::ceil((area.getBottom() - gridY) / cellHeight)) };
+}
+
+//==============================================================================
 void SequencerComponent::paint(juce::Graphics& g)
 {
+    const auto area = getGridArea();
+
+    // Esquina entre las dos barras
+    g.setColour(juce::Colour(0xff222233));
+    g.fillRect(getLocalBounds().withLeft(area.getRight()).withTop(area.getBottom()));
+
+    // La parte fija (fondo, líneas y pasos fuera de la longitud de cada pista) sale de
+    // una imagen; encima solo se dibujan las casillas que caen en la zona a repintar
+    const auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+
+    if (!gridImage.isValid() || gridImageScale != scale)
+        renderGridImage(scale);
+
+    g.drawImage(gridImage, area.toFloat());
+    g.reduceClipRegion(area);
+
+    const auto clip = g.getClipBounds();
+    const auto rows = getVisibleRows(clip);
+    const auto columns = getVisibleColumns(clip);
+    const auto& pattern = getPattern();
+
+    for (int row = rows.getStart(); row < rows.getEnd(); ++row)
+    {
+        const auto playhead = getPlayheadStep(snapshot, row);
+
+        for (int col = columns.getStart(); col < columns.getEnd(); ++col)
+        {
+            const auto cell = getStepRect(row, col);
+
+            // Destaca el paso actual de cada pista: con longitudes y duraciones distintas
+            // cada una lleva su propio cabezal
+            if (playhead == col)
+            {
+                g.setColour(juce::Colours::yellow.withAlpha(0.3f));
+                g.fillRect(cell);
+            }
+
+            if (pattern.getStep(row, col))
+                paintActiveStep(g, row, cell);
+        }
+    }
+
+    // Cursor del teclado
+    if (hasKeyboardFocus(false))
+    {
+        g.setColour(juce::Colours::white);
+        g.drawRect(getStepRect(cursorRow, cursorColumn), 2);
+    }
+}
+
+void SequencerComponent::paintActiveStep(juce::Graphics& g, int row, juce::Rectangle<int> cell)
+{
+    auto rect = cell.reduced(2);
+
+    // Colores más brillantes y altamente visibles para cada fila
+    juce::Colour rowColor;
+    switch (row % 4) {
+        case 0: rowColor = juce::Colours::orange.brighter(0.8f); break;
+        case 1: rowColor = juce::Colours::cyan.brighter(0.8f); break;
+        case 2: rowColor = juce::Colours::lime.brighter(0.8f); break;
+        case 3: rowColor = juce::Colours::magenta.brighter(0.8f); break;
+    }
+
+    // Contorno grueso para mayor visibilidad
+    g.setColour(rowColor.darker());
+    g.drawRoundedRectangle(rect.toFloat(), 4.0f, 2.0f);
+
+    // Relleno brillante
+    g.setColour(rowColor);
+    g.fillRoundedRectangle(rect.reduced(2).toFloat(), 3.0f);
+}
+
+void SequencerComponent::renderGridImage(float scale)
+{
+    const auto area = getGridArea();
+
+    // A la resolución física de la pantalla, para que no se vea borrosa en HiDPI.
+    // Solo cubre la zona visible: su tamaño no depende del patrón
+    gridImageScale = scale;
+    gridImage = juce::Image(juce::Image::RGB,
+                            juce::jmax(1, juce::roundToInt(area.getWidth() * scale)),
+                            juce::jmax(1, juce::roundToInt(area.getHeight() * scale)),
+                            false);
+
+    juce::Graphics g(gridImage);
+    g.addTransform(juce::AffineTransform::scale(scale));
+    g.setOrigin(-area.getX(), -area.getY());
+
     // Fondo del secuenciador
     g.fillAll(juce::Colour(0xff222233));  // Azul oscuro más sutil
-    
-    // Marco alrededor del secuenciador
-    g.setColour(juce::Colours::white);
-    g.drawRect(getLocalBounds(), 1);  // Borde más fino
-    
-    // Dibuja las líneas de la cuadrícula
+
+    // Dibuja las líneas de la cuadrícula visibles
     g.setColour(juce::Colours::darkgrey);
-    
-    float cellWidth = getWidth() / (float)numSteps;
-    float cellHeight = getHeight() / (float)numPads;
-    
-    // Líneas verticales
-    for (int i = 0; i <= numSteps; ++i)
+
+    const auto rows = getVisibleRows(area);
+    const auto columns = getVisibleColumns(area);
+    const auto& pattern = getPattern();
+
+    for (int col = columns.getStart(); col <= columns.getEnd(); ++col)
     {
-        float x = i * cellWidth;
-        g.drawLine(x, 0, x, getHeight(), 0.5f);
+        const auto x = (float) getStepRect(0, col).getX();
+        g.drawLine(x, (float) area.getY(), x, (float) area.getBottom(), 0.5f);
     }
-    
-    // Líneas horizontales
-    for (int i = 0; i <= numPads; ++i)
+
+    for (int row = rows.getStart(); row <= rows.getEnd(); ++row)
     {
-        float y = i * cellHeight;
-        g.drawLine(0, y, getWidth(), y, 0.5f);
+        const auto y = (float) getStepRect(row, 0).getY();
+        g.drawLine((float) area.getX(), y, (float) area.getRight(), y, 0.5f);
     }
-    
-    // Destaca el paso actual con un color brillante
-    g.setColour(juce::Colours::yellow.withAlpha(0.3f));
-    g.fillRect(getStepRect(0, currentStep).withHeight(getHeight()));
-    
-    // Destaca los pasos activos con colores muy claros y brillantes
-    for (int row = 0; row < numPads; ++row)
+
+    // Oscurece los pasos que quedan fuera de la longitud de cada pista y lo que
+    // queda por debajo de la última pista
+    g.setColour(juce::Colours::black.withAlpha(0.5f));
+    shownNumRows = getNumRows();
+
+    for (int row = 0; row < shownNumRows; ++row)
     {
-        for (int col = 0; col < numSteps; ++col)
-        {
-            if (sequencerGrid[row][col])
-            {
-                auto rect = getStepRect(row, col).reduced(2);
-                
-                // Colores más brillantes y altamente visibles para cada fila
-                juce::Colour rowColor;
-                switch (row % 4) {
-                    case 0: rowColor = juce::Colours::orange.brighter(0.8f); break;
-                    case 1: rowColor = juce::Colours::cyan.brighter(0.8f); break;
-                    case 2: rowColor = juce::Colours::lime.brighter(0.8f); break;
-                    case 3: rowColor = juce::Colours::magenta.brighter(0.8f); break;
-                }
-                
-                // Contorno grueso para mayor visibilidad
-                g.setColour(rowColor.darker());
-                g.drawRoundedRectangle(rect.toFloat(), 4.0f, 2.0f);
-                
-                // Relleno brillante
-                g.setColour(rowColor);
-                g.fillRoundedRectangle(rect.reduced(2).toFloat(), 3.0f);
-            }
-        }
+        const int length = pattern.getTrackLength(row);
+        shownLengths[(size_t) row] = length;
+
+        if (rows.contains(row) && length < numColumns)
+            g.fillRect(getStepRect(row, length).withRight(area.getRight()));
     }
+
+    g.fillRect(area.withTop(getStepRect(shownNumRows, 0).getY()));
+
+    // Marco alrededor del secuenciador
+    g.setColour(juce::Colours::white);
+    g.drawRect(area, 1);  // Borde más fino
 }
 
 void SequencerComponent::resized()
 {
-    // Actualiza las posiciones de los botones
-    float cellWidth = getWidth() / (float)numSteps;
-    float cellHeight = getHeight() / (float)numPads;
-    
-    for (int row = 0; row < numPads; ++row)
+    const auto area = getGridArea();
+
+    horizontalScrollBar.setBounds(area.getX(), area.getBottom(), area.getWidth(), scrollBarThickness);
+    verticalScrollBar.setBounds(area.getRight(), area.getY(), scrollBarThickness, area.getHeight());
+
+    setScroll(scrollX, scrollY);
+    gridImage = {};
+}
+
+//==============================================================================
+void SequencerComponent::setZoom(float newZoom, juce::Point<float> anchor)
+{
+    newZoom = juce::jlimit(minZoom, maxZoom, newZoom);
+
+    if (newZoom == zoom)
+        return;
+
+    // El punto de la cuadrícula bajo el ratón se queda donde está
+    const auto area = getGridArea();
+    const auto contentX = (anchor.x - area.getX() + scrollX) / getCellWidth();
+    const auto contentY = (anchor.y - area.getY() + scrollY) / getCellHeight();
+
+    zoom = newZoom;
+
+    setScroll(juce::roundToInt(contentX * getCellWidth() - (anchor.x - area.getX())),
+              juce::roundToInt(contentY * getCellHeight() - (anchor.y - area.getY())));
+    gridImage = {};
+    repaint();
+}
+
+void SequencerComponent::setScroll(int newScrollX, int newScrollY)
+{
+    const auto area = getGridArea();
+    const auto contentWidth = juce::roundToInt(numColumns * getCellWidth());
+    const auto contentHeight = juce::roundToInt(getNumRows() * getCellHeight());
+
+    newScrollX = juce::jlimit(0, juce::jmax(0, contentWidth - area.getWidth()), newScrollX);
+    newScrollY = juce::jlimit(0, juce::jmax(0, contentHeight - area.getHeight()), newScrollY);
+
+    if (newScrollX != scrollX || newScrollY != scrollY)
+    {
+        scrollX = newScrollX;
+        scrollY = newScrollY;
+        gridImage = {};
+        repaint();
+    }
+
+    updateScrollBars();
+}
+
+void SequencerComponent::scrollToShow(int row, int col)
+{
+    const auto area = getGridArea();
+    const auto cell = getStepRect(row, col);
+    auto newScrollX = scrollX;
+    auto newScrollY = scrollY;
+
+    if (cell.getX() < area.getX())               newScrollX -= area.getX() - cell.getX();
+    else if (cell.getRight() > area.getRight())  newScrollX += cell.getRight() - area.getRight();
+
+    if (cell.getY() < area.getY())               newScrollY -= area.getY() - cell.getY();
+    else if (cell.getBottom() > area.getBottom()) newScrollY += cell.getBottom() - area.getBottom();
+
+    setScroll(newScrollX, newScrollY);
+}
+
+void SequencerComponent::updateScrollBars()
+{
+    const auto area = getGridArea();
+
+    horizontalScrollBar.setRangeLimits(0.0, numColumns * getCellWidth(), juce::dontSendNotification);
+    horizontalScrollBar.setCurrentRange(scrollX, area.getWidth(), juce::dontSendNotification);
+    verticalScrollBar.setRangeLimits(0.0, getNumRows() * getCellHeight(), juce::dontSendNotification);
+    verticalScrollBar.setCurrentRange(scrollY, area.getHeight(), juce::dontSendNotification);
+}
+
+void SequencerComponent::scrollBarMoved(juce::ScrollBar* scrollBar, double newRangeStart)
+{
+    if (scrollBar == &horizontalScrollBar)
+        setScroll(juce::roundToInt(newRangeStart), scrollY);
+    else
+        setScroll(scrollX, juce::roundToInt(newRangeStart));
+}
+
+//==============================================================================
+void SequencerComponent::updateDisplay()
+{
+    // Los cabezales salen de la copia publicada por el hilo de audio. Si la versión
+    // no ha cambiado, tampoco lo ha hecho ninguno
+    EngineSnapshot latest;
+
+    if (audioProcessor.getMidiHandler()->getEngineSnapshot(latest) && latest.version != snapshot.version)
     {
-        for (int col = 0; col < numSteps; ++col)
+        // Solo se repintan la casilla que deja cada cabezal y la que ocupa
+        for (int row = 0; row < getNumRows(); ++row)
         {
-            int index = row * numSteps + col;
-            if (index < padButtons.size() && padButtons[index] != nullptr)
+            const auto shownPlayhead = getPlayheadStep(snapshot, row);
+            const auto playhead = getPlayheadStep(latest, row);
+
+            if (playhead != shownPlayhead)
             {
-                padButtons[index]->setBounds(getStepRect(row, col));
+                repaintStep(row, shownPlayhead);
+                repaintStep(row, playhead);
             }
         }
+
+        snapshot = latest;
+    }
+
+    const auto& pattern = getPattern();
+    const auto numRows = getNumRows();
+
+    // Otro número de pistas cambia el tamaño de la cuadrícula
+    if (numRows != shownNumRows)
+    {
+        cursorRow = juce::jmin(cursorRow, numRows - 1);
+        setScroll(scrollX, scrollY);
+        gridImage = {};
+        repaint();
+    }
+
+    for (int row = 0; row < numRows; ++row)
+    {
+        // Una longitud distinta cambia la parte fija: se rehace la imagen entera
+        if (pattern.getTrackLength(row) != shownLengths[(size_t) row])
+        {
+            gridImage = {};
+            repaint();
+        }
+
+        // Y los pasos que han cambiado, los edite quien los edite
+        auto changedSteps = pattern.getRow(row) ^ shownRows[(size_t) row];
+        shownRows[(size_t) row] = pattern.getRow(row);
+
+        for (int col = 0; changedSteps != 0; ++col, changedSteps >>= 1)
+            if ((changedSteps & 1) != 0)
+                repaintStep(row, col);
     }
 }
 
-void SequencerComponent::updateDisplay()
+void SequencerComponent::repaintStep(int row, int col)
 {
-    // Actualiza el paso actual desde el MidiHandler
-    currentStep = audioProcessor.getMidiHandler()->getCurrentStep();
-    
-    // Repinta el componente
-    repaint();
+    // Las casillas fuera de la vista no generan repintado
+    if (juce::isPositiveAndBelow(col, numColumns))
+    {
+        const auto cell = getStepRect(row, col).getIntersection(getGridArea());
+
+        if (!cell.isEmpty())
+            repaint(cell);
+    }
 }
 
-// void SequencerComponent::mouseDown(const juce::MouseEvent& e)
-// {
-//     // Identifica qué paso se ha pulsado
-//     float cellWidth = getWidth() / (float)numSteps;
-//     float cellHeight = getHeight() / (float)numPads;
-    
-//     int col = static_cast<int>(e.x / cellWidth);
-//     int row = static_cast<int>(e.y / cellHeight);
-    
-//     // Si está dentro de los límites
-//     if (row >= 0 && row < numPads && col >= 0 && col < numSteps)
-//     {
-//         toggleStep(row, col);
-//     }
-// }
+//==============================================================================
+void SequencerComponent::mouseDown(const juce::MouseEvent& e)
+{
+    int row = 0, col = 0;
+    lastDragRow = -1;
+
+    if (!getCellAt(e.getPosition(), row, col))
+        return;
+
+    moveCursor(row, col);
+
+    // Shift + clic fija la longitud de la pista en ese paso
+    if (e.mods.isShiftDown())
+    {
+        audioProcessor.getMidiHandler()->setTrackLength(row, col + 1);
+        updateDisplay();
+        return;
+    }
+
+    // La primera casilla decide si el arrastre pinta o borra
+    dragValue = !getPattern().getStep(row, col);
+    lastDragRow = row;
+    lastDragColumn = col;
+    toggleStep(row, col);
+}
 
 void SequencerComponent::mouseDrag(const juce::MouseEvent& e)
 {
-    // Similar a mouseDown, permite arrastrar para activar/desactivar múltiples casillas
-    mouseDown(e);
+    int row = 0, col = 0;
+
+    if (lastDragRow < 0 || !getCellAt(e.getPosition(), row, col))
+        return;
+
+    if (row == lastDragRow && col == lastDragColumn)
+        return;
+
+    // Un arrastre rápido salta casillas: se rellenan las del camino
+    const auto numCells = juce::jmax(std::abs(row - lastDragRow), std::abs(col - lastDragColumn));
+
+    for (int i = 1; i <= numCells; ++i)
+        paintStep(lastDragRow + juce::roundToInt((row - lastDragRow) * i / (float) numCells),
+                  lastDragColumn + juce::roundToInt((col - lastDragColumn) * i / (float) numCells));
+
+    lastDragRow = row;
+    lastDragColumn = col;
+    moveCursor(row, col);
+    updateDisplay();
 }
 
-void SequencerComponent::createGridButtons()
+void SequencerComponent::mouseWheelMove(const juce::MouseEvent& e, const juce::MouseWheelDetails& wheel)
 {
-    // Limpia los botones existentes
-    padButtons.clear();
-    
-    // Crea los botones para cada paso
-    for (int row = 0; row < numPads; ++row)
+    // Ctrl/Cmd + rueda: zoom alrededor del ratón
+    if (e.mods.isCommandDown())
     {
-        for (int col = 0; col < numSteps; ++col)
-        {
-            auto* button = new juce::DrawableButton(
-                "Step " + juce::String(row) + "-" + juce::String(col),
-                juce::DrawableButton::ImageOnButtonBackground);
-                
-            padButtons.add(button);
-            addAndMakeVisible(button);
-            
-            // Configura la acción al hacer clic
-            button->onClick = [this, row, col] { toggleStep(row, col); };
-        }
+        setZoom(zoom * (1.0f + wheel.deltaY), e.position);
+        return;
     }
+
+    // Mayús + rueda desplaza en horizontal, como en la mayoría de editores
+    const auto deltaX = e.mods.isShiftDown() ? wheel.deltaY : wheel.deltaX;
+    const auto deltaY = e.mods.isShiftDown() ? 0.0f : wheel.deltaY;
+    const auto pixelsPerUnit = 200.0f;
+
+    setScroll(scrollX - juce::roundToInt(deltaX * pixelsPerUnit),
+              scrollY - juce::roundToInt(deltaY * pixelsPerUnit));
 }
 
-juce::Rectangle<int> SequencerComponent::getStepRect(int row, int col)
+void SequencerComponent::mouseMagnify(const juce::MouseEvent& e, float scaleFactor)
 {
-    float cellWidth = getWidth() / (float)numSteps;
-    float cellHeight = getHeight() / (float)numPads;
-    
-    return juce::Rectangle<int>(
-        static_cast<int>(col * cellWidth), 
-        static_cast<int>(row * cellHeight), 
-        static_cast<int>(cellWidth), 
-        static_cast<int>(cellHeight)
-    );
+    setZoom(zoom * scaleFactor, e.position);
 }
 
-void SequencerComponent::toggleStep(int row, int col)
+bool SequencerComponent::keyPressed(const juce::KeyPress& key)
 {
-    // Invierte el estado del paso
-    sequencerGrid[row][col] = !sequencerGrid[row][col];
-    
-    // Llama al procesador para actualizar el patrón
-    // Envía la información al MidiHandler
-    audioProcessor.getMidiHandler()->setStepState(row, col, sequencerGrid[row][col]);
+    const auto keyCode = key.getKeyCode();
 
-    // Cambia el color del botón
-    int index = row * numSteps + col;
-    if (index < padButtons.size() && padButtons[index] != nullptr)
+    if (keyCode == juce::KeyPress::leftKey)   { moveCursor(cursorRow, cursorColumn - 1); return true; }
+    if (keyCode == juce::KeyPress::rightKey)  { moveCursor(cursorRow, cursorColumn + 1); return true; }
+    if (keyCode == juce::KeyPress::upKey)     { moveCursor(cursorRow - 1, cursorColumn); return true; }
+    if (keyCode == juce::KeyPress::downKey)   { moveCursor(cursorRow + 1, cursorColumn); return true; }
+    if (keyCode == juce::KeyPress::homeKey)   { moveCursor(cursorRow, 0); return true; }
+    if (keyCode == juce::KeyPress::endKey)    { moveCursor(cursorRow, getPattern().getTrackLength(cursorRow) - 1); return true; }
+
+    if (keyCode == juce::KeyPress::spaceKey || keyCode == juce::KeyPress::returnKey)
     {
-        padButtons[index]->setToggleState(sequencerGrid[row][col], juce::dontSendNotification);
+        // Mayús fija la longitud, igual que con el ratón
+        if (key.getModifiers().isShiftDown())
+            audioProcessor.getMidiHandler()->setTrackLength(cursorRow, cursorColumn + 1);
+        else
+            toggleStep(cursorRow, cursorColumn);
+
+        updateDisplay();
+        return true;
     }
-    
+
+    const auto character = key.getTextCharacter();
+    const auto centre = getGridArea().getCentre().toFloat();
+
+    if (character == '+' || character == '=')  { setZoom(zoom * 1.25f, centre); return true; }
+    if (character == '-')                      { setZoom(zoom / 1.25f, centre); return true; }
+
+    // El resto (p. ej. el atajo del panel de diagnóstico) sigue hacia el editor
+    return false;
+}
+
+void SequencerComponent::focusGained(FocusChangeType)
+{
+    repaintStep(cursorRow, cursorColumn);
+}
+
+void SequencerComponent::focusLost(FocusChangeType)
+{
+    repaintStep(cursorRow, cursorColumn);
+}
+
+//==============================================================================
+void SequencerComponent::moveCursor(int row, int col)
+{
+    row = juce::jlimit(0, getNumRows() - 1, row);
+    col = juce::jlimit(0, numColumns - 1, col);
+
+    repaintStep(cursorRow, cursorColumn);
+    cursorRow = row;
+    cursorColumn = col;
+    scrollToShow(row, col);
+    repaintStep(cursorRow, cursorColumn);
+}
+
+void SequencerComponent::toggleStep(int row, int col)
+{
+    auto* midiHandler = audioProcessor.getMidiHandler();
+
+    // Invierte el estado del paso en el patrón compartido del MidiHandler
+    const bool isActive = !midiHandler->getStepState(row, col);
+    midiHandler->setStepState(row, col, isActive);
+
     // Produce un sonido inmediato cuando se activa un paso
-    if (sequencerGrid[row][col]) {
-        // Note on para previsualización
-        audioProcessor.getMidiHandler()->sendNoteOn(60 + row, 127);
-        
-        // Note off programado (crea un pequeño efecto de sonido)
-        juce::Timer::callAfterDelay(100, [this, row]() {
-            audioProcessor.getMidiHandler()->sendNoteOff(60 + row);
-        });
-    }
-    
-    repaint();
-}
\ No newline at end of file
+    // (el hilo de audio programa su Note Off, así no queda ninguna nota colgada)
+    if (isActive)
+        midiHandler->previewTrack(row);
+
+    updateDisplay();
+}
+
+void SequencerComponent::paintStep(int row, int col)
+{
+    // Al arrastrar no se previsualiza: serían decenas de notas seguidas
+    auto* midiHandler = audioProcessor.getMidiHandler();
+
+    if (midiHandler->getStepState(row, col) != dragValue)
+        midiHandler->setStepState(row, col, dragValue);
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <juce_gui_basics/juce_gui_basics.h>
+#include "Pattern.h"
+#include "EngineSnapshot.h"
 
 // Forward declaration para evitar dependencias circulares
 class SparkLEPluginAudioProcessor;
@@ -8,9 +10,16 @@ class SparkLEPluginAudioProcessor;
 //==============================================================================
 /**
  * Componente del secuenciador que muestra una cuadrícula para programar patrones rítmicos.
+ *
+ * Es un único componente para toda la cuadrícula (hasta 64 pasos x 32 pistas): la
+ * casilla bajo el ratón se calcula con aritmética, sin un botón por casilla. Arrastrar
+ * pinta o borra (según el estado de la primera casilla), la rueda desplaza, y
+ * Ctrl/Cmd + rueda o el gesto de pellizco hacen zoom. Con el teclado, las flechas
+ * mueven el cursor, Espacio/Intro invierte el paso y +/- cambian el zoom. Solo se
+ * dibujan las casillas visibles, así que el coste no crece con el patrón.
  */
 class SequencerComponent : public juce::Component,
-                           private juce::Timer
+                           private juce::ScrollBar::Listener
 {
 public:
     // Constructor y destructor
@@ -20,37 +29,91 @@ public:
     // Métodos de juce::Component sobrescritos
     void paint(juce::Graphics&) override;
     void resized() override;
-    // void mouseDown(const juce::MouseEvent& e) override;
+    void mouseDown(const juce::MouseEvent& e) override;
     void mouseDrag(const juce::MouseEvent& e) override;
-    
-    // Timer callback para auto-apagado de notas
-    void timerCallback() override {}
-    
-    // Actualiza la visualización (llamado desde el timer del editor)
+    void mouseWheelMove(const juce::MouseEvent& e, const juce::MouseWheelDetails& wheel) override;
+    void mouseMagnify(const juce::MouseEvent& e, float scaleFactor) override;
+    bool keyPressed(const juce::KeyPress& key) override;
+    void focusGained(FocusChangeType cause) override;
+    void focusLost(FocusChangeType cause) override;
+
+    // Actualiza la visualización (llamado desde el timer del editor). Solo repinta
+    // las casillas cuyo cabezal o estado han cambiado desde la última vez; si el
+    // motor no ha publicado nada nuevo, los cabezales ni se miran
     void updateDisplay();
-    
+
     // Método de depuración
     void debug();
-    
+
 private:
     // Referencia al procesador de audio
     SparkLEPluginAudioProcessor& audioProcessor;
-    
-    // Número de pasos y pads
-    static constexpr int numSteps = 16;
-    static constexpr int numPads = 8;
-    
-    // Estado del secuenciador
-    bool sequencerGrid[numPads][numSteps] = {{false}};
-    int currentStep = 0;
-    
-    // Matriz de botones para la cuadrícula
-    juce::OwnedArray<juce::DrawableButton> padButtons;
-    
-    // Métodos para gestionar la cuadrícula
-    void createGridButtons();
-    juce::Rectangle<int> getStepRect(int row, int col);
+
+    // Columnas: todos los pasos posibles, para poder fijar cualquier longitud. Con
+    // zoom 1 caben los pasos y pistas por defecto, como la cuadrícula original
+    static constexpr int numColumns = Pattern::maxSteps;
+    static constexpr float minZoom = 0.25f;
+    static constexpr float maxZoom = 4.0f;
+    static constexpr int scrollBarThickness = 10;
+
+    // Estado del secuenciador. El patrón se lee siempre del MidiHandler, no se
+    // guarda una copia propia; los cabezales son los de la última copia del motor
+    EngineSnapshot snapshot;
+    const Pattern& getPattern() const;
+    int getNumRows() const { return getPattern().getNumTracks(); }
+
+    // Paso del cabezal de una fila, o -1 si el patrón que suena no es el que se muestra
+    int getPlayheadStep(const EngineSnapshot& state, int row) const;
+
+    // Lo que está dibujado ahora mismo, para repintar solo las casillas que cambian
+    std::array<juce::uint64, Pattern::maxTracks> shownRows {};
+    std::array<int, Pattern::maxTracks> shownLengths {};
+    int shownNumRows = 0;
+
+    // Parte fija de la zona visible; se rehace al cambiar el tamaño, el zoom, el
+    // desplazamiento o una longitud
+    juce::Image gridImage;
+    float gridImageScale = 1.0f;
+
+    // Vista: zoom y desplazamiento en píxeles dentro de la cuadrícula completa
+    float zoom = 1.0f;
+    int scrollX = 0;
+    int scrollY = 0;
+    juce::ScrollBar horizontalScrollBar { false };
+    juce::ScrollBar verticalScrollBar { true };
+
+    // Cursor del teclado y arrastre en curso
+    int cursorRow = 0;
+    int cursorColumn = 0;
+    int lastDragRow = -1;
+    int lastDragColumn = -1;
+    bool dragValue = true;
+
+    // Geometría
+    juce::Rectangle<int> getGridArea() const;
+    float getCellWidth() const;
+    float getCellHeight() const;
+    juce::Rectangle<int> getStepRect(int row, int col) const;
+    bool getCellAt(juce::Point<int> position, int& row, int& col) const;
+    juce::Range<int> getVisibleColumns(juce::Rectangle<int> area) const;
+    juce::Range<int> getVisibleRows(juce::Rectangle<int> area) const;
+
+    // Vista
+    void setZoom(float newZoom, juce::Point<float> anchor);
+    void setScroll(int newScrollX, int newScrollY);
+    void scrollToShow(int row, int col);
+    void updateScrollBars();
+    void scrollBarMoved(juce::ScrollBar* scrollBar, double newRangeStart) override;
+
+    // Dibujo
+    void renderGridImage(float scale);
+    void paintActiveStep(juce::Graphics& g, int row, juce::Rectangle<int> cell);
+    void repaintStep(int row, int col);
+
+    // Edición
+    void moveCursor(int row, int col);
     void toggleStep(int row, int col);
-    
+    void paintStep(int row, int col);
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SequencerComponent)
-};
\ No newline at end of file
+};
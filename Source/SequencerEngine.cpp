@@ -0,0 +1,297 @@
+#include "SequencerEngine.h"
+
+//==============================================================================
+const CompiledPattern* SequencerEngine::setPattern(int slot, const CompiledPattern* compiled)
+{
+    if (!juce::isPositiveAndBelow(slot, numPatterns))
+        return compiled;
+
+    auto* previous = patterns[(size_t) slot];
+    patterns[(size_t) slot] = compiled;
+
+    // El cursor apuntaba a la versión anterior: se recoloca en la misma posición
+    if (slot == playingPattern || isSongModeActive())
+        needsRelocate = true;
+
+    return previous;
+}
+
+const CompiledPattern* SequencerEngine::getPattern(int slot) const
+{
+    return juce::isPositiveAndBelow(slot, numPatterns) ? patterns[(size_t) slot] : nullptr;
+}
+
+void SequencerEngine::selectPattern(int index)
+{
+    if (juce::isPositiveAndBelow(index, numPatterns))
+        queuedPattern = (index != playingPattern) ? index : -1;
+}
+
+double SequencerEngine::getPositionInCycle(double ppq) const
+{
+    auto position = ppq - loopStartPpq;
+
+    if (position < 0.0)
+        if (auto* compiled = getPattern(playingPattern))
+            position += compiled->cycleLengthPpq;
+
+    return juce::jmax(0.0, position);
+}
+
+void SequencerEngine::setChainEntry(int position, int patternIndex)
+{
+    if (juce::isPositiveAndBelow(position, maxChainLength) && juce::isPositiveAndBelow(patternIndex, numPatterns))
+    {
+        chain[(size_t) position] = patternIndex;
+
+        if (isSongModeActive())
+            needsRelocate = true;
+    }
+}
+
+void SequencerEngine::setChainLength(int length)
+{
+    chainLength = juce::jlimit(0, maxChainLength, length);
+    needsRelocate = true;
+}
+
+void SequencerEngine::setSongMode(bool shouldUseSongMode)
+{
+    if (songMode != shouldUseSongMode)
+    {
+        songMode = shouldUseSongMode;
+        needsRelocate = true;
+    }
+}
+
+void SequencerEngine::reset()
+{
+    if (queuedPattern >= 0)
+    {
+        playingPattern = queuedPattern;
+        queuedPattern = -1;
+    }
+
+    chainPosition = 0;
+    patternStartPpq = 0.0;
+    lastPpq = 0.0;
+    needsRelocate = true;
+}
+
+void SequencerEngine::process(const SequencerClock::BlockTiming& timing, Listener& listener)
+{
+    if (!timing.isRunning)
+        return;
+
+    if (timing.hasJumped)
+        needsRelocate = true;
+
+    for (int i = 0; i < timing.numSegments; ++i)
+    {
+        // Un tramo que no sigue al anterior empieza en el inicio del loop del host; los
+        // tramos de una rampa de tempo son continuos y el cursor sigue donde estaba
+        if (i > 0 && timing.segments[i].ppqStart != timing.segments[i - 1].ppqEnd)
+            needsRelocate = true;
+
+        renderSegment(timing, timing.segments[i], listener);
+    }
+}
+
+//==============================================================================
+double SequencerEngine::getSlotLengthPpq(int patternIndex) const
+{
+    // En la cadena cada patrón ocupa compases completos
+    auto* compiled = getPattern(patternIndex);
+    const auto lengthPpq = compiled != nullptr ? compiled->lengthPpq : 0.0;
+
+    return juce::jmax(1.0, std::ceil(lengthPpq / ppqPerBar - 1.0e-9)) * ppqPerBar;
+}
+
+double SequencerEngine::getNextSwitchPpq(double ppq) const
+{
+    if (isSongModeActive())
+        return patternStartPpq + getSlotLengthPpq(playingPattern);
+
+    if (queuedPattern >= 0)
+        return std::ceil(ppq / ppqPerBar - 1.0e-9) * ppqPerBar;
+
+    return std::numeric_limits<double>::max();
+}
+
+void SequencerEngine::relocate(double ppq)
+{
+    if (isSongModeActive())
+    {
+        // Busca la entrada de la cadena que corresponde a esta posición
+        double chainLengthPpq = 0.0;
+
+        for (int i = 0; i < chainLength; ++i)
+            chainLengthPpq += getSlotLengthPpq(chain[(size_t) i]);
+
+        const auto cycleStart = std::floor(ppq / chainLengthPpq) * chainLengthPpq;
+        auto slotStart = cycleStart;
+
+        chainPosition = 0;
+
+        for (int i = 0; i < chainLength; ++i)
+        {
+            const auto slotLength = getSlotLengthPpq(chain[(size_t) i]);
+
+            if (ppq < slotStart + slotLength || i == chainLength - 1)
+            {
+                chainPosition = i;
+                break;
+            }
+
+            slotStart += slotLength;
+        }
+
+        playingPattern = chain[(size_t) chainPosition];
+        patternStartPpq = slotStart;
+    }
+
+    auto* compiled = getPattern(playingPattern);
+
+    if (compiled == nullptr || compiled->cycleLengthPpq <= 0.0)
+    {
+        loopStartPpq = patternStartPpq;
+        return;
+    }
+
+    // El patrón se repite desde su ancla; se busca la vuelta que contiene ppq
+    const auto lengthPpq = compiled->cycleLengthPpq;
+    loopStartPpq = patternStartPpq + std::floor((ppq - patternStartPpq) / lengthPpq) * lengthPpq;
+
+    // Cada línea busca sin su swing: un paso retrasado de la vuelta anterior puede
+    // quedar todavía por delante de ppq
+    for (int i = 0; i < compiled->numLanes; ++i)
+    {
+        const auto& lane = compiled->lanes[(size_t) i];
+        auto& laneCursor = laneCursors[(size_t) i];
+        const auto lanePpq = juce::jmax(patternStartPpq, ppq - swingOffset * lane.swingPpq);
+
+        laneCursor.loopStartPpq = patternStartPpq + std::floor((lanePpq - patternStartPpq) / lengthPpq) * lengthPpq;
+        laneCursor.index = compiled->findFirstEventAtOrAfter(lane, juce::jlimit(0.0, lengthPpq, lanePpq - laneCursor.loopStartPpq));
+    }
+}
+
+void SequencerEngine::switchPatternAt(double ppq)
+{
+    if (isSongModeActive())
+    {
+        chainPosition = (chainPosition + 1) % chainLength;
+        playingPattern = chain[(size_t) chainPosition];
+    }
+    else if (queuedPattern >= 0)
+    {
+        playingPattern = queuedPattern;
+        queuedPattern = -1;
+    }
+
+    // El nuevo patrón empieza desde su primer paso justo en el compás
+    patternStartPpq = ppq;
+    loopStartPpq = ppq;
+
+    if (auto* compiled = getPattern(playingPattern))
+        for (int i = 0; i < compiled->numLanes; ++i)
+            laneCursors[(size_t) i] = { compiled->lanes[(size_t) i].begin, ppq };
+}
+
+void SequencerEngine::renderSegment(const SequencerClock::BlockTiming& timing,
+                                    const SequencerClock::Segment& segment,
+                                    Listener& listener)
+{
+    // Un evento suena en el primer sample que alcanza su posición, así que el tramo
+    // se queda con los eventos hasta la posición de su último sample (incluida). Los
+    // que caen entre el último sample y el final del tramo son del tramo siguiente,
+    // que puede ir a otro tempo (rampa) o estar en el bloque siguiente
+    const auto shift = segment.ppqPerSample * (1.0 - 1.0e-9);
+    const auto end = segment.ppqEnd - shift;
+    auto from = segment.ppqStart - shift;
+
+    if (needsRelocate)
+    {
+        relocate(from);
+        needsRelocate = false;
+    }
+
+    // Parte el tramo en los puntos de cambio de patrón
+    while (from < end)
+    {
+        const auto switchPpq = getNextSwitchPpq(from);
+
+        if (switchPpq <= from)
+        {
+            // El patrón nuevo se ancla en el compás exacto, no donde empieza el tramo
+            switchPatternAt(switchPpq);
+            continue;
+        }
+
+        const auto to = juce::jmin(end, switchPpq);
+        playRange(to, timing, segment, listener);
+        from = to;
+    }
+
+    lastPpq = segment.ppqEnd;
+}
+
+void SequencerEngine::playRange(double ppqTo,
+                                const SequencerClock::BlockTiming& timing,
+                                const SequencerClock::Segment& segment,
+                                Listener& listener)
+{
+    auto* compiled = getPattern(playingPattern);
+
+    // Un patrón sin notas también avanza de vuelta: los cabezales dependen de ello
+    if (compiled == nullptr || compiled->cycleLengthPpq <= 0.0)
+        return;
+
+    const auto& events = compiled->events;
+    const auto lengthPpq = compiled->cycleLengthPpq;
+
+    // Vuelta del patrón, para los cabezales
+    while (loopStartPpq + lengthPpq <= ppqTo)
+        loopStartPpq += lengthPpq;
+
+    // Mezcla las líneas en orden de tiempo. Los cursores y sus vueltas se conservan
+    // entre bloques, así que un evento justo en el borde de un bloque nunca se
+    // dispara dos veces; si el swing baja, los que se han quedado atrás suenan al
+    // principio del tramo
+    for (;;)
+    {
+        int next = -1;
+        auto nextPpq = ppqTo;
+
+        for (int i = 0; i < compiled->numLanes; ++i)
+        {
+            const auto& lane = compiled->lanes[(size_t) i];
+            auto& laneCursor = laneCursors[(size_t) i];
+
+            // Fin de la vuelta de la línea: vuelve a empezar
+            if (laneCursor.index >= lane.end)
+            {
+                laneCursor.index = lane.begin;
+                laneCursor.loopStartPpq += lengthPpq;
+            }
+
+            const auto eventPpq = laneCursor.loopStartPpq + events[laneCursor.index].ppq + swingOffset * lane.swingPpq;
+
+            if (eventPpq < nextPpq)
+            {
+                next = i;
+                nextPpq = eventPpq;
+            }
+        }
+
+        if (next < 0)
+            break;
+
+        const auto& event = events[laneCursors[(size_t) next].index++];
+        const auto sampleOffset = timing.sampleOffsetFor(segment, nextPpq);
+
+        if (telemetry != nullptr)
+            telemetry->recordStepError(sampleOffset - timing.exactSampleFor(segment, nextPpq));
+
+        listener.stepTriggered(sampleOffset, event);
+    }
+}
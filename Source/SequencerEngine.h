@@ -0,0 +1,115 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "SequencerClock.h"
+#include "CompiledPattern.h"
+#include "PatternBank.h"
+#include "AudioTelemetry.h"
+
+//==============================================================================
+/**
+ * Motor de reproducción del secuenciador (hilo de audio).
+ *
+ * Recorre con un cursor por línea los eventos del patrón compilado que está
+ * sonando, suma el swing a los de las líneas de pasos impares y avisa al Listener
+ * de cada paso, en orden, con su sample exacto dentro del bloque. Los cambios de
+ * patrón, manuales o de la cadena del modo canción, se aplican justo en el inicio
+ * de un compás. Todas las pistas, tengan la longitud y la duración de paso que
+ * tengan, avanzan en la misma pasada. No reserva memoria ni bloquea.
+ */
+class SequencerEngine
+{
+public:
+    static constexpr int numPatterns = PatternBank::numPatterns;
+    static constexpr int maxChainLength = PatternBank::maxChainLength;
+    static constexpr double ppqPerBar = 4.0;    // Compás de 4/4
+
+    class Listener
+    {
+    public:
+        virtual ~Listener() = default;
+
+        // Empieza un paso del patrón que está sonando
+        virtual void stepTriggered(int sampleOffset, const CompiledPattern::Event& event) = 0;
+    };
+
+    SequencerEngine() = default;
+
+    // Coloca un patrón compilado en una ranura del banco. Devuelve el que había,
+    // que el llamante debe liberar fuera del hilo de audio
+    const CompiledPattern* setPattern(int slot, const CompiledPattern* compiled);
+    const CompiledPattern* getPattern(int slot) const;
+
+    // El cambio de patrón se hace efectivo en el siguiente compás
+    void selectPattern(int index);
+    int getPlayingPattern() const { return playingPattern; }
+
+    // Posición al final del último bloque, relativa al inicio de la vuelta del patrón
+    // que suena (para calcular los cabezales de cada pista)
+    double getPositionInCycle() const { return juce::jmax(0.0, lastPpq - loopStartPpq); }
+
+    // Lo mismo para una posición del último bloque procesado. Si la vuelta empezó
+    // dentro del bloque, una posición anterior cae al final de la vuelta previa
+    double getPositionInCycle(double ppq) const;
+
+    // Swing de la sesión (Pattern::minSwing = recto). Puede cambiar en cualquier
+    // bloque: cada cursor solo avanza, así que ningún paso suena dos veces ni se pierde
+    void setSwing(int swingPercent) { swingOffset = CompiledPattern::getSwingOffset(swingPercent); }
+    double getSwingOffset() const   { return swingOffset; }
+
+    // Cadena del modo canción
+    void setChainEntry(int position, int patternIndex);
+    void setChainLength(int length);
+    void setSongMode(bool shouldUseSongMode);
+
+    // Vuelve al principio (al arrancar el transporte)
+    void reset();
+
+    void process(const SequencerClock::BlockTiming& timing, Listener& listener);
+
+    // Opcional: registra el error de cada paso respecto a su posición exacta
+    void setTelemetry(AudioTelemetry* newTelemetry) { telemetry = newTelemetry; }
+
+private:
+    std::array<const CompiledPattern*, numPatterns> patterns {};
+    std::array<int, maxChainLength> chain {};
+    int chainLength = 0;
+    bool songMode = false;
+
+    int playingPattern = 0;
+    int queuedPattern = -1;
+    int chainPosition = 0;
+
+    // Cursor de una línea. Con swing una línea puede ir aún por la vuelta anterior
+    // (sus últimos pasos caen pasado el final), así que lleva su propio inicio
+    struct LaneCursor
+    {
+        size_t index = 0;
+        double loopStartPpq = 0.0;
+    };
+
+    double patternStartPpq = 0.0;   // Donde empezó a sonar el patrón actual
+    double loopStartPpq = 0.0;      // Inicio de la vuelta actual del patrón
+    double lastPpq = 0.0;           // Final del último tramo procesado
+    std::array<LaneCursor, CompiledPattern::maxLanes> laneCursors {};
+    double swingOffset = 0.0;
+    bool needsRelocate = true;
+
+    AudioTelemetry* telemetry = nullptr;
+
+    bool isSongModeActive() const { return songMode && chainLength > 0; }
+    double getSlotLengthPpq(int patternIndex) const;
+    double getNextSwitchPpq(double ppq) const;
+
+    void relocate(double ppq);
+    void switchPatternAt(double ppq);
+    void renderSegment(const SequencerClock::BlockTiming& timing,
+                       const SequencerClock::Segment& segment,
+                       Listener& listener);
+    void playRange(double ppqTo,
+                   const SequencerClock::BlockTiming& timing,
+                   const SequencerClock::Segment& segment,
+                   Listener& listener);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SequencerEngine)
+};
@@ -0,0 +1,598 @@
+#include "StateSerializer.h"
+
+namespace
+{
+    const char magic[] = { 'S', 'P', 'L', 'E' };
+    constexpr size_t magicSize = sizeof(magic);
+    constexpr size_t checksumSize = 4;
+
+    // Los identificadores no se reutilizan nunca: un lector antiguo salta los que no conoce
+    enum SectionId
+    {
+        transportSection = 1,
+        patternsSection = 2,
+        samplesSection = 3,
+        parametersSection = 4,
+        inputMapSection = 5
+    };
+
+    enum TransportFlags
+    {
+        clickFlag = 1 << 0,
+        midiClickFlag = 1 << 1
+    };
+
+    //==============================================================================
+    // CRC-32 (polinomio de zlib), con la tabla calculada la primera vez
+    juce::uint32 calculateChecksum(const juce::uint8* data, size_t size)
+    {
+        static const auto table = []
+        {
+            std::array<juce::uint32, 256> values {};
+
+            for (juce::uint32 i = 0; i < 256; ++i)
+            {
+                auto value = i;
+
+                for (int bit = 0; bit < 8; ++bit)
+                    value = (value & 1) != 0 ? 0xedb88320u ^ (value >> 1) : value >> 1;
+
+                values[i] = value;
+            }
+
+            return values;
+        }();
+
+        auto crc = 0xffffffffu;
+
+        for (size_t i = 0; i < size; ++i)
+            crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+
+        return crc ^ 0xffffffffu;
+    }
+
+    //==============================================================================
+    void writeVarint(juce::MemoryOutputStream& out, juce::uint64 value)
+    {
+        while (value >= 0x80)
+        {
+            out.writeByte((char) ((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+
+        out.writeByte((char) value);
+    }
+
+    // Zigzag: los valores pequeños, positivos o negativos, ocupan un byte
+    void writeSigned(juce::MemoryOutputStream& out, int value)
+    {
+        writeVarint(out, ((juce::uint64) (juce::uint32) value << 1) ^ (juce::uint64) (juce::int64) (value >> 31));
+    }
+
+    void writeDouble(juce::MemoryOutputStream& out, double value)
+    {
+        juce::uint64 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+
+        for (int i = 0; i < 8; ++i)
+            out.writeByte((char) (bits >> (8 * i)));
+    }
+
+    void writeString(juce::MemoryOutputStream& out, const juce::String& text)
+    {
+        const auto numBytes = text.getNumBytesAsUTF8();
+        writeVarint(out, numBytes);
+        out.write(text.toRawUTF8(), numBytes);
+    }
+
+    void writeSection(juce::MemoryOutputStream& out, SectionId id, juce::MemoryOutputStream& payload)
+    {
+        writeVarint(out, (juce::uint64) id);
+        writeVarint(out, payload.getDataSize());
+        out.write(payload.getData(), payload.getDataSize());
+        payload.reset();
+    }
+
+    //==============================================================================
+    // Lector sobre un rango de bytes. Cualquier lectura fuera de rango o valor
+    // imposible marca el lector como fallido y devuelve 0
+    struct Reader
+    {
+        const juce::uint8* data = nullptr;
+        size_t size = 0;
+        size_t position = 0;
+        bool failed = false;
+
+        bool isAtEnd() const { return failed || position >= size; }
+
+        juce::uint64 readVarint()
+        {
+            juce::uint64 value = 0;
+
+            for (int shift = 0; shift < 64 && position < size; shift += 7)
+            {
+                const auto byte = data[position++];
+                value |= (juce::uint64) (byte & 0x7f) << shift;
+
+                if ((byte & 0x80) == 0)
+                    return value;
+            }
+
+            failed = true;
+            return 0;
+        }
+
+        // Entero sin signo que tiene que estar en [0, limit]
+        int readInt(int limit)
+        {
+            const auto value = readVarint();
+
+            if (value > (juce::uint64) limit)
+            {
+                failed = true;
+                return 0;
+            }
+
+            return (int) value;
+        }
+
+        int readSigned()
+        {
+            const auto value = (juce::uint32) readVarint();
+            return (int) (value >> 1) ^ -(int) (value & 1);
+        }
+
+        double readDouble()
+        {
+            const auto* bytes = readBytes(8);
+
+            if (bytes == nullptr)
+                return 0.0;
+
+            juce::uint64 bits = 0;
+
+            for (int i = 0; i < 8; ++i)
+                bits |= (juce::uint64) bytes[i] << (8 * i);
+
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        const juce::uint8* readBytes(size_t numBytes)
+        {
+            if (failed || numBytes > size - position)
+            {
+                failed = true;
+                return nullptr;
+            }
+
+            const auto* bytes = data + position;
+            position += numBytes;
+            return bytes;
+        }
+
+        juce::String readString()
+        {
+            const auto numBytes = (size_t) readVarint();
+            const auto* bytes = readBytes(numBytes);
+            return bytes != nullptr ? juce::String::fromUTF8((const char*) bytes, (int) numBytes) : juce::String();
+        }
+
+        // Sub-lector con los siguientes numBytes (una sección o un patrón)
+        Reader readBlock()
+        {
+            const auto numBytes = (size_t) readVarint();
+            const auto* bytes = readBytes(numBytes);
+            return bytes != nullptr ? Reader { bytes, numBytes } : Reader { nullptr, 0, 0, true };
+        }
+    };
+
+    //==============================================================================
+    bool isDefaultTrack(const Pattern& pattern, int track)
+    {
+        return pattern.getStoredRow(track) == 0
+            && pattern.getTrackLength(track) == Pattern::defaultNumSteps
+            && pattern.getTrackRate(track) == Pattern::StepRate::sixteenth;
+    }
+
+    void writePattern(juce::MemoryOutputStream& out, const Pattern& pattern)
+    {
+        writeVarint(out, (juce::uint64) pattern.getNumTracks());
+        writeVarint(out, (juce::uint64) pattern.getNumSteps());
+
+        // Hueco del antiguo swing por patrón, que ahora es de la sesión
+        writeVarint(out, (juce::uint64) Pattern::minSwing);
+
+        // Pistas en uso y, por encima, solo hasta la última que tenga algo guardado
+        auto numStoredTracks = Pattern::maxTracks;
+
+        while (numStoredTracks > pattern.getNumTracks() && isDefaultTrack(pattern, numStoredTracks - 1))
+            --numStoredTracks;
+
+        writeVarint(out, (juce::uint64) numStoredTracks);
+
+        for (int track = 0; track < numStoredTracks; ++track)
+        {
+            writeVarint(out, (juce::uint64) pattern.getTrackLength(track));
+            writeVarint(out, (juce::uint64) pattern.getTrackRate(track));
+
+            // La fila en bytes, hasta el último paso activo
+            auto row = pattern.getStoredRow(track);
+            int numRowBytes = 0;
+
+            for (auto remaining = row; remaining != 0; remaining >>= 8)
+                ++numRowBytes;
+
+            writeVarint(out, (juce::uint64) numRowBytes);
+
+            for (int i = 0; i < numRowBytes; ++i, row >>= 8)
+                out.writeByte((char) (row & 0xff));
+        }
+
+        // Gate y microtiming, solo de los pasos que no tienen el valor por defecto.
+        // Cada paso se guarda como distancia al anterior
+        int numCustomSteps = 0;
+
+        for (int step = 0; step < Pattern::maxSteps; ++step)
+            if (pattern.getGate(step) != Pattern::gateUnitsPerStep || pattern.getMicroTiming(step) != 0)
+                ++numCustomSteps;
+
+        writeVarint(out, (juce::uint64) numCustomSteps);
+
+        for (int step = 0, previous = 0; step < Pattern::maxSteps; ++step)
+        {
+            if (pattern.getGate(step) == Pattern::gateUnitsPerStep && pattern.getMicroTiming(step) == 0)
+                continue;
+
+            writeVarint(out, (juce::uint64) (step - previous));
+            writeVarint(out, (juce::uint64) pattern.getGate(step));
+            writeSigned(out, pattern.getMicroTiming(step));
+            previous = step;
+        }
+
+        // Velocidad y desplazamiento de las notas activas que no tienen los valores por
+        // defecto, como distancia a la anterior en orden pista-paso. Van al final del
+        // registro, así que un lector anterior los salta
+        const auto isCustomNote = [&pattern](int track, int step)
+        {
+            return ((pattern.getStoredRow(track) >> step) & 1) != 0
+                && (pattern.getVelocity(track, step) != Pattern::defaultVelocity || pattern.getNudge(track, step) != 0);
+        };
+
+        int numCustomNotes = 0;
+
+        for (int track = 0; track < Pattern::maxTracks; ++track)
+            for (int step = 0; step < Pattern::maxSteps; ++step)
+                if (isCustomNote(track, step))
+                    ++numCustomNotes;
+
+        writeVarint(out, (juce::uint64) numCustomNotes);
+
+        for (int note = 0, previous = 0; note < Pattern::maxTracks * Pattern::maxSteps; ++note)
+        {
+            const auto track = note / Pattern::maxSteps;
+            const auto step = note % Pattern::maxSteps;
+
+            if (!isCustomNote(track, step))
+                continue;
+
+            writeVarint(out, (juce::uint64) (note - previous));
+            writeVarint(out, (juce::uint64) pattern.getVelocity(track, step));
+            writeSigned(out, pattern.getNudge(track, step));
+            previous = note;
+        }
+    }
+
+    // Devuelve el swing que guardaban los patrones antes de ser de la sesión
+    int readPattern(Reader& reader, Pattern& pattern)
+    {
+        pattern = Pattern();
+        pattern.setNumTracks(reader.readInt(Pattern::maxTracks));
+        pattern.setNumSteps(reader.readInt(Pattern::maxSteps));
+        const auto legacySwing = reader.readInt(Pattern::maxSwing);
+
+        const auto numStoredTracks = reader.readInt(Pattern::maxTracks);
+
+        for (int track = 0; track < numStoredTracks && !reader.failed; ++track)
+        {
+            pattern.setTrackLength(track, reader.readInt(Pattern::maxSteps));
+            pattern.setTrackRate(track, (Pattern::StepRate) reader.readInt((int) Pattern::StepRate::numRates - 1));
+
+            const auto numRowBytes = reader.readInt((int) sizeof(juce::uint64));
+            const auto* bytes = reader.readBytes((size_t) numRowBytes);
+            juce::uint64 row = 0;
+
+            for (int i = 0; bytes != nullptr && i < numRowBytes; ++i)
+                row |= (juce::uint64) bytes[i] << (8 * i);
+
+            pattern.setStoredRow(track, row);
+        }
+
+        const auto numCustomSteps = reader.readInt(Pattern::maxSteps);
+
+        for (int i = 0, step = 0; i < numCustomSteps && !reader.failed; ++i)
+        {
+            step += reader.readInt(Pattern::maxSteps - 1);
+
+            if (step >= Pattern::maxSteps)
+            {
+                reader.failed = true;
+                break;
+            }
+
+            pattern.setGate(step, reader.readInt(Pattern::maxGate));
+            pattern.setMicroTiming(step, reader.readSigned());
+        }
+
+        // Registros anteriores a la grabación en vivo no traen notas con velocidad propia
+        if (reader.isAtEnd())
+            return legacySwing;
+
+        const auto numCustomNotes = reader.readInt(Pattern::maxTracks * Pattern::maxSteps);
+
+        for (int i = 0, note = 0; i < numCustomNotes && !reader.failed; ++i)
+        {
+            note += reader.readInt(Pattern::maxTracks * Pattern::maxSteps - 1);
+
+            if (note >= Pattern::maxTracks * Pattern::maxSteps)
+            {
+                reader.failed = true;
+                break;
+            }
+
+            pattern.setVelocity(note / Pattern::maxSteps, note % Pattern::maxSteps, reader.readInt(127));
+            pattern.setNudge(note / Pattern::maxSteps, note % Pattern::maxSteps, reader.readSigned());
+        }
+
+        return legacySwing;
+    }
+
+    //==============================================================================
+    // Devuelve false si la sección es anterior al swing de la sesión
+    bool readTransport(Reader& reader, StateSerializer::State& state)
+    {
+        const auto bpm = reader.readDouble();
+        const auto flags = reader.readVarint();
+
+        if (std::isfinite(bpm) && bpm > 0.0)
+            state.bpm = bpm;
+
+        state.clickEnabled = (flags & clickFlag) != 0;
+        state.midiClickEnabled = (flags & midiClickFlag) != 0;
+
+        if (reader.isAtEnd())
+            return false;
+
+        state.swing = juce::jmax(Pattern::minSwing, reader.readInt(Pattern::maxSwing));
+        return true;
+    }
+
+    // legacySwing recibe el swing que guardaba el patrón seleccionado
+    void readPatterns(Reader& reader, PatternBank& bank, int& legacySwing)
+    {
+        bank.selectedPattern = reader.readInt(PatternBank::numPatterns - 1);
+        bank.songMode = reader.readVarint() != 0;
+        bank.chainLength = reader.readInt(PatternBank::maxChainLength);
+
+        for (int i = 0; i < bank.chainLength; ++i)
+            bank.chain[(size_t) i] = reader.readInt(PatternBank::numPatterns - 1);
+
+        // Solo se guardan los patrones que no están vacíos
+        const auto numStoredPatterns = reader.readInt(PatternBank::numPatterns);
+
+        for (int i = 0; i < numStoredPatterns && !reader.failed; ++i)
+        {
+            const auto index = reader.readInt(PatternBank::numPatterns - 1);
+            auto record = reader.readBlock();
+            const auto patternSwing = readPattern(record, bank.patterns[(size_t) index]);
+
+            if (index == bank.selectedPattern)
+                legacySwing = patternSwing;
+
+            if (record.failed)
+                reader.failed = true;
+        }
+    }
+
+    void readInputMap(Reader& reader, MidiInputMap& map)
+    {
+        // Con la sección presente, lo que no aparece no tiene acción
+        map.clear();
+
+        const auto numBindings = reader.readInt(MidiInputMap::numSources);
+
+        for (int i = 0; i < numBindings && !reader.failed; ++i)
+        {
+            const auto source = reader.readInt(MidiInputMap::numSources - 1);
+            const auto action = (MidiInputMap::Action) reader.readInt((int) MidiInputMap::Action::numActions - 1);
+            const auto argument = reader.readSigned();
+
+            if (argument < -128 || argument > 127)
+                reader.failed = true;
+            else
+                map.setBinding(source, { action, (juce::int8) argument });
+        }
+    }
+
+    void readSamples(Reader& reader, StateSerializer::State& state)
+    {
+        const auto numSamples = reader.readInt(StateSerializer::maxPads);
+
+        for (int i = 0; i < numSamples && !reader.failed; ++i)
+        {
+            const auto pad = reader.readInt(StateSerializer::maxPads - 1);
+            state.sampleFiles[(size_t) pad] = reader.readString();
+        }
+    }
+}
+
+//==============================================================================
+void StateSerializer::write(const State& state, juce::MemoryBlock& destData)
+{
+    juce::MemoryOutputStream out(destData, false);
+    juce::MemoryOutputStream payload;
+
+    out.write(magic, magicSize);
+    writeVarint(out, (juce::uint64) formatVersion);
+
+    // Transporte
+    writeDouble(payload, state.bpm);
+    writeVarint(payload, (juce::uint64) ((state.clickEnabled ? clickFlag : 0) | (state.midiClickEnabled ? midiClickFlag : 0)));
+    writeVarint(payload, (juce::uint64) state.swing);
+    writeSection(out, transportSection, payload);
+
+    // Banco de patrones y cadena del modo canción
+    const auto& bank = state.bank;
+    writeVarint(payload, (juce::uint64) bank.selectedPattern);
+    writeVarint(payload, bank.songMode ? 1 : 0);
+    writeVarint(payload, (juce::uint64) bank.chainLength);
+
+    for (int i = 0; i < bank.chainLength; ++i)
+        writeVarint(payload, (juce::uint64) bank.chain[(size_t) i]);
+
+    const Pattern emptyPattern;
+    int numStoredPatterns = 0;
+
+    for (const auto& pattern : bank.patterns)
+        if (pattern != emptyPattern)
+            ++numStoredPatterns;
+
+    writeVarint(payload, (juce::uint64) numStoredPatterns);
+
+    // Cada patrón lleva su tamaño delante para poder añadirle campos más adelante
+    juce::MemoryOutputStream record;
+
+    for (int index = 0; index < PatternBank::numPatterns; ++index)
+    {
+        const auto& pattern = bank.patterns[(size_t) index];
+
+        if (pattern == emptyPattern)
+            continue;
+
+        writePattern(record, pattern);
+        writeVarint(payload, (juce::uint64) index);
+        writeVarint(payload, record.getDataSize());
+        payload.write(record.getData(), record.getDataSize());
+        record.reset();
+    }
+
+    writeSection(out, patternsSection, payload);
+
+    // Ficheros de los pads
+    int numSamples = 0;
+
+    for (const auto& path : state.sampleFiles)
+        if (path.isNotEmpty())
+            ++numSamples;
+
+    if (numSamples > 0)
+    {
+        writeVarint(payload, (juce::uint64) numSamples);
+
+        for (int pad = 0; pad < maxPads; ++pad)
+        {
+            if (state.sampleFiles[(size_t) pad].isEmpty())
+                continue;
+
+            writeVarint(payload, (juce::uint64) pad);
+            writeString(payload, state.sampleFiles[(size_t) pad]);
+        }
+
+        writeSection(out, samplesSection, payload);
+    }
+
+    // Parámetros del host
+    if (state.parameters.getSize() > 0)
+    {
+        payload.write(state.parameters.getData(), state.parameters.getSize());
+        writeSection(out, parametersSection, payload);
+    }
+
+    // Tabla de entrada MIDI, solo las fuentes con acción
+    int numBindings = 0;
+
+    for (int source = 0; source < MidiInputMap::numSources; ++source)
+        if (state.inputMap.getBinding(source).action != MidiInputMap::Action::none)
+            ++numBindings;
+
+    writeVarint(payload, (juce::uint64) numBindings);
+
+    for (int source = 0; source < MidiInputMap::numSources; ++source)
+    {
+        const auto binding = state.inputMap.getBinding(source);
+
+        if (binding.action == MidiInputMap::Action::none)
+            continue;
+
+        writeVarint(payload, (juce::uint64) source);
+        writeVarint(payload, (juce::uint64) binding.action);
+        writeSigned(payload, binding.argument);
+    }
+
+    writeSection(out, inputMapSection, payload);
+
+    const auto checksum = calculateChecksum(static_cast<const juce::uint8*>(out.getData()), out.getDataSize());
+
+    for (int i = 0; i < (int) checksumSize; ++i)
+        out.writeByte((char) (checksum >> (8 * i)));
+}
+
+bool StateSerializer::read(const void* data, size_t sizeInBytes, State& result)
+{
+    if (!hasValidHeader(data, sizeInBytes))
+        return false;
+
+    const auto* bytes = static_cast<const juce::uint8*>(data);
+    const auto contentSize = sizeInBytes - checksumSize;
+    juce::uint32 storedChecksum = 0;
+
+    for (size_t i = 0; i < checksumSize; ++i)
+        storedChecksum |= (juce::uint32) bytes[contentSize + i] << (8 * i);
+
+    if (calculateChecksum(bytes, contentSize) != storedChecksum)
+        return false;
+
+    Reader reader { bytes + magicSize, contentSize - magicSize };
+    const auto version = reader.readVarint();
+
+    if (reader.failed || version == 0 || version > (juce::uint64) formatVersion)
+        return false;
+
+    result = State();
+
+    // Los estados anteriores al swing de la sesión toman el del patrón seleccionado
+    auto hasSwing = false;
+    auto legacySwing = (int) Pattern::minSwing;
+
+    while (!reader.isAtEnd())
+    {
+        const auto id = reader.readVarint();
+        auto section = reader.readBlock();
+
+        switch (id)
+        {
+            case transportSection:  hasSwing = readTransport(section, result); break;
+            case patternsSection:   readPatterns(section, result.bank, legacySwing); break;
+            case samplesSection:    readSamples(section, result); break;
+            case parametersSection: result.parameters.replaceAll(section.data, section.size); break;
+            case inputMapSection:   readInputMap(section, result.inputMap); break;
+            default:                break;  // Sección de una versión posterior
+        }
+
+        if (section.failed)
+            return false;
+    }
+
+    if (!hasSwing)
+        result.swing = juce::jmax(Pattern::minSwing, legacySwing);
+
+    return !reader.failed;
+}
+
+bool StateSerializer::hasValidHeader(const void* data, size_t sizeInBytes)
+{
+    return data != nullptr
+        && sizeInBytes >= magicSize + 1 + checksumSize
+        && std::memcmp(data, magic, magicSize) == 0;
+}
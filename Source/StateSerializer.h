@@ -0,0 +1,50 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include "PatternBank.h"
+#include "MidiInputMap.h"
+
+//==============================================================================
+/**
+ * Formato binario del estado del plugin (lo que el host guarda en el proyecto).
+ *
+ * Cabecera "SPLE" y versión del formato, una lista de secciones con identificador y
+ * tamaño, y un CRC-32 de todo lo anterior al final. Los enteros van en varint
+ * (LEB128), las filas de pasos empaquetadas en bits hasta el último paso activo y
+ * los datos por paso (gate y microtiming) solo donde no tienen el valor por
+ * defecto, así que un banco típico ocupa unos cientos de bytes.
+ *
+ * Compatibilidad: un lector salta las secciones que no conoce y los bytes que sobran
+ * al final de una sección o de un patrón, de modo que se pueden añadir campos sin
+ * cambiar la versión. La versión solo sube con cambios incompatibles, y un chunk de
+ * una versión posterior se rechaza entero. Se puede usar desde cualquier hilo.
+ */
+class StateSerializer
+{
+public:
+    static constexpr int formatVersion = 1;
+    static constexpr int maxPads = Pattern::maxTracks;   // Un pad por pista, como SamplePlayer
+
+    struct State
+    {
+        PatternBank bank;
+        double bpm = 120.0;
+        int swing = Pattern::minSwing;
+        bool clickEnabled = true;
+        bool midiClickEnabled = false;
+        std::array<juce::String, maxPads> sampleFiles;   // Ruta completa, vacía si el pad no tiene sample
+        juce::MemoryBlock parameters;                   // Estado de los parámetros del host, tal cual
+        MidiInputMap inputMap;                          // Sin sección en el chunk: el mapa por defecto
+    };
+
+    // Sustituye el contenido de destData
+    static void write(const State& state, juce::MemoryBlock& destData);
+
+    // Devuelve false si los datos no son de este formato, están dañados o son de una
+    // versión posterior; en ese caso result puede haber quedado a medias
+    static bool read(const void* data, size_t sizeInBytes, State& result);
+
+    // Comprueba solo la cabecera, para distinguir este formato de los chunks antiguos
+    static bool hasValidHeader(const void* data, size_t sizeInBytes);
+};